@@ -41,3 +41,62 @@ static void csc_write(benchmark::State& state) {
 }
 
 BENCHMARK(csc_write)->Name("op:write/matrix:CSC/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Format the CSC indices only, with csc_formatter on a single thread. Isolates the cost of integer formatting.
+ */
+static void csc_format_indices(benchmark::State& state) {
+    std::size_t num_bytes = 0;
+
+    fast_matrix_market::matrix_market_header header(csc_to_write.nrows, csc_to_write.ncols);
+    header.field = fast_matrix_market::pattern;
+    fast_matrix_market::write_options options;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::line_formatter<int64_t, VT> lf(header, options);
+        auto formatter = fast_matrix_market::csc_formatter(lf,
+                                                           csc_to_write.indptr.cbegin(), csc_to_write.indptr.cend() - 1,
+                                                           csc_to_write.indices.cbegin(), csc_to_write.indices.cend(),
+                                                           csc_to_write.vals.cbegin(), csc_to_write.vals.cbegin(),
+                                                           false);
+        while (formatter.has_next()) {
+            std::string chunk = formatter.next_chunk(options)();
+            num_bytes += chunk.size();
+            benchmark::DoNotOptimize(chunk.data());
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(csc_format_indices)->Name("op:format-indices/matrix:CSC/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations);
+
+/**
+ * Reference for csc_format_indices: the previous approach of one int_to_string() per index, as a hand-written loop.
+ */
+static void csc_format_indices_int_to_string(benchmark::State& state) {
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        std::string chunk;
+        chunk.reserve(csc_to_write.indices.size() * 16);
+
+        for (int64_t col = 0; col < csc_to_write.ncols; ++col) {
+            for (auto i = csc_to_write.indptr[col]; i < csc_to_write.indptr[col + 1]; ++i) {
+                chunk += fast_matrix_market::int_to_string(csc_to_write.indices[i] + 1);
+                chunk += ' ';
+                chunk += fast_matrix_market::int_to_string(col + 1);
+                chunk += '\n';
+            }
+        }
+
+        num_bytes += chunk.size();
+        benchmark::DoNotOptimize(chunk.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(csc_format_indices_int_to_string)->Name("op:format-indices/matrix:CSC/impl:int_to_string/lang:C++")->UseRealTime()->Iterations(num_iterations);
@@ -0,0 +1,121 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <sstream>
+
+#include "fmm_bench.hpp"
+#include <fast_matrix_market/gzip.hpp>
+
+using VT = double;
+static int num_iterations = 3;
+
+/**
+ * Compress `data` into gzip members of at most `member_size` uncompressed bytes. BGZF members if `bgzf` is true.
+ */
+static std::string compress(const std::string& data, std::size_t member_size, bool bgzf) {
+    std::string out;
+    for (std::size_t start = 0; start < data.size(); start += member_size) {
+        std::string in = data.substr(start, member_size);
+
+        z_stream zs{};
+        deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        std::string member(deflateBound(&zs, (uLong)in.size()) + 32, '\0');
+        zs.next_in = reinterpret_cast<Bytef*>(in.data());
+        zs.avail_in = (uInt)in.size();
+        zs.next_out = reinterpret_cast<Bytef*>(member.data());
+        zs.avail_out = (uInt)member.size();
+        deflate(&zs, Z_FINISH);
+        member.resize(zs.total_out);
+        deflateEnd(&zs);
+
+        if (bgzf) {
+            std::string extra = {6, 0, 'B', 'C', 2, 0, 0, 0};
+            member[3] = (char)(member[3] | 0x04);
+            member.insert(10, extra);
+            std::size_t bsize = member.size() - 1;
+            member[16] = (char)(bsize & 0xffU);
+            member[17] = (char)((bsize >> 8U) & 0xffU);
+        }
+        out += member;
+    }
+    return out;
+}
+
+static std::string generate_gzip_string(bool bgzf) {
+    auto triplet = construct_triplet<int64_t, VT>(kCoordTargetBytes);
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {triplet.nrows, triplet.ncols}, triplet.rows, triplet.cols, triplet.vals);
+    std::string mtx = oss.str();
+    // BGZF members hold at most 64 KiB
+    return compress(mtx, bgzf ? 60000 : mtx.size(), bgzf);
+}
+
+static std::string gzip_string_to_read = generate_gzip_string(false);
+static std::string bgzf_string_to_read = generate_gzip_string(true);
+
+/**
+ * Read a gzip-compressed triplet.
+ */
+static void gzip_read(benchmark::State& state, bool bgzf, bool parallel_decompress) {
+    const std::string& compressed = bgzf ? bgzf_string_to_read : gzip_string_to_read;
+
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    fast_matrix_market::read_options gzip_options = options;
+    gzip_options.parallel_ok = parallel_decompress;
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        std::istringstream iss(compressed);
+        fast_matrix_market::gzip_istream gz(iss, gzip_options);
+        fast_matrix_market::read_matrix_market_triplet(gz, header, triplet.rows, triplet.cols, triplet.vals, options);
+        num_bytes += compressed.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK_CAPTURE(gzip_read, sequential, false, false)->Name("op:read/matrix:Coordinate/impl:FMM-gzip-sequential/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+BENCHMARK_CAPTURE(gzip_read, threaded, false, true)->Name("op:read/matrix:Coordinate/impl:FMM-gzip/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+BENCHMARK_CAPTURE(gzip_read, bgzf, true, true)->Name("op:read/matrix:Coordinate/impl:FMM-bgzf/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Only decompress a single-member gzip file. zlib alone, for reference, or through gzip_istream.
+ */
+static void gzip_decompress(benchmark::State& state, bool zlib_only) {
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+    std::string block(fast_matrix_market::kGzipBlockBytes, '\0');
+
+    for ([[maybe_unused]] auto _ : state) {
+        std::istringstream iss(gzip_string_to_read);
+        if (zlib_only) {
+            fast_matrix_market::gzip_inflater inflater(iss);
+            while (inflater.next(block)) {
+                num_bytes += block.size();
+            }
+        } else {
+            fast_matrix_market::gzip_istream gz(iss, options);
+            while (gz.read(block.data(), (std::streamsize)block.size()) || gz.gcount() > 0) {
+                num_bytes += (std::size_t)gz.gcount();
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK_CAPTURE(gzip_decompress, zlib, true)->Name("op:decompress/matrix:Coordinate/impl:zlib/lang:C++")->UseRealTime()->Iterations(num_iterations)->ArgName("p")->Arg(1);
+BENCHMARK_CAPTURE(gzip_decompress, fmm, false)->Name("op:decompress/matrix:Coordinate/impl:FMM-gzip/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
@@ -0,0 +1,154 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <numeric>
+#include <sstream>
+
+#include "fmm_bench.hpp"
+#include <fast_matrix_market/app/generator.hpp>
+#include <fast_matrix_market/app/sell.hpp>
+
+using VT = double;
+static int num_iterations = 3;
+
+static const int64_t kSliceHeight = 8;
+static const int64_t kSigma = 256;
+
+/**
+ * Matrix with row lengths 1 to 16, so that sorting and padding matter.
+ */
+static std::string generate_sell_string() {
+    const int64_t nnz = kCoordTargetBytes / (2 * sizeof(int64_t) + sizeof(VT));
+    const int64_t nrows = nnz / 8;
+
+    std::vector<int64_t> row_starts(nrows + 1, 0);
+    for (int64_t row = 0; row < nrows; ++row) {
+        row_starts[row + 1] = row_starts[row] + (row * 7) % 16 + 1;
+    }
+
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_generated_triplet<int64_t, VT>(
+            oss, {nrows, nrows}, row_starts[nrows],
+            [&](auto coo_index, auto& row, auto& col, auto& value) {
+                row = std::upper_bound(row_starts.begin(), row_starts.end(), coo_index) - row_starts.begin() - 1;
+                col = (row + (coo_index - row_starts[row]) * 1021) % nrows;
+                value = (VT)coo_index;
+            });
+    return oss.str();
+}
+
+static std::string sell_string_to_read = generate_sell_string();
+
+struct sell_matrix {
+    std::vector<int64_t> row_perm, slice_ptr, cols;
+    std::vector<VT> vals;
+};
+
+/**
+ * Read directly into SELL-C-sigma.
+ */
+static void sell_read(benchmark::State& state, bool reparse) {
+    fast_matrix_market::sell_options layout;
+    layout.slice_height = kSliceHeight;
+    layout.sigma = kSigma;
+    layout.reparse = reparse;
+
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        sell_matrix sell;
+
+        std::istringstream iss(sell_string_to_read);
+        fast_matrix_market::read_matrix_market_sell(iss, header, sell.row_perm, sell.slice_ptr, sell.cols, sell.vals,
+                                                    layout, options);
+        num_bytes += sell_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK_CAPTURE(sell_read, triplet, false)->Name("op:read/matrix:SELL/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+BENCHMARK_CAPTURE(sell_read, reparse, true)->Name("op:read/matrix:SELL/impl:FMM-reparse/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Reference for sell_read: read a triplet, build CSR, then convert CSR to SELL-C-sigma.
+ */
+static void sell_read_via_csr(benchmark::State& state) {
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        std::istringstream iss(sell_string_to_read);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, triplet.rows, triplet.cols, triplet.vals, options);
+        const int64_t nrows = header.nrows;
+
+        // triplet to CSR
+        csc_matrix<int64_t, VT> csr;
+        csr.indptr.assign(nrows + 1, 0);
+        for (auto row : triplet.rows) {
+            ++csr.indptr[row + 1];
+        }
+        std::partial_sum(csr.indptr.begin(), csr.indptr.end(), csr.indptr.begin());
+        csr.indices.resize(triplet.rows.size());
+        csr.vals.resize(triplet.rows.size());
+        {
+            std::vector<int64_t> next(csr.indptr.begin(), csr.indptr.end() - 1);
+            for (std::size_t i = 0; i < triplet.rows.size(); ++i) {
+                auto dest = next[triplet.rows[i]]++;
+                csr.indices[dest] = triplet.cols[i];
+                csr.vals[dest] = triplet.vals[i];
+            }
+        }
+
+        // CSR to SELL-C-sigma
+        sell_matrix sell;
+        sell.row_perm.resize(nrows);
+        std::iota(sell.row_perm.begin(), sell.row_perm.end(), 0);
+        auto length = [&](int64_t row) { return csr.indptr[row + 1] - csr.indptr[row]; };
+        for (int64_t window = 0; window < nrows; window += kSigma) {
+            std::stable_sort(sell.row_perm.begin() + window, sell.row_perm.begin() + std::min(window + kSigma, nrows),
+                             [&](int64_t lhs, int64_t rhs) { return length(lhs) > length(rhs); });
+        }
+        const int64_t num_slices = (nrows + kSliceHeight - 1) / kSliceHeight;
+        sell.slice_ptr.resize(num_slices + 1);
+        sell.slice_ptr[0] = 0;
+        for (int64_t slice = 0; slice < num_slices; ++slice) {
+            int64_t width = 0;
+            for (int64_t p = slice * kSliceHeight; p < std::min((slice + 1) * kSliceHeight, nrows); ++p) {
+                width = std::max(width, length(sell.row_perm[p]));
+            }
+            sell.slice_ptr[slice + 1] = sell.slice_ptr[slice] + width * kSliceHeight;
+        }
+        sell.cols.assign(sell.slice_ptr[num_slices], 0);
+        sell.vals.assign(sell.slice_ptr[num_slices], 0);
+        for (int64_t p = 0; p < nrows; ++p) {
+            int64_t row = sell.row_perm[p];
+            int64_t base = sell.slice_ptr[p / kSliceHeight] + p % kSliceHeight;
+            for (int64_t k = 0; k < length(row); ++k) {
+                sell.cols[base + k * kSliceHeight] = csr.indices[csr.indptr[row] + k];
+                sell.vals[base + k * kSliceHeight] = csr.vals[csr.indptr[row] + k];
+            }
+        }
+
+        num_bytes += sell_string_to_read.size();
+        benchmark::DoNotOptimize(sell.vals.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(sell_read_via_csr)->Name("op:read/matrix:SELL/impl:triplet-CSR-SELL/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
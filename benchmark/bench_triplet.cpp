@@ -54,6 +54,98 @@ static void triplet_read(benchmark::State& state) {
 
 BENCHMARK(triplet_read)->Name("op:read/matrix:Coordinate/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
 
+/**
+ * Read triplets and verify the body's CRC32C.
+ */
+static void triplet_read_verify_checksum(benchmark::State& state) {
+    fast_matrix_market::body_checksum checksum;
+    {
+        std::istringstream iss(triplet_string_to_read);
+        fast_matrix_market::matrix_market_header header;
+        fast_matrix_market::read_header(iss, header);
+        std::string body = triplet_string_to_read.substr((std::size_t)iss.tellg());
+        checksum.crc32c = fast_matrix_market::crc32c(body);
+        checksum.num_bytes = (int64_t)body.size();
+    }
+
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+    options.expected_checksum = &checksum;
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        std::istringstream iss(triplet_string_to_read);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, triplet.rows, triplet.cols, triplet.vals, options);
+        num_bytes += triplet_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_read_verify_checksum)->Name("op:read/matrix:Coordinate/impl:FMM-crc32c/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Read triplets from memory through a byte_source, which lends chunks to the parser without copying them.
+ */
+static void triplet_read_memory_source(benchmark::State& state) {
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        triplet_matrix<int64_t, VT> triplet;
+
+        fast_matrix_market::memory_source source(triplet_string_to_read);
+        fast_matrix_market::read_header(source, header);
+        triplet.rows.resize(header.nnz);
+        triplet.cols.resize(header.nnz);
+        triplet.vals.resize(header.nnz);
+        auto handler = fast_matrix_market::triplet_parse_handler(triplet.rows.begin(), triplet.cols.begin(), triplet.vals.begin());
+        fast_matrix_market::read_matrix_market_body(source, header, handler, 1.0, options);
+        num_bytes += triplet_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_read_memory_source)->Name("op:read/matrix:Coordinate/impl:FMM-memory_source/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Read triplets into vectors that are not zero-filled when the reader sizes them.
+ */
+static void triplet_read_uninitialized(benchmark::State& state) {
+    fast_matrix_market::read_options options{};
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+
+    std::size_t num_bytes = 0;
+
+    for ([[maybe_unused]] auto _ : state) {
+        fast_matrix_market::matrix_market_header header;
+        fast_matrix_market::uninitialized_vector<int64_t> rows, cols;
+        fast_matrix_market::uninitialized_vector<VT> vals;
+
+        std::istringstream iss(triplet_string_to_read);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, rows, cols, vals, options);
+        num_bytes += triplet_string_to_read.size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_read_uninitialized)->Name("op:read/matrix:Coordinate/impl:FMM-uninitialized/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
 
 /**
  * Write triplets.
@@ -84,3 +176,32 @@ static void triplet_write(benchmark::State& state) {
 }
 
 BENCHMARK(triplet_write)->Name("op:write/matrix:Coordinate/impl:FMM/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
+
+/**
+ * Write triplets and compute the body's CRC32C.
+ */
+static void triplet_write_checksum(benchmark::State& state) {
+    std::size_t num_bytes = 0;
+
+    fast_matrix_market::body_checksum checksum;
+    fast_matrix_market::write_options options;
+    options.parallel_ok = true;
+    options.num_threads = (int)state.range(0);
+    options.checksum = &checksum;
+
+    for ([[maybe_unused]] auto _ : state) {
+        std::ostringstream oss;
+
+        fast_matrix_market::write_matrix_market_triplet(oss,
+                                                        {triplet_to_write.nrows, triplet_to_write.ncols},
+                                                        triplet_to_write.rows, triplet_to_write.cols, triplet_to_write.vals,
+                                                        options);
+
+        num_bytes += oss.str().size();
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed((int64_t)num_bytes);
+}
+
+BENCHMARK(triplet_write_checksum)->Name("op:write/matrix:Coordinate/impl:FMM-crc32c/lang:C++")->UseRealTime()->Iterations(num_iterations)->Apply(NumThreadsArgument);
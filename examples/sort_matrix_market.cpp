@@ -7,6 +7,7 @@
 #include <iostream>
 #include <numeric>
 #include <fast_matrix_market/fast_matrix_market.hpp>
+#include <fast_matrix_market/app/string_arena.hpp>
 
 namespace fmm = fast_matrix_market;
 
@@ -17,13 +18,20 @@ void sort_file(const std::filesystem::path& in_path, const std::filesystem::path
     std::vector<VT> original_vals, sorted_vals;
 
     fmm::matrix_market_header header;
-    
+
+    // Holds the text of std::string_view values
+    fmm::string_arena arena;
+
     // Load
     {
         fmm::read_options options;
         options.generalize_symmetry = false;
         std::ifstream f(in_path);
-        fmm::read_matrix_market_triplet(f, header, original_rows, original_cols, original_vals, options);
+        if constexpr (std::is_same_v<VT, std::string_view>) {
+            fmm::read_matrix_market_triplet(f, header, original_rows, original_cols, original_vals, arena, options);
+        } else {
+            fmm::read_matrix_market_triplet(f, header, original_rows, original_cols, original_vals, options);
+        }
     }
 
     // Find sort permutation
@@ -89,7 +97,8 @@ int main(int argc, char **argv) {
         return 0;
     }
 
-    sort_file<int64_t, std::string>(in_path, out_path);
+    // Values are copied verbatim, so any field type is sorted losslessly.
+    sort_file<int64_t, std::string_view>(in_path, out_path);
 
     return 0;
 }
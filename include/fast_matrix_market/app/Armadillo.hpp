@@ -45,7 +45,11 @@ namespace fast_matrix_market {
         arma::uvec cols;
         arma::Col<VT> vals;
 
-        fast_matrix_market::read_matrix_market_triplet(instream, header, rows, cols, vals, options);
+        // SpMat needs a value for every location
+        read_options triplet_options = options;
+        triplet_options.structure_only = false;
+
+        fast_matrix_market::read_matrix_market_triplet(instream, header, rows, cols, vals, triplet_options);
 
         arma::umat locations = join_rows(rows, cols).t();
 
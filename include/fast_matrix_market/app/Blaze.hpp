@@ -28,11 +28,15 @@ namespace fast_matrix_market {
         mat.resize(header.nrows, header.ncols);
 
         // Read into triplets
-        std::vector<IT> rows;
-        std::vector<IT> cols;
-        std::vector<VT> vals;
+        uninitialized_vector<IT> rows;
+        uninitialized_vector<IT> cols;
+        uninitialized_vector<VT> vals;
 
-        read_matrix_market_body_triplet(instream, header, rows, cols, vals, default_pattern_value, options);
+        // The matrix is built from the values
+        read_options triplet_options = options;
+        triplet_options.structure_only = false;
+
+        read_matrix_market_body_triplet(instream, header, rows, cols, vals, default_pattern_value, triplet_options);
 
         size_t storage_nnz = vals.size();
         mat.reserve(storage_nnz);
@@ -43,10 +47,10 @@ namespace fast_matrix_market {
         // then step through the major dimension and insert values.
 
         bool is_row_major = blaze::IsRowMajorMatrix_v<SparseMatrix>;
-        const std::vector<IT>* major;
+        const uninitialized_vector<IT>* major;
 
         // Find sort permutation
-        std::vector<std::size_t> perm(storage_nnz);
+        uninitialized_vector<std::size_t> perm(storage_nnz);
         std::iota(perm.begin(), perm.end(), 0);
         if (is_row_major) {
             major = &rows;
@@ -156,9 +160,9 @@ namespace fast_matrix_market {
                         auto minor_idx = it->index();
 
                         if (is_row_major) {
-                            chunk += line_formatter.coord_matrix(major_iter, minor_idx, it->value());
+                            line_formatter.append_coord_matrix(chunk, major_iter, minor_idx, it->value());
                         } else {
-                            chunk += line_formatter.coord_matrix(minor_idx, major_iter, it->value());
+                            line_formatter.append_coord_matrix(chunk, minor_idx, major_iter, it->value());
                         }
                     }
                 }
@@ -269,8 +273,8 @@ namespace fast_matrix_market {
         }
 
         // Read into doublets
-        std::vector<IT> inds(header.vector_length);
-        std::vector<VT> vals(header.vector_length);
+        uninitialized_vector<IT> inds(header.vector_length);
+        uninitialized_vector<VT> vals(header.vector_length);
 
         auto handler = doublet_parse_handler(inds.begin(), vals.begin());
         read_matrix_market_body(instream, header, handler, default_pattern_value, options);
@@ -279,7 +283,7 @@ namespace fast_matrix_market {
         // The vector needs to be constructed in order, sorted by index.
 
         // Find sort permutation
-        std::vector<std::size_t> perm(header.nnz);
+        uninitialized_vector<std::size_t> perm(header.nnz);
         std::iota(perm.begin(), perm.end(), 0);
 
         std::sort(perm.begin(), perm.end(),
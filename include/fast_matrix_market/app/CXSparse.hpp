@@ -19,13 +19,7 @@ namespace fast_matrix_market {
         matrix_market_header header;
         read_header(instream, header);
 
-        // Sanitize symmetry generalization settings
-        if (options.generalize_symmetry && options.generalize_symmetry_app) {
-            // cs_compress drops zero elements
-            options.generalize_coordinate_diagnonal_values = read_options::ExtraZeroElement;
-        }
-
-        // allocate
+        // allocate enough for the generalized matrix
         *cs = spalloc(header.nrows, header.ncols, get_storage_nnz(header, options),
                       header.field == pattern ? 0 : 1, // pattern field means do not allocate values
                       1);
@@ -33,11 +27,49 @@ namespace fast_matrix_market {
             return;
         }
 
+        // Sanitize symmetry generalization settings
+        bool app_generalize = false;
+        deferred_permutation permutation;
+        if (use_app_symmetry_generalization(options)) {
+            app_generalize = true;
+            options.generalize_symmetry = false;
+            permutation = defer_permutation(options, header);
+        }
+
         auto handler = triplet_parse_handler((*cs)->i, (*cs)->p, (*cs)->x);
         read_matrix_market_body_no_adapters(instream, header, handler, options);
 
         // nz > 0 indicates a triplet matrix.
-        (*cs)->nz = (*cs)->nzmax;
+        (*cs)->nz = get_storage_nnz(header, options);
+
+        if (app_generalize && header.symmetry != general) {
+            // Mirror into the already-allocated space. Diagonals are not duplicated, so nz may end up below nzmax.
+            CS* A = *cs;
+            using VT = std::remove_pointer_t<decltype(A->x)>;
+            generalize_symmetry_by_index(
+                    (int64_t)A->nz,
+                    [&](int64_t i) {
+                        return A->i[i] == A->p[i];
+                    },
+                    [&](int64_t new_size) {
+                        A->nz = new_size;
+                    },
+                    [&](int64_t i, int64_t dest) {
+                        A->i[dest] = A->p[i];
+                        A->p[dest] = A->i[i];
+                        if (A->x != nullptr) {
+                            A->x[dest] = get_symmetric_value<VT>(A->x[i], header.symmetry);
+                        }
+                    },
+                    options);
+
+            if (!permutation.empty()) {
+                for (int64_t i = 0; i < (int64_t)A->nz; ++i) {
+                    A->i[i] = permutation.row(A->i[i]);
+                    A->p[i] = permutation.col(A->p[i]);
+                }
+            }
+        }
     }
 
     /**
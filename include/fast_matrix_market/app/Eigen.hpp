@@ -16,6 +16,24 @@
 
 
 namespace fast_matrix_market {
+    /**
+     * Same interface as Eigen::Triplet, which setFromTriplets() requires, but without the constructor that zeroes it.
+     * A vector of them can then be sized without touching the memory.
+     */
+    template <typename Scalar, typename StorageIndex>
+    struct eigen_triplet {
+        eigen_triplet() = default;
+        eigen_triplet(const StorageIndex& r, const StorageIndex& c, const Scalar& v) : r(r), c(c), v(v) {}
+
+        [[nodiscard]] const StorageIndex& row() const { return r; }
+        [[nodiscard]] const StorageIndex& col() const { return c; }
+        [[nodiscard]] const Scalar& value() const { return v; }
+
+        StorageIndex r;
+        StorageIndex c;
+        Scalar v;
+    };
+
     /**
      * Read Matrix Market file into an Eigen matrix and a header struct.
      */
@@ -28,24 +46,49 @@ namespace fast_matrix_market {
 
         typedef typename SparseType::Scalar Scalar;
         typedef typename SparseType::StorageIndex StorageIndex;
-        typedef Eigen::Triplet<Scalar, StorageIndex> Triplet;
+        typedef eigen_triplet<Scalar, StorageIndex> Triplet;
 
         read_header(instream, header);
         mat.resize(header.nrows, header.ncols);
 
         // Sanitize symmetry generalization settings
-        if (options.generalize_symmetry && options.generalize_symmetry_app) {
-            // setFromTriplets() drops zero elements
-            options.generalize_coordinate_diagnonal_values = read_options::ExtraZeroElement;
+        bool app_generalize = false;
+        deferred_permutation permutation;
+        if (use_app_symmetry_generalization(options)) {
+            app_generalize = true;
+            options.generalize_symmetry = false;
+            permutation = defer_permutation(options, header);
         }
 
         // read into tuples
-        std::vector<Triplet> elements;
+        uninitialized_vector<Triplet> elements;
         elements.resize(get_storage_nnz(header, options));
 
         auto handler = tuple_parse_handler<StorageIndex, Scalar, decltype(elements.begin())>(elements.begin());
         read_matrix_market_body(instream, header, handler, default_pattern_value, options);
 
+        if (app_generalize && header.symmetry != general) {
+            generalize_symmetry_by_index(
+                    (int64_t)elements.size(),
+                    [&](int64_t i) {
+                        return elements[i].row() == elements[i].col();
+                    },
+                    [&](int64_t new_size) {
+                        elements.resize(new_size);
+                    },
+                    [&](int64_t i, int64_t dest) {
+                        const Triplet& t = elements[i];
+                        elements[dest] = Triplet(t.col(), t.row(), get_symmetric_value<Scalar>(t.value(), header.symmetry));
+                    },
+                    options);
+
+            if (!permutation.empty()) {
+                for (auto& t : elements) {
+                    t = Triplet(permutation.row(t.row()), permutation.col(t.col()), t.value());
+                }
+            }
+        }
+
         // set the values into the matrix
         mat.setFromTriplets(elements.begin(), elements.end());
     }
@@ -117,7 +160,7 @@ namespace fast_matrix_market {
                 // iterate over assigned columns
                 for (; outer_iter != outer_end; ++outer_iter) {
                     for (typename SparseMatrixType::InnerIterator it(mat, outer_iter); it; ++it) {
-                        chunk += line_formatter.coord_matrix(it.row(), it.col(), it.value());
+                        line_formatter.append_coord_matrix(chunk, it.row(), it.col(), it.value());
                     }
                 }
 
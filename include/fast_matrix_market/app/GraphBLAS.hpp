@@ -23,6 +23,7 @@ extern "C" {
 #define FMM_GXB_ITERATORS 0
 #define FMM_GXB_PACK_UNPACK 0
 #define FMM_GXB_TYPE_NAME 0
+#define FMM_GXB_ISO 0
 #endif
 
 // Switch to allow using the SuiteSparse:GraphBLAS complex number extension
@@ -60,6 +61,11 @@ extern "C" {
 #define FMM_GXB_TYPE_NAME 1
 #endif
 
+// Switch to allow using GxB_Matrix_iso to detect iso-valued matrices
+#ifndef FMM_GXB_ISO
+#define FMM_GXB_ISO 1
+#endif
+
 
 namespace fast_matrix_market {
 
@@ -543,6 +549,28 @@ namespace fast_matrix_market {
     };
 #endif
 
+    /**
+     * Minimal resizable value array. Cannot use std::vector due to bool specialization.
+     */
+    template <typename T>
+    class graphblas_value_buffer {
+    public:
+        void resize(std::size_t new_size) {
+            auto new_data = make_uninitialized_array<T>(new_size);
+            std::copy(data.get(), data.get() + std::min(size, new_size), new_data.get());
+            data = std::move(new_data);
+            size = new_size;
+        }
+
+        T* begin() {
+            return data.get();
+        }
+
+    protected:
+        std::unique_ptr<T[]> data;
+        std::size_t size = 0;
+    };
+
     /**
      * Read a Matrix Market coordinate body into a sparse GraphBLAS matrix using triplets.
      */
@@ -554,43 +582,99 @@ namespace fast_matrix_market {
         size_t storage_nnz = get_storage_nnz(header, options);
 
         // Read into triplets
-        std::vector<GrB_Index> rows(storage_nnz);
-        std::vector<GrB_Index> cols(storage_nnz);
+        uninitialized_vector<GrB_Index> rows(storage_nnz);
+        uninitialized_vector<GrB_Index> cols(storage_nnz);
 
         // Sanitize symmetry generalization settings
-        if (options.generalize_symmetry && options.generalize_symmetry_app) {
-            // Matrix construction drops zero elements
-            options.generalize_coordinate_diagnonal_values = read_options::ExtraZeroElement;
-        }
+        bool app_generalize = false;
+        deferred_permutation permutation;
+        if (use_app_symmetry_generalization(options)) {
+            app_generalize = true;
+            options.generalize_symmetry = false;
+            permutation = defer_permutation(options, header);
+        }
+        size_t read_nnz = get_storage_nnz(header, options);
+
+        // Generalize symmetry into the already-allocated space. Diagonals are not duplicated.
+        // vals may be nullptr for pattern matrices.
+        auto generalize = [&](T* vals) {
+            if (!app_generalize || header.symmetry == general) {
+                return read_nnz;
+            }
+
+            size_t generalized_nnz = read_nnz;
+            generalize_symmetry_by_index(
+                    (int64_t)read_nnz,
+                    [&](int64_t i) {
+                        return rows[i] == cols[i];
+                    },
+                    [&](int64_t new_size) {
+                        generalized_nnz = new_size;
+                    },
+                    [&](int64_t i, int64_t dest) {
+                        rows[dest] = cols[i];
+                        cols[dest] = rows[i];
+                        if (vals != nullptr) {
+                            vals[dest] = get_symmetric_value<T>(vals[i], header.symmetry);
+                        }
+                    },
+                    options);
+
+            if (!permutation.empty()) {
+                for (size_t i = 0; i < generalized_nnz; ++i) {
+                    rows[i] = permutation.row(rows[i]);
+                    cols[i] = permutation.col(cols[i]);
+                }
+            }
+            return generalized_nnz;
+        };
 
 #if FMM_GXB_BUILD_SCALAR
+        // Build an iso matrix, i.e. one where every element has the same value.
+        auto build_iso = [&](const T& value, size_t nnz) {
+            GrB_Scalar scalar;
+            ok(GrB_Scalar_new(&scalar, GraphBLAS_typed<T>::type()));
+            ok(GraphBLAS_typed<T>::set_element(scalar, value));
+
+            ok(GxB_Matrix_build_Scalar(mat, rows.data(), cols.data(), scalar, nnz));
+
+            ok(GrB_Scalar_free(&scalar));
+        };
+
         if (header.field == pattern) {
             // read the indices
             auto handler = triplet_pattern_parse_handler(rows.begin(), cols.begin());
             read_matrix_market_body_no_adapters(instream, header, handler, options);
+            size_t nnz = generalize(nullptr);
+
+            build_iso(pattern_default_value(static_cast<T*>(nullptr)), nnz);
+        } else if (!app_generalize || header.symmetry == general || header.symmetry == symmetric) {
+            // Read indices and values, but only allocate the values if they are not all equal.
+            // Skew-symmetric and hermitian generalization would make the mirrored values differ.
+            graphblas_value_buffer<T> vals;
+            auto handler = triplet_iso_parse_handler(rows.begin(), cols.begin(), vals, (int64_t)storage_nnz);
+            read_matrix_market_body(instream, header, handler, pattern_default_value(static_cast<T*>(nullptr)), options);
 
-            // create the scalar
-            GrB_Scalar one;
-            ok(GrB_Scalar_new(&one, GraphBLAS_typed<T>::type()));
-            ok(GraphBLAS_typed<T>::set_element(one, pattern_default_value(static_cast<T*>(nullptr))));
-
-            // Build iso matrix
-            ok(GxB_Matrix_build_Scalar(mat, rows.data(), cols.data(), one, storage_nnz));
-
-            // clean up
-            ok(GrB_Scalar_free(&one));
+            if (handler.finish()) {
+                size_t nnz = generalize(nullptr);
+                build_iso(*vals.begin(), nnz);
+            } else {
+                size_t nnz = generalize(vals.begin());
+                ok(GraphBLAS_typed<T>::build_matrix(mat, rows.data(), cols.data(), vals.begin(), nnz));
+            }
         } else
 #endif
         {
             // Allocate values. Cannot use std::vector due to bool specialization
-            auto vals = std::make_unique<T[]>(storage_nnz);
+            auto vals = make_uninitialized_array<T>(storage_nnz);
 
             // read indices and values
             auto handler = triplet_parse_handler(rows.begin(), cols.begin(), vals.get());
             read_matrix_market_body(instream, header, handler, pattern_default_value(static_cast<T*>(nullptr)), options);
+            size_t nnz = generalize(vals.get());
 
             // build matrix from triplets
-            ok(GraphBLAS_typed<T>::build_matrix(mat, rows.data(), cols.data(), vals.get(), storage_nnz));
+            ok(GraphBLAS_typed<T>::build_matrix(mat, rows.data(), cols.data(), vals.get(), nnz));
         }
     }
 
@@ -764,6 +848,22 @@ namespace fast_matrix_market {
         read_matrix_market_graphblas(instream, header, mat, options, desired_type);
     }
 
+    /**
+     * If the matrix is iso-valued then all values are equal, so the line formatter only needs to format one of them.
+     */
+    template <typename LF, typename T>
+    void set_iso_value_if_iso([[maybe_unused]] LF& lf,
+                              [[maybe_unused]] const GrB_Matrix& mat,
+                              [[maybe_unused]] const T* vals,
+                              [[maybe_unused]] GrB_Index nvals) {
+#if FMM_GXB_ISO
+        bool iso = false;
+        if (nvals > 0 && GxB_Matrix_iso(&iso, mat) == GrB_SUCCESS && iso) {
+            lf.set_iso_value(vals[0]);
+        }
+#endif
+    }
+
     /**
      * Write a GraphBLAS matrix to a coordinate MatrixMarket body by using GrB_Matrix_extractTuples.
      */
@@ -772,9 +872,9 @@ namespace fast_matrix_market {
                                       matrix_market_header &header,
                                       const GrB_Matrix& mat,
                                       const write_options& options) {
-        std::vector<GrB_Index> rows(header.nnz);
-        std::vector<GrB_Index> cols(header.nnz);
-        auto vals = std::make_unique<T[]>(header.nnz); // Cannot use vector due to bool specialization
+        uninitialized_vector<GrB_Index> rows(header.nnz);
+        uninitialized_vector<GrB_Index> cols(header.nnz);
+        auto vals = make_uninitialized_array<T>(header.nnz); // Cannot use vector due to bool specialization
 
         GrB_Index nvals = header.nnz;
         auto ec = GraphBLAS_typed<T>::GrB_Matrix_extractTuples(rows.data(), cols.data(), vals.get(), &nvals, mat);
@@ -782,6 +882,9 @@ namespace fast_matrix_market {
             throw fast_matrix_market::invalid_argument("GrB_Matrix_extractTuples returned " + std::to_string(ec));
         }
         line_formatter<GrB_Index, T> lf(header, options);
+        if (header.field != pattern) {
+            set_iso_value_if_iso(lf, mat, vals.get(), nvals);
+        }
         auto formatter = triplet_formatter(lf,
                                            rows.cbegin(), rows.cend(),
                                            cols.cbegin(), cols.cend(),
@@ -986,7 +1089,7 @@ namespace fast_matrix_market {
                         auto[row, col] = IMPL::to_row_col(major, minor);
 
                         const T& value = GraphBLAS_typed<T>::GxB_Iterator_get(iterator);
-                        chunk += line_formatter.coord_matrix(row, col, value);
+                        line_formatter.append_coord_matrix(chunk, row, col, value);
 
                         // move to the next entry
                         info = IMPL::nextMinor(iterator);
@@ -1054,11 +1157,12 @@ namespace fast_matrix_market {
                                                     matrix_market_header &header,
                                                     const GrB_Matrix& mat,
                                                     const write_options& options) {
-        std::unique_ptr<T[]> vals = std::make_unique<T[]>(header.nnz); // Cannot use vector due to bool specialization
+        std::unique_ptr<T[]> vals = make_uninitialized_array<T>(header.nnz); // Cannot use vector due to bool specialization
         GrB_Index nvals = header.nnz;
         ok(GraphBLAS_typed<T>::GrB_Matrix_extractTuples(nullptr, nullptr, vals.get(), &nvals, mat));
 
         line_formatter<GrB_Index, T> lf(header, options);
+        set_iso_value_if_iso(lf, mat, vals.get(), nvals);
         auto formatter = array_formatter(lf, vals.get(), row_major, header.nrows, header.ncols);
         write_body(os, formatter, options);
     }
@@ -1076,11 +1180,11 @@ namespace fast_matrix_market {
                                                 const write_options& options) {
         std::unique_ptr<T[]> sorted_vals; // Cannot use vector due to bool specialization
         {
-            auto vals = std::make_unique<T[]>(header.nnz); // Cannot use vector due to bool specialization
-            std::vector<std::size_t> perm(header.nnz);
+            auto vals = make_uninitialized_array<T>(header.nnz); // Cannot use vector due to bool specialization
+            uninitialized_vector<std::size_t> perm(header.nnz);
             {
-                std::vector<GrB_Index> rows(header.nnz);
-                std::vector<GrB_Index> cols(header.nnz);
+                uninitialized_vector<GrB_Index> rows(header.nnz);
+                uninitialized_vector<GrB_Index> cols(header.nnz);
 
                 GrB_Index nvals = header.nnz;
                 ok(GraphBLAS_typed<T>::GrB_Matrix_extractTuples(rows.data(), cols.data(), vals.get(), &nvals, mat));
@@ -1098,7 +1202,7 @@ namespace fast_matrix_market {
                           });
             }
             // Apply permutation
-            sorted_vals = std::make_unique<T[]>(header.nnz);;
+            sorted_vals = make_uninitialized_array<T>(header.nnz);
             std::transform(perm.begin(), perm.end(), sorted_vals.get(), [&](auto i) { return vals[i]; });
         }
 
@@ -1307,9 +1411,9 @@ namespace fast_matrix_market {
                              GrB_Vector vec,
                              const read_options& options) {
         // Read into doublets
-        std::vector<GrB_Index> inds(header.nnz);
+        uninitialized_vector<GrB_Index> inds(header.nnz);
         // Allocate values. Cannot use std::vector due to bool specialization
-        auto vals = std::make_unique<T[]>(header.nnz);
+        auto vals = make_uninitialized_array<T>(header.nnz);
 
         auto handler = doublet_parse_handler(inds.begin(), vals.get());
         read_matrix_market_body(instream, header, handler, pattern_default_value(static_cast<T*>(nullptr)), options);
@@ -1396,8 +1500,8 @@ namespace fast_matrix_market {
                                       matrix_market_header &header,
                                       const GrB_Vector& vec,
                                       const write_options& options) {
-        std::vector<GrB_Index> indices(header.nnz);
-        auto vals = std::make_unique<T[]>(header.nnz); // Cannot use vector due to bool specialization
+        uninitialized_vector<GrB_Index> indices(header.nnz);
+        auto vals = make_uninitialized_array<T>(header.nnz); // Cannot use vector due to bool specialization
 
         GrB_Index nvals = header.nnz;
         ok(GraphBLAS_typed<T>::GrB_Vector_extractTuples(indices.data(), vals.get(), &nvals, vec));
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <numeric>
+
 #include "../fast_matrix_market.hpp"
 
 namespace fast_matrix_market {
@@ -87,6 +89,69 @@ namespace fast_matrix_market {
         read_matrix_market_array(instream, header, values, order, options);
     }
 
+    /**
+     * Leading dimension for a dense block with `n` elements per column (column-major) or per row (row-major), padded
+     * so that each column (row) starts on an `alignment_bytes` boundary. Assumes the buffer itself is so aligned.
+     *
+     * Use 64 for cache line alignment.
+     */
+    template <typename VT>
+    int64_t get_aligned_leading_dimension(int64_t n, int64_t alignment_bytes = 64) {
+        if (alignment_bytes <= 0) {
+            return n;
+        }
+        // smallest multiple of elements whose byte length is a multiple of alignment_bytes
+        const int64_t step = alignment_bytes / std::gcd(alignment_bytes, (int64_t)sizeof(VT));
+        return (n + step - 1) / step * step;
+    }
+
+    /**
+     * Read a Matrix Market file into a strided view of a preallocated dense buffer.
+     *
+     * Element (row, col) is written to values[(row + row_offset) * ld + (col + col_offset)] if `order` is row_major,
+     * or values[(col + col_offset) * ld + (row + row_offset)] if `order` is col_major. This allows loading directly
+     * into a block of a larger matrix, or into a padded layout (see get_aligned_leading_dimension()).
+     *
+     * The nrows-by-ncols block is zeroed before reading. Elements outside of it are not touched.
+     *
+     * @param values random access iterator (or pointer) to the start of the buffer.
+     * @param ld leading dimension, i.e. distance between the start of consecutive columns (col_major)
+     * or rows (row_major).
+     */
+    template <typename VT_ITER>
+    void read_matrix_market_array_strided(std::istream &instream,
+                                          matrix_market_header& header,
+                                          VT_ITER values,
+                                          int64_t ld,
+                                          storage_order order = row_major,
+                                          int64_t row_offset = 0,
+                                          int64_t col_offset = 0,
+                                          const read_options& options = {}) {
+        using VT = typename std::iterator_traits<VT_ITER>::value_type;
+
+        read_header(instream, header);
+
+        if (row_offset < 0 || col_offset < 0) {
+            throw invalid_argument("Negative offset.");
+        }
+
+        const int64_t major_offset = (order == row_major ? row_offset : col_offset);
+        const int64_t minor_offset = (order == row_major ? col_offset : row_offset);
+        const int64_t major_dim = (order == row_major ? header.nrows : header.ncols);
+        const int64_t minor_dim = (order == row_major ? header.ncols : header.nrows);
+
+        if (ld < minor_offset + minor_dim) {
+            throw invalid_argument("Leading dimension is too small for the matrix block.");
+        }
+
+        for (int64_t major = 0; major < major_dim; ++major) {
+            std::fill_n(values + ((major + major_offset) * ld + minor_offset), minor_dim, VT{});
+        }
+
+        auto handler = dense_adding_parse_handler(values, order, ld, row_offset, col_offset);
+        read_matrix_market_body(instream, header, handler, 1, options);
+    }
+
     /**
      * Write an array to a Matrix Market file.
      */
@@ -0,0 +1,182 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+#include "../fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Maps a row or column index to its part, given part boundaries.
+     *
+     * Part `p` owns indices [splits[p], splits[p+1]).
+     */
+    class index_splitter {
+    public:
+        index_splitter(std::vector<int64_t> splits_in, int64_t n) : splits(std::move(splits_in)) {
+            if (splits.size() < 2 || splits.front() != 0 || splits.back() != n ||
+                    !std::is_sorted(splits.begin(), splits.end())) {
+                throw invalid_argument("Splits must be non-decreasing, start at 0, and end at the dimension.");
+            }
+        }
+
+        [[nodiscard]] int64_t num_parts() const {
+            return (int64_t)splits.size() - 1;
+        }
+
+        [[nodiscard]] int64_t part_of(int64_t index) const {
+            return (int64_t)(std::upper_bound(splits.begin() + 1, splits.end() - 1, index) - splits.begin()) - 1;
+        }
+
+        [[nodiscard]] int64_t part_start(int64_t part) const {
+            return splits[part];
+        }
+
+    protected:
+        std::vector<int64_t> splits;
+    };
+
+    /**
+     * Parse handler that routes each element to the 2D block that owns it.
+     *
+     * Each chunk handler collects its elements into per-block buffers. finish() sizes each block's output with the
+     * buffer sizes and copies the buffers in file order. The file is only parsed once and elements are only
+     * copied once after parsing.
+     */
+    template <typename IT, typename VT>
+    class block_partition_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk | kAppending;
+
+        block_partition_parse_handler(const index_splitter& row_splitter, const index_splitter& col_splitter) :
+                row_splitter(row_splitter), col_splitter(col_splitter),
+                state(std::make_shared<shared_state>()) {
+            buffers = state->add_chunk(0, num_blocks());
+        }
+
+        void handle(const coordinate_type row, const coordinate_type col, const value_type value) {
+            int64_t block_row = row_splitter.part_of(row);
+            int64_t block_col = col_splitter.part_of(col);
+            (*buffers)[block_row * col_splitter.num_parts() + block_col].push_back(element{
+                    (IT)(row - row_splitter.part_start(block_row)),
+                    (IT)(col - col_splitter.part_start(block_col)),
+                    value});
+        }
+
+        block_partition_parse_handler<IT, VT> get_chunk_handler(int64_t offset_from_begin) {
+            block_partition_parse_handler ret(*this);
+            ret.buffers = state->add_chunk(offset_from_begin, num_blocks());
+            return ret;
+        }
+
+        /**
+         * Write each block's elements, with block-local indices, to rows[b], cols[b], values[b] where
+         * b = block_row * num_col_parts + block_col.
+         */
+        template <typename IVEC, typename VVEC>
+        void finish(std::vector<IVEC>& rows, std::vector<IVEC>& cols, std::vector<VVEC>& values) {
+            auto& chunks = state->chunks;
+            std::stable_sort(chunks.begin(), chunks.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            });
+
+            rows.resize(num_blocks());
+            cols.resize(num_blocks());
+            values.resize(num_blocks());
+
+            for (int64_t block = 0; block < num_blocks(); ++block) {
+                std::size_t block_nnz = 0;
+                for (const auto& [offset, chunk_buffers] : chunks) {
+                    block_nnz += (*chunk_buffers)[block].size();
+                }
+
+                rows[block].resize(block_nnz);
+                cols[block].resize(block_nnz);
+                values[block].resize(block_nnz);
+
+                std::size_t i = 0;
+                for (auto& [offset, chunk_buffers] : chunks) {
+                    auto& buffer = (*chunk_buffers)[block];
+                    for (const auto& e : buffer) {
+                        rows[block][i] = e.row;
+                        cols[block][i] = e.col;
+                        values[block][i] = e.value;
+                        ++i;
+                    }
+                    std::vector<element>().swap(buffer);
+                }
+            }
+        }
+
+    protected:
+        struct element {
+            IT row;
+            IT col;
+            VT value;
+        };
+
+        using chunk_buffers = std::vector<std::vector<element>>;
+
+        class shared_state {
+        public:
+            std::shared_ptr<chunk_buffers> add_chunk(int64_t offset, int64_t num_blocks) {
+                auto ret = std::make_shared<chunk_buffers>(num_blocks);
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks.emplace_back(offset, ret);
+                return ret;
+            }
+
+            std::mutex mutex;
+            std::vector<std::pair<int64_t, std::shared_ptr<chunk_buffers>>> chunks;
+        };
+
+        [[nodiscard]] int64_t num_blocks() const {
+            return row_splitter.num_parts() * col_splitter.num_parts();
+        }
+
+        index_splitter row_splitter;
+        index_splitter col_splitter;
+        std::shared_ptr<shared_state> state;
+        std::shared_ptr<chunk_buffers> buffers;
+    };
+
+    /**
+     * Read a Matrix Market file into a 2D grid of triplets, such as for distributing a matrix over a P x Q grid
+     * of processes.
+     *
+     * Block row `p` owns rows [row_splits[p], row_splits[p+1]) and block column `q` owns columns
+     * [col_splits[q], col_splits[q+1]). The splits must start at 0 and end at nrows (resp. ncols).
+     *
+     * Block (p, q) is written to rows[p * Q + q], cols[p * Q + q], values[p * Q + q], where Q = col_splits.size() - 1.
+     * Indices are local to the block. Within a block, elements are in file order.
+     * Symmetry is generalized during the parse, if enabled.
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_triplet_blocks(std::istream &instream,
+                                           matrix_market_header& header,
+                                           const std::vector<int64_t>& row_splits,
+                                           const std::vector<int64_t>& col_splits,
+                                           std::vector<IVEC>& rows, std::vector<IVEC>& cols,
+                                           std::vector<VVEC>& values,
+                                           const read_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(rows.front().begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.front().begin())>::value_type;
+
+        read_header(instream, header);
+
+        index_splitter row_splitter(row_splits, header.nrows);
+        index_splitter col_splitter(col_splits, header.ncols);
+
+        block_partition_parse_handler<IT, VT> handler(row_splitter, col_splitter);
+        read_matrix_market_body(instream, header, handler, pattern_default_value((const VT*)nullptr), options);
+        handler.finish(rows, cols, values);
+    }
+}
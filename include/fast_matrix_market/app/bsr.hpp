@@ -0,0 +1,255 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+
+#include "triplet.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Largest block size considered by detect_bsr_block_size().
+     */
+    constexpr int64_t kMaxDetectedBlockSize = 8;
+
+    /**
+     * Smallest fraction of a block's values that must be present for detect_bsr_block_size() to pick that block size.
+     */
+    constexpr double kMinDetectedBlockFill = 0.8;
+
+    /**
+     * Pick a BSR block size for a matrix given as a triplet.
+     *
+     * Tries block sizes from kMaxDetectedBlockSize down to 2 that divide both dimensions, and returns the largest
+     * one whose blocks are at least kMinDetectedBlockFill full. Returns 1 if no block size qualifies.
+     *
+     * Only a sample of rows is examined: evenly spaced windows of 840 rows, the least common multiple of all
+     * candidate block sizes, so that no candidate block straddles a window edge.
+     */
+    template <typename IVEC>
+    int64_t detect_bsr_block_size(const IVEC& rows, const IVEC& cols, int64_t nrows, int64_t ncols) {
+        constexpr int64_t window_rows = 840;
+        constexpr int64_t target_windows = 16;
+
+        int64_t num_windows = (nrows + window_rows - 1) / window_rows;
+        int64_t window_stride = std::max(num_windows / target_windows, (int64_t)1);
+
+        std::vector<std::size_t> sample;
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            if (((int64_t)rows[i] / window_rows) % window_stride == 0) {
+                sample.push_back(i);
+            }
+        }
+        if (sample.empty()) {
+            return 1;
+        }
+
+        std::vector<int64_t> keys(sample.size());
+        for (int64_t block_size = kMaxDetectedBlockSize; block_size > 1; --block_size) {
+            if (nrows % block_size != 0 || ncols % block_size != 0) {
+                continue;
+            }
+
+            int64_t num_block_cols = ncols / block_size;
+            for (std::size_t i = 0; i < sample.size(); ++i) {
+                keys[i] = ((int64_t)rows[sample[i]] / block_size) * num_block_cols + (int64_t)cols[sample[i]] / block_size;
+            }
+            std::sort(keys.begin(), keys.end());
+            auto num_blocks = std::unique(keys.begin(), keys.end()) - keys.begin();
+
+            double fill = (double)sample.size() / (double)(num_blocks * block_size * block_size);
+            if (fill >= kMinDetectedBlockFill) {
+                return block_size;
+            }
+        }
+        return 1;
+    }
+
+    /**
+     * Assemble a block sparse row (BSR) matrix from a triplet, in parallel if allowed.
+     *
+     * Blocks are `block_size` x `block_size` and stored in row-major order in `values`. Block columns within a
+     * block row are sorted. Duplicate elements are summed, and block values not present in the triplet are zero.
+     */
+    template <typename TRIPLET_IVEC, typename TRIPLET_VVEC, typename IVEC, typename VVEC>
+    void triplet_to_bsr(const TRIPLET_IVEC& rows, const TRIPLET_IVEC& cols, const TRIPLET_VVEC& vals,
+                        int64_t nrows, int64_t ncols, int64_t block_size,
+                        IVEC& indptr, IVEC& indices, VVEC& values,
+                        const read_options& options = {}) {
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        if (block_size <= 0 || nrows % block_size != 0 || ncols % block_size != 0) {
+            throw invalid_argument("Block size must divide both matrix dimensions.");
+        }
+
+        const int64_t num_block_rows = nrows / block_size;
+        const int64_t block_values = block_size * block_size;
+        const auto nnz = (int64_t)rows.size();
+
+        // Bucket the elements by block row.
+        std::vector<int64_t> row_starts(num_block_rows + 1, 0);
+        for (int64_t i = 0; i < nnz; ++i) {
+            ++row_starts[(int64_t)rows[i] / block_size + 1];
+        }
+        std::partial_sum(row_starts.begin(), row_starts.end(), row_starts.begin());
+
+        std::vector<int64_t> order(nnz);
+        {
+            std::vector<int64_t> next(row_starts.begin(), row_starts.end() - 1);
+            for (int64_t i = 0; i < nnz; ++i) {
+                order[next[(int64_t)rows[i] / block_size]++] = i;
+            }
+        }
+
+        // Split the block rows into ranges that are processed in parallel.
+        int64_t num_ranges = 1;
+        bool parallel_ok = limit_parallelism_for_value_type<VT>(options.parallel_ok);
+        if (parallel_ok && options.num_threads != 1) {
+            int64_t num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+            int64_t min_range_size = std::max(options.chunk_size_bytes / 16, (int64_t)1);
+            num_ranges = std::max(std::min(num_threads, nnz / min_range_size), (int64_t)1);
+        }
+
+        std::vector<int64_t> range_starts(num_ranges + 1);
+        for (int64_t range = 0; range <= num_ranges; ++range) {
+            // balance the ranges by element count
+            int64_t target = nnz * range / num_ranges;
+            range_starts[range] = std::lower_bound(row_starts.begin(), row_starts.end(), target) - row_starts.begin();
+        }
+        range_starts[num_ranges] = num_block_rows;
+
+        // Block columns of each block row. Unique block columns are stored at the start of the block row's bucket.
+        std::vector<int64_t> block_cols(nnz);
+        std::vector<int64_t> block_counts(num_block_rows + 1, 0);
+
+        auto find_blocks = [&](int64_t range) {
+            for (int64_t block_row = range_starts[range]; block_row < range_starts[range + 1]; ++block_row) {
+                auto begin = block_cols.begin() + row_starts[block_row];
+                auto end = block_cols.begin() + row_starts[block_row + 1];
+                for (auto it = begin; it != end; ++it) {
+                    *it = (int64_t)cols[order[it - block_cols.begin()]] / block_size;
+                }
+                std::sort(begin, end);
+                block_counts[block_row + 1] = std::unique(begin, end) - begin;
+            }
+        };
+
+        auto fill_blocks = [&](int64_t range) {
+            for (int64_t block_row = range_starts[range]; block_row < range_starts[range + 1]; ++block_row) {
+                auto src = block_cols.begin() + row_starts[block_row];
+                auto dest_begin = indices.begin() + block_counts[block_row];
+                auto dest_end = indices.begin() + block_counts[block_row + 1];
+                std::copy(src, src + (dest_end - dest_begin), dest_begin);
+
+                for (int64_t j = row_starts[block_row]; j < row_starts[block_row + 1]; ++j) {
+                    int64_t i = order[j];
+                    auto block = std::lower_bound(dest_begin, dest_end, (int64_t)cols[i] / block_size) - indices.begin();
+                    auto v = block * block_values +
+                             ((int64_t)rows[i] % block_size) * block_size + (int64_t)cols[i] % block_size;
+                    values[v] = values[v] + vals[i];
+                }
+            }
+        };
+
+        auto run = [&](auto func) {
+            if (num_ranges == 1) {
+                func(0);
+                return;
+            }
+            task_thread_pool::task_thread_pool pool((unsigned int)num_ranges);
+            std::vector<std::future<void>> futures;
+            for (int64_t range = 0; range < num_ranges; ++range) {
+                futures.push_back(pool.submit(func, range));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+        };
+
+        run(find_blocks);
+
+        std::partial_sum(block_counts.begin(), block_counts.end(), block_counts.begin());
+        indptr.resize(num_block_rows + 1);
+        std::copy(block_counts.begin(), block_counts.end(), indptr.begin());
+
+        indices.resize(block_counts[num_block_rows]);
+        values.resize(0);
+        values.resize(block_counts[num_block_rows] * block_values, get_zero<VT>());
+
+        run(fill_blocks);
+    }
+
+    /**
+     * Read a Matrix Market file into a block sparse row (BSR) matrix.
+     *
+     * @param block_size block size to use. If 0 then the block size is detected with detect_bsr_block_size().
+     *                   Set to the block size that was used.
+     * @param indptr block row pointers, length nrows / block_size + 1
+     * @param indices block column of each block
+     * @param values block_size x block_size values of each block, row-major
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_bsr(std::istream &instream,
+                                matrix_market_header& header,
+                                int64_t& block_size,
+                                IVEC& indptr, IVEC& indices, VVEC& values,
+                                const read_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(indices.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        read_options triplet_options = options;
+        triplet_options.structure_only = false;
+
+        uninitialized_vector<IT> rows, cols;
+        uninitialized_vector<VT> vals;
+        read_matrix_market_triplet(instream, header, rows, cols, vals, triplet_options);
+
+        if (block_size <= 0) {
+            block_size = detect_bsr_block_size(rows, cols, header.nrows, header.ncols);
+        }
+
+        triplet_to_bsr(rows, cols, vals, header.nrows, header.ncols, block_size, indptr, indices, values, options);
+    }
+
+    /**
+     * Write a block sparse row (BSR) matrix to a Matrix Market file.
+     *
+     * header.nrows and header.ncols must be set. Every value of every block is written.
+     * If `values` is empty then a pattern file is written.
+     */
+    template <typename IVEC, typename VVEC>
+    void write_matrix_market_bsr(std::ostream &os,
+                                 matrix_market_header header,
+                                 int64_t block_size,
+                                 const IVEC& indptr,
+                                 const IVEC& indices,
+                                 const VVEC& values,
+                                 const write_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(indptr.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        header.nnz = (int64_t)indices.size() * block_size * block_size;
+
+        header.object = matrix;
+        if (header.nnz > 0 && (values.cbegin() == values.cend())) {
+            header.field = pattern;
+        } else if (header.field != pattern && options.fill_header_field_type) {
+            header.field = get_field_type((const VT *) nullptr);
+        }
+        header.format = coordinate;
+
+        write_header(os, header, options);
+
+        line_formatter<IT, VT> lf(header, options);
+        auto formatter = bsr_formatter(lf,
+                                       indptr.cbegin(), indptr.cend() - 1,
+                                       indices.cbegin(), indices.cend(),
+                                       values.cbegin(), header.field == pattern ? values.cbegin() : values.cend(),
+                                       block_size);
+        write_body(os, formatter, options);
+    }
+}
@@ -0,0 +1,195 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/**
+ * Collective write of one Matrix Market file by several participants, such as MPI ranks, that each hold some
+ * of the elements. Each participant formats its own elements, and writes them directly to its place in the file.
+ * Requires POSIX `pwrite()`.
+ */
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+
+    struct exclusive_scan_result {
+        /**
+         * Sum of the values of all participants before this one.
+         */
+        std::vector<int64_t> prefix;
+
+        /**
+         * Sum of the values of all participants.
+         */
+        std::vector<int64_t> total;
+    };
+
+    /**
+     * Elementwise exclusive prefix sum and total over all participants of a collective write.
+     *
+     * Each participant calls its exchange with its local values, and the call returns once every participant
+     * has made the matching call. With MPI this is an `MPI_Exscan` and an `MPI_Allreduce` of `MPI_SUM`
+     * (note that MPI_Exscan leaves rank 0's result undefined; it must be zero).
+     */
+    using collective_exchange = std::function<exclusive_scan_result(const std::vector<int64_t>& local)>;
+
+    /**
+     * collective_exchange among threads of one process.
+     *
+     * Call `exchange(participant, local)` from each participant's thread, or use `get_exchange(participant)`.
+     */
+    class thread_exchange {
+    public:
+        explicit thread_exchange(int num_participants) : num_participants(num_participants), values(num_participants) {}
+
+        exclusive_scan_result exchange(int participant, const std::vector<int64_t>& local) {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto my_generation = generation;
+            values[participant] = local;
+
+            if (++num_arrived == num_participants) {
+                results.assign(num_participants, exclusive_scan_result());
+                std::vector<int64_t> sum(local.size(), 0);
+                for (int p = 0; p < num_participants; ++p) {
+                    results[p].prefix = sum;
+                    for (std::size_t i = 0; i < sum.size(); ++i) {
+                        sum[i] += values[p][i];
+                    }
+                }
+                for (auto& result : results) {
+                    result.total = sum;
+                }
+
+                num_arrived = 0;
+                ++generation;
+                cv.notify_all();
+            } else {
+                // The results are not overwritten until this participant arrives at the next exchange.
+                cv.wait(lock, [&] { return generation != my_generation; });
+            }
+            return results[participant];
+        }
+
+        collective_exchange get_exchange(int participant) {
+            return [this, participant](const std::vector<int64_t>& local) { return exchange(participant, local); };
+        }
+
+    protected:
+        const int num_participants;
+        std::mutex mutex;
+        std::condition_variable cv;
+        int num_arrived = 0;
+        int64_t generation = 0;
+        std::vector<std::vector<int64_t>> values;
+        std::vector<exclusive_scan_result> results;
+    };
+
+    /**
+     * Write `data` at `offset` of the file, retrying short writes.
+     */
+    inline void pwrite_all(int fd, const char* data, std::size_t count, int64_t offset) {
+        while (count > 0) {
+            auto written = ::pwrite(fd, data, count, (off_t)offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw fmm_error(std::string("pwrite failed: ") + std::strerror(errno));
+            }
+            data += written;
+            count -= (std::size_t)written;
+            offset += written;
+        }
+    }
+
+    /**
+     * Write a triplet to a Matrix Market file, where each participant of `exchange` holds some of the elements.
+     *
+     * Every participant calls this method with the same `path` and `header`, and its own elements. The file
+     * has the elements of the first participant (in exchange order) first, then those of the second, and so on.
+     *
+     * Each participant formats its elements in memory (in parallel, see write_options), then learns its byte offset
+     * from an exclusive prefix sum of the formatted sizes and `pwrite()`s its bytes there. The first participant
+     * also writes the header, with the global nnz. There is no gather of elements to a single writer.
+     *
+     * `exchange` is called twice.
+     */
+    template <typename IVEC, typename VVEC>
+    void write_matrix_market_triplet_collective(const std::string& path,
+                                                matrix_market_header header,
+                                                const IVEC& rows,
+                                                const IVEC& cols,
+                                                const VVEC& values,
+                                                const collective_exchange& exchange,
+                                                const write_options& options = {}) {
+        using IT = typename std::iterator_traits<decltype(rows.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        // Find this participant's position and the global nnz.
+        auto counts = exchange({1, (int64_t)rows.size(), values.cbegin() == values.cend() ? 0 : 1});
+        bool is_first = counts.prefix[0] == 0;
+        header.nnz = counts.total[1];
+
+        header.object = matrix;
+        if (header.nnz > 0 && counts.total[2] == 0) {
+            // no participant has values
+            header.field = pattern;
+        } else if (header.field != pattern && options.fill_header_field_type) {
+            header.field = get_field_type((const VT *) nullptr);
+        }
+        header.format = coordinate;
+
+        std::string chunk;
+        if (is_first) {
+            std::ostringstream oss;
+            write_header(oss, header, options);
+            chunk = oss.str();
+        }
+
+        string_sink sink(chunk);
+        line_formatter<IT, VT> lf(header, options);
+        auto formatter = triplet_formatter(lf,
+                                           rows.cbegin(), rows.cend(),
+                                           cols.cbegin(), cols.cend(),
+                                           values.cbegin(), header.field == pattern ? values.cbegin() : values.cend());
+        write_body(sink, formatter, options);
+
+        // Find this participant's byte offset.
+        auto sizes = exchange({(int64_t)chunk.size()});
+        int64_t offset = sizes.prefix[0];
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd < 0) {
+            throw fmm_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+        try {
+            if (is_first) {
+                // An existing file may be longer. Other participants only write below the new size.
+                if (::ftruncate(fd, (off_t)sizes.total[0]) != 0) {
+                    throw fmm_error(std::string("ftruncate failed: ") + std::strerror(errno));
+                }
+            }
+            pwrite_all(fd, chunk.data(), chunk.size(), offset);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        if (::close(fd) != 0) {
+            throw fmm_error("Cannot close " + path + ": " + std::strerror(errno));
+        }
+    }
+}
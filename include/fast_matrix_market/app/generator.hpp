@@ -39,7 +39,7 @@ namespace fast_matrix_market {
                     IT row, col;
                     VT value;
                     gen_callable(chunk_offset + i, row, col, value);
-                    chunk += line_formatter.coord_matrix(row, col, value);
+                    line_formatter.append_coord_matrix(chunk, row, col, value);
                 }
 
                 return chunk;
@@ -0,0 +1,389 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+
+#include "../fast_matrix_market.hpp"
+#include "../thirdparty/task_thread_pool.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Parse handler that keeps a random sample of the elements.
+     *
+     * Every element is assigned a uniform random key by hashing the seed and the element's position in the file, so the
+     * sample does not depend on thread scheduling or chunk size:
+     *  - rate > 0: Bernoulli sampling, keep elements whose key is below `rate`.
+     *  - sample_size > 0: keep the `sample_size` elements with the smallest keys. This is a uniform sample without
+     *    replacement that can be merged across chunks. A shared threshold means that once any chunk's sample is full
+     *    most elements are rejected early.
+     *
+     * Each chunk handler keeps its own sample without locking. The samples are merged in finish().
+     */
+    template <typename IT, typename VT>
+    class sampling_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk;
+
+        sampling_parse_handler(double rate, int64_t sample_size, uint64_t seed) :
+                state(std::make_shared<shared_state>(rate, sample_size)), sample(state->add_chunk(0)), seed(seed) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, const value_type value) {
+            int64_t index = offset + num_handled;
+            ++num_handled;
+            double key = element_key(seed, index);
+
+            if (key < state->threshold.load(std::memory_order_relaxed)) {
+                add(element{index, key, row, col, value});
+            }
+        }
+
+        /**
+         * Handler that keeps every element. Keys are in [0, 1), so a rate of 1 rejects none.
+         */
+        static sampling_parse_handler<IT, VT> keep_all() {
+            return sampling_parse_handler(1.0, 0, 0);
+        }
+
+        sampling_parse_handler<IT, VT> get_chunk_handler(int64_t offset_from_begin) {
+            sampling_parse_handler ret(*this);
+            ret.sample = state->add_chunk(offset_from_begin);
+            ret.offset = offset_from_begin;
+            ret.num_handled = 0;
+            return ret;
+        }
+
+        /**
+         * Merge the chunks' samples and write the sampled elements, in file order.
+         */
+        template <typename IVEC, typename VVEC>
+        void finish(IVEC& rows, IVEC& cols, VVEC& values) {
+            auto& chunks = state->chunks;
+            std::stable_sort(chunks.begin(), chunks.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs->offset < rhs->offset;
+            });
+
+            std::size_t total = 0;
+            for (const auto& chunk : chunks) {
+                total += chunk->elements.size();
+            }
+            std::vector<element> elements;
+            elements.reserve(total);
+            for (const auto& chunk : chunks) {
+                elements.insert(elements.end(), chunk->elements.begin(), chunk->elements.end());
+            }
+
+            if (state->sample_size > 0) {
+                // Keep the smallest keys overall. Each chunk's heap is in key order, so restore file order.
+                if ((int64_t)elements.size() > state->sample_size) {
+                    std::nth_element(elements.begin(), elements.begin() + state->sample_size, elements.end(), key_less);
+                    elements.resize(state->sample_size);
+                }
+                std::sort(elements.begin(), elements.end(), [](const element& lhs, const element& rhs) {
+                    return lhs.index < rhs.index;
+                });
+            }
+
+            rows.resize(elements.size());
+            cols.resize(elements.size());
+            values.resize(elements.size());
+            for (std::size_t i = 0; i < elements.size(); ++i) {
+                rows[i] = elements[i].row;
+                cols[i] = elements[i].col;
+                values[i] = elements[i].value;
+            }
+        }
+
+    protected:
+        struct element {
+            int64_t index;
+            double key;
+            IT row;
+            IT col;
+            VT value;
+        };
+
+        static bool key_less(const element& lhs, const element& rhs) {
+            return lhs.key < rhs.key;
+        }
+
+        /**
+         * Elements kept by one chunk's handler.
+         */
+        struct chunk_sample {
+            explicit chunk_sample(int64_t offset) : offset(offset) {}
+
+            int64_t offset;
+            std::vector<element> elements;
+        };
+
+        class shared_state {
+        public:
+            shared_state(double rate, int64_t sample_size) : sample_size(sample_size),
+                                                             threshold(sample_size > 0 ? 1.0 : rate) {}
+
+            std::shared_ptr<chunk_sample> add_chunk(int64_t offset) {
+                auto chunk = std::make_shared<chunk_sample>(offset);
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks.push_back(chunk);
+                return chunk;
+            }
+
+            /**
+             * A full chunk sample whose largest key is `key` means the merged sample's keys are all below `key`.
+             */
+            void lower_threshold(double key) {
+                double current = threshold.load(std::memory_order_relaxed);
+                while (key < current && !threshold.compare_exchange_weak(current, key, std::memory_order_relaxed)) {}
+            }
+
+            int64_t sample_size;
+            std::atomic<double> threshold;
+            std::mutex mutex;
+            std::vector<std::shared_ptr<chunk_sample>> chunks;
+        };
+
+        void add(const element& e) {
+            auto& elements = sample->elements;
+            if (state->sample_size <= 0) {
+                elements.push_back(e);
+                return;
+            }
+
+            // max-heap on key holds this chunk's sample_size smallest keys
+            if ((int64_t)elements.size() < state->sample_size) {
+                elements.push_back(e);
+                std::push_heap(elements.begin(), elements.end(), key_less);
+            } else if (e.key < elements.front().key) {
+                std::pop_heap(elements.begin(), elements.end(), key_less);
+                elements.back() = e;
+                std::push_heap(elements.begin(), elements.end(), key_less);
+            }
+
+            if ((int64_t)elements.size() == state->sample_size) {
+                state->lower_threshold(elements.front().key);
+            }
+        }
+
+        static uint64_t splitmix64(uint64_t x) {
+            x += 0x9e3779b97f4a7c15ULL;
+            x = (x ^ (x >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27U)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31U);
+        }
+
+        /**
+         * Uniform key in [0, 1) for the element at `index`.
+         */
+        static double element_key(uint64_t seed, int64_t index) {
+            uint64_t bits = splitmix64(seed ^ splitmix64((uint64_t)index));
+            return (double)(bits >> 11U) * 0x1.0p-53;
+        }
+
+        std::shared_ptr<shared_state> state;
+        std::shared_ptr<chunk_sample> sample;
+        uint64_t seed;
+        int64_t offset = 0;
+        int64_t num_handled = 0;
+    };
+
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_body_triplet_sample(std::istream &instream,
+                                                const matrix_market_header& header,
+                                                IVEC& rows, IVEC& cols, VVEC& values,
+                                                double rate, int64_t sample_size, uint64_t seed,
+                                                read_options options) {
+        using IT = typename std::iterator_traits<decltype(rows.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        // sample the elements as they appear in the file
+        options.generalize_symmetry = false;
+
+        sampling_parse_handler<IT, VT> handler(rate, sample_size, seed);
+        read_matrix_market_body(instream, header, handler, pattern_default_value((const VT*)nullptr), options);
+        handler.finish(rows, cols, values);
+    }
+
+    /**
+     * Read a random sample of a Matrix Market file's elements into a triplet. Each element is kept with
+     * probability `rate`.
+     *
+     * The whole file is parsed, in parallel if allowed. Symmetry is not generalized; the sample is of the elements
+     * as they appear in the file. Elements are returned in file order.
+     * The sample depends only on `seed`, not on the number of threads.
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_triplet_sample(std::istream &instream,
+                                           matrix_market_header& header,
+                                           IVEC& rows, IVEC& cols, VVEC& values,
+                                           double rate,
+                                           uint64_t seed = 0,
+                                           const read_options& options = {}) {
+        read_header(instream, header);
+        read_matrix_market_body_triplet_sample(instream, header, rows, cols, values, rate, 0, seed, options);
+    }
+
+    /**
+     * Read a uniform random sample of exactly min(sample_size, nnz) elements into a triplet.
+     *
+     * Same as read_matrix_market_triplet_sample() but with a fixed-size sample.
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_triplet_reservoir(std::istream &instream,
+                                              matrix_market_header& header,
+                                              IVEC& rows, IVEC& cols, VVEC& values,
+                                              int64_t sample_size,
+                                              uint64_t seed = 0,
+                                              const read_options& options = {}) {
+        read_header(instream, header);
+        if (sample_size <= 0) {
+            rows.resize(0);
+            cols.resize(0);
+            values.resize(0);
+            return;
+        }
+        read_matrix_market_body_triplet_sample(instream, header, rows, cols, values, 0, sample_size, seed, options);
+    }
+
+    /**
+     * Read a quick preview of a large coordinate file by parsing only `num_chunks` chunks of
+     * `options.chunk_size_bytes` bytes at random positions in the file.
+     *
+     * Requires a seekable stream. The body is divided into chunk-sized byte ranges and `num_chunks` distinct ranges
+     * are picked at random. Each range contributes the lines that start inside it. This is a sample of blocks of
+     * consecutive lines, not of individual elements.
+     *
+     * If the stream is not seekable, the file is not a coordinate matrix, or the chosen ranges would cover the
+     * whole body, then the entire file is scanned with read_matrix_market_triplet_sample() at a rate that yields
+     * about the same number of elements.
+     *
+     * An error in a chunk is reported with the chunk's byte offset in the file and the line number within the chunk.
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_triplet_sample_seek(std::istream &instream,
+                                                matrix_market_header& header,
+                                                IVEC& rows, IVEC& cols, VVEC& values,
+                                                int64_t num_chunks,
+                                                uint64_t seed = 0,
+                                                read_options options = {}) {
+        using IT = typename std::iterator_traits<decltype(rows.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        read_header(instream, header);
+        options.generalize_symmetry = false;
+
+        const int64_t chunk_size = std::max(options.chunk_size_bytes, (int64_t)1);
+
+        // find the body extent
+        std::streamoff body_start = instream.tellg();
+        std::streamoff body_end = -1;
+        if (body_start >= 0 && instream.seekg(0, std::ios_base::end)) {
+            body_end = instream.tellg();
+        }
+        instream.clear();
+
+        const int64_t num_slots = body_end > body_start ? (body_end - body_start + chunk_size - 1) / chunk_size : 0;
+
+        if (body_end < 0 || header.object != matrix || header.format != coordinate || num_chunks >= num_slots) {
+            // scan the whole file instead
+            if (body_start >= 0) {
+                instream.seekg(body_start);
+            }
+            double rate = 1;
+            auto body_bytes = estimate_body_bytes(header);
+            if (body_bytes > 0) {
+                rate = std::min(1.0, (double)(num_chunks * chunk_size) / (double)body_bytes);
+            }
+            read_matrix_market_body_triplet_sample(instream, header, rows, cols, values, rate, 0, seed, options);
+            return;
+        }
+
+        // pick distinct slots
+        std::mt19937_64 rng(seed);
+        std::uniform_int_distribution<int64_t> slot_dist(0, num_slots - 1);
+        std::set<int64_t> slots;
+        while ((int64_t)slots.size() < num_chunks) {
+            slots.insert(slot_dist(rng));
+        }
+
+        // read the lines that start in each slot
+        std::vector<std::string> chunks;
+        std::vector<int64_t> chunk_offsets;
+        for (int64_t slot : slots) {
+            std::streamoff slot_start = body_start + slot * chunk_size;
+            std::streamoff slot_end = std::min(slot_start + chunk_size, body_end);
+
+            instream.clear();
+            instream.seekg(slot_start);
+            if (slot > 0) {
+                // A line that straddles the slot start belongs to the previous slot.
+                instream.seekg(slot_start - 1);
+                instream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            }
+
+            std::streamoff pos = instream.tellg();
+            if (!instream || pos >= slot_end) {
+                continue;
+            }
+
+            std::string chunk((std::size_t)(slot_end - pos), ' ');
+            instream.read(chunk.data(), (std::streamsize)chunk.size());
+            chunk.resize((std::size_t)instream.gcount());
+
+            // finish the last line
+            if (!chunk.empty() && chunk.back() != '\n') {
+                std::string suffix;
+                std::getline(instream, suffix);
+                chunk += suffix;
+                chunk += '\n';
+            }
+            chunks.push_back(std::move(chunk));
+            chunk_offsets.push_back((int64_t)pos);
+        }
+
+        // parse the chunks, keeping every element
+        auto handler = sampling_parse_handler<IT, VT>::keep_all();
+        auto pattern_handler = pattern_parse_adapter<decltype(handler)>(handler, pattern_default_value((const VT*)nullptr));
+
+        auto parse_chunk = [&](std::size_t i) {
+            // Index elements by slot so that the result is in file order.
+            auto chunk_handler = pattern_handler.get_chunk_handler((int64_t)i * chunk_size);
+            try {
+                read_chunk_matrix_coordinate(chunks[i], header, line_counts{0, 0}, chunk_handler, options);
+            } catch (invalid_mm& inv) {
+                // The lines before this chunk were not read, so only the line within the chunk is known.
+                inv.prepend_chunk_offset(chunk_offsets[i]);
+                throw;
+            }
+        };
+
+        bool threads = options.parallel_ok && options.num_threads != 1 && chunks.size() > 1;
+        if (threads) {
+            task_thread_pool::task_thread_pool pool(options.num_threads > 0 ? (unsigned int)options.num_threads : 0);
+            std::vector<std::future<void>> futures;
+            for (std::size_t i = 0; i < chunks.size(); ++i) {
+                futures.push_back(pool.submit(parse_chunk, i));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+        } else {
+            for (std::size_t i = 0; i < chunks.size(); ++i) {
+                parse_chunk(i);
+            }
+        }
+
+        handler.finish(rows, cols, values);
+    }
+}
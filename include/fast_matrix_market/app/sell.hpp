@@ -0,0 +1,331 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <numeric>
+
+#include "triplet.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Parse handler that counts the elements of each row.
+     */
+    template <typename IT, typename VT>
+    class row_count_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk | kAppending;
+
+        explicit row_count_parse_handler(std::atomic<int64_t>* counts) : counts(counts) {}
+
+        void handle(const coordinate_type row, [[maybe_unused]] const coordinate_type col,
+                    [[maybe_unused]] const value_type value) {
+            counts[row].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        row_count_parse_handler<IT, VT> get_chunk_handler([[maybe_unused]] int64_t offset_from_begin) {
+            return *this;
+        }
+
+    protected:
+        std::atomic<int64_t>* counts;
+    };
+
+    /**
+     * Parse handler that writes each element into the next free slot of its row in a SELL-C-sigma structure.
+     *
+     * Row `row` has slots row_starts[row] + k * slice_height for k = 0, 1, ...
+     */
+    template <typename IT, typename VT, typename IT_ITER, typename VT_ITER>
+    class sell_scatter_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = VT;
+        static constexpr int flags = kParallelOk | kAppending;
+
+        sell_scatter_parse_handler(const int64_t* row_starts, std::atomic<int64_t>* row_fill, int64_t slice_height,
+                                   const IT_ITER& cols, const VT_ITER& values) :
+                row_starts(row_starts), row_fill(row_fill), slice_height(slice_height), cols(cols), values(values) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, const value_type value) {
+            int64_t slot = row_fill[row].fetch_add(1, std::memory_order_relaxed);
+            int64_t pos = row_starts[row] + slot * slice_height;
+            cols[pos] = col;
+            values[pos] = value;
+        }
+
+        sell_scatter_parse_handler get_chunk_handler([[maybe_unused]] int64_t offset_from_begin) {
+            return *this;
+        }
+
+    protected:
+        const int64_t* row_starts;
+        std::atomic<int64_t>* row_fill;
+        int64_t slice_height;
+        IT_ITER cols;
+        VT_ITER values;
+    };
+
+    /**
+     * SELL-C-sigma layout parameters.
+     */
+    struct sell_options {
+        /**
+         * Number of rows per slice (C). Usually the SIMD width.
+         */
+        int64_t slice_height = 8;
+
+        /**
+         * Rows are sorted by length within windows of this many rows (sigma). 1 disables sorting.
+         */
+        int64_t sigma = 256;
+
+        /**
+         * If true and the stream is seekable, parse the body twice: once to count row lengths and once to scatter
+         * the elements directly into their slots. This avoids holding a triplet copy of the matrix in memory,
+         * at the cost of parsing twice.
+         */
+        bool reparse = false;
+    };
+
+    /**
+     * Read a Matrix Market file into a SELL-C-sigma structure.
+     *
+     * Rows are sorted by decreasing length within windows of `sigma` rows, then grouped into slices of
+     * `slice_height` (C) consecutive sorted rows. Each slice is padded to the length of its longest row and stored
+     * column-major, so element `k` of the row in position `p` of slice `s` is at
+     * slice_ptr[s] + k * slice_height + p. Padding has column 0 and value 0. The elements of each row are sorted by
+     * column.
+     *
+     * `slice_height` = 1 gives CSR-like storage, and `sigma` = 1 gives unsorted SELL-C (sliced ELLPACK).
+     *
+     * By default the file is read into a triplet, which is then counted and scattered directly into the slices
+     * in parallel, without an intermediate CSR. The triplet means peak memory is about twice the size of the matrix.
+     * See sell_options::reparse to avoid the triplet.
+     *
+     * @param row_perm sorted position -> row of the matrix. Length nrows.
+     * @param slice_ptr start of each slice in `cols` and `values`. Length num_slices + 1.
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_sell(std::istream &instream,
+                                 matrix_market_header& header,
+                                 IVEC& row_perm, IVEC& slice_ptr, IVEC& cols, VVEC& values,
+                                 const sell_options& layout = {},
+                                 read_options options = {}) {
+        using IT = typename std::iterator_traits<decltype(cols.begin())>::value_type;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        const int64_t slice_height = layout.slice_height;
+        const int64_t sigma = layout.sigma;
+        if (slice_height <= 0 || sigma <= 0) {
+            throw invalid_argument("Slice height and sigma must be positive.");
+        }
+
+        read_header(instream, header);
+        options.structure_only = false;
+
+        // The reparse handlers take one element at a time, so generalize symmetry in the parser.
+        read_options parse_options = options;
+        parse_options.generalize_symmetry_app = false;
+
+        const int64_t nrows = header.nrows;
+        const VT pattern_value = pattern_default_value((const VT*)nullptr);
+
+        // vector<bool> elements share bytes, so bool values are scattered on one thread
+        bool threads = limit_parallelism_for_value_type<VT>(options.parallel_ok) && options.num_threads != 1;
+        int64_t num_threads = 1;
+        if (threads) {
+            num_threads = options.num_threads > 0 ? options.num_threads : (int64_t)std::thread::hardware_concurrency();
+            num_threads = std::max(num_threads, (int64_t)1);
+        }
+
+        // Run fn(range) for each range in [0, num_ranges), in parallel if allowed. The pool is started on first use.
+        std::unique_ptr<task_thread_pool::task_thread_pool> pool;
+        auto for_each_range = [&](int64_t num_ranges, auto fn) {
+            if (num_threads <= 1 || num_ranges <= 1) {
+                for (int64_t range = 0; range < num_ranges; ++range) {
+                    fn(range);
+                }
+                return;
+            }
+            if (!pool) {
+                pool = std::make_unique<task_thread_pool::task_thread_pool>((unsigned int)num_threads);
+            }
+            std::vector<std::future<void>> futures;
+            for (int64_t range = 0; range < num_ranges; ++range) {
+                futures.push_back(pool->submit(fn, range));
+            }
+            for (auto& f : futures) {
+                f.get();
+            }
+        };
+
+        std::streamoff body_start = layout.reparse ? (std::streamoff)instream.tellg() : -1;
+        const bool reparse = body_start >= 0;
+
+        // Count row lengths
+        std::vector<int64_t> row_lengths(nrows, 0);
+        uninitialized_vector<IT> triplet_rows, triplet_cols;
+        uninitialized_vector<VT> triplet_values;
+        std::unique_ptr<std::atomic<int64_t>[]> row_counts;
+
+        // Triplet path: element range r has range_fill[r][row] elements of each row.
+        // After the layout this becomes the first slot of each row that range r writes to.
+        int64_t num_element_ranges = 1;
+        std::vector<std::vector<int64_t>> range_fill;
+        auto element_range_begin = [&](int64_t range) {
+            return (int64_t)triplet_rows.size() * range / num_element_ranges;
+        };
+
+        if (reparse) {
+            row_counts.reset(new std::atomic<int64_t>[nrows]);
+            for (int64_t row = 0; row < nrows; ++row) {
+                row_counts[row].store(0, std::memory_order_relaxed);
+            }
+            row_count_parse_handler<IT, VT> count_handler(row_counts.get());
+            read_matrix_market_body(instream, header, count_handler, pattern_value, parse_options);
+
+            for (int64_t row = 0; row < nrows; ++row) {
+                row_lengths[row] = row_counts[row].load(std::memory_order_relaxed);
+            }
+        } else {
+            read_matrix_market_body_triplet(instream, header, triplet_rows, triplet_cols, triplet_values,
+                                            pattern_value, options);
+
+            // Per-range row histograms. Limit the ranges so the histograms are no larger than the triplet.
+            auto nnz = (int64_t)triplet_rows.size();
+            num_element_ranges = std::max(std::min(num_threads, nnz / std::max(nrows, (int64_t)1)), (int64_t)1);
+            range_fill.resize(num_element_ranges);
+            for_each_range(num_element_ranges, [&](int64_t range) {
+                auto& hist = range_fill[range];
+                hist.assign(nrows, 0);
+                for (int64_t i = element_range_begin(range); i < element_range_begin(range + 1); ++i) {
+                    ++hist[triplet_rows[i]];
+                }
+            });
+
+            for_each_range(num_threads, [&](int64_t range) {
+                for (int64_t row = nrows * range / num_threads; row < nrows * (range + 1) / num_threads; ++row) {
+                    int64_t length = 0;
+                    for (const auto& hist : range_fill) {
+                        length += hist[row];
+                    }
+                    row_lengths[row] = length;
+                }
+            });
+        }
+
+        // Sort rows by decreasing length within each sigma window
+        std::vector<int64_t> order(nrows);
+        std::iota(order.begin(), order.end(), 0);
+        if (sigma > 1) {
+            for (int64_t window = 0; window < nrows; window += sigma) {
+                std::stable_sort(order.begin() + window, order.begin() + std::min(window + sigma, nrows),
+                                 [&](int64_t lhs, int64_t rhs) {
+                    return row_lengths[lhs] > row_lengths[rhs];
+                });
+            }
+        }
+
+        // Lay out the slices
+        const int64_t num_slices = (nrows + slice_height - 1) / slice_height;
+        slice_ptr.resize(num_slices + 1);
+        std::vector<int64_t> row_starts(nrows);
+        int64_t offset = 0;
+        for (int64_t slice = 0; slice < num_slices; ++slice) {
+            slice_ptr[slice] = offset;
+            int64_t width = 0;
+            for (int64_t p = slice * slice_height; p < std::min((slice + 1) * slice_height, nrows); ++p) {
+                width = std::max(width, row_lengths[order[p]]);
+                row_starts[order[p]] = offset + (p - slice * slice_height);
+            }
+            offset += width * slice_height;
+        }
+        slice_ptr[num_slices] = offset;
+
+        row_perm.resize(nrows);
+        std::copy(order.begin(), order.end(), row_perm.begin());
+
+        cols.resize(0);
+        cols.resize(offset, 0);
+        values.resize(0);
+        values.resize(offset, get_zero<VT>());
+
+        // Scatter the elements into their slots
+        if (reparse) {
+            for (int64_t row = 0; row < nrows; ++row) {
+                row_counts[row].store(0, std::memory_order_relaxed);
+            }
+            sell_scatter_parse_handler<IT, VT, decltype(cols.begin()), decltype(values.begin())> scatter_handler(
+                    row_starts.data(), row_counts.get(), slice_height, cols.begin(), values.begin());
+
+            instream.clear();
+            instream.seekg(body_start);
+            read_matrix_market_body(instream, header, scatter_handler, pattern_value, parse_options);
+        } else {
+            // Exclusive prefix sum over the ranges, so that each range writes its elements of a row after those of
+            // the ranges before it. Elements keep their file order within each row.
+            for_each_range(num_threads, [&](int64_t range) {
+                for (int64_t row = nrows * range / num_threads; row < nrows * (range + 1) / num_threads; ++row) {
+                    int64_t slot = row_starts[row];
+                    for (auto& hist : range_fill) {
+                        int64_t count = hist[row];
+                        hist[row] = slot;
+                        slot += count * slice_height;
+                    }
+                }
+            });
+
+            for_each_range(num_element_ranges, [&](int64_t range) {
+                auto& next_slot = range_fill[range];
+                for (int64_t i = element_range_begin(range); i < element_range_begin(range + 1); ++i) {
+                    auto& pos = next_slot[triplet_rows[i]];
+                    cols[pos] = triplet_cols[i];
+                    values[pos] = triplet_values[i];
+                    pos += slice_height;
+                }
+            });
+        }
+
+        // Sort each row by column. Rows are usually already sorted.
+        auto sort_rows = [&](int64_t row_begin, int64_t row_end) {
+            std::vector<std::pair<IT, VT>> elements;
+            for (int64_t row = row_begin; row < row_end; ++row) {
+                bool sorted = true;
+                for (int64_t k = 1; k < row_lengths[row] && sorted; ++k) {
+                    int64_t pos = row_starts[row] + k * slice_height;
+                    sorted = !(cols[pos] < cols[pos - slice_height]);
+                }
+                if (sorted) {
+                    continue;
+                }
+
+                elements.resize(row_lengths[row]);
+                for (int64_t k = 0; k < row_lengths[row]; ++k) {
+                    int64_t pos = row_starts[row] + k * slice_height;
+                    elements[k] = std::make_pair((IT)cols[pos], (VT)values[pos]);
+                }
+                std::stable_sort(elements.begin(), elements.end(), [](const auto& lhs, const auto& rhs) {
+                    return lhs.first < rhs.first;
+                });
+                for (int64_t k = 0; k < row_lengths[row]; ++k) {
+                    int64_t pos = row_starts[row] + k * slice_height;
+                    cols[pos] = elements[k].first;
+                    values[pos] = elements[k].second;
+                }
+            }
+        };
+
+        int64_t num_row_ranges = std::max(std::min(num_threads, nrows), (int64_t)1);
+        for_each_range(num_row_ranges, [&](int64_t range) {
+            sort_rows(nrows * range / num_row_ranges, nrows * (range + 1) / num_row_ranges);
+        });
+    }
+}
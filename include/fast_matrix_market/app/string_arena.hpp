@@ -0,0 +1,249 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "../fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Owns the text of std::string_view values. Text is copied into large blocks, so reading a file of
+     * string values makes one allocation per block instead of one per value.
+     *
+     * The views stay valid until the arena is cleared or destroyed.
+     */
+    class string_arena {
+    public:
+        explicit string_arena(std::size_t block_bytes = 1U << 18U) : block_bytes(block_bytes), shared_writer(*this) {}
+
+        string_arena(const string_arena&) = delete;
+        string_arena& operator=(const string_arena&) = delete;
+
+        /**
+         * Allocate a new block of at least `min_bytes`. Thread safe.
+         *
+         * @return the block's start and end.
+         */
+        std::pair<char*, char*> allocate_block(std::size_t min_bytes) {
+            std::size_t size = std::max(min_bytes, block_bytes);
+            auto block = std::make_unique<char[]>(size);
+            char* begin = block.get();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks.emplace_back(std::move(block));
+            num_bytes += size;
+            return {begin, begin + size};
+        }
+
+        /**
+         * Copy `str` into the arena. Thread safe, but takes a lock. Parse handlers use a writer instead.
+         */
+        std::string_view copy(std::string_view str) {
+            std::lock_guard<std::mutex> lock(shared_writer_mutex);
+            return shared_writer.copy(str);
+        }
+
+        /**
+         * Total bytes allocated.
+         */
+        [[nodiscard]] std::size_t allocated_bytes() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return num_bytes;
+        }
+
+        /**
+         * Free all blocks. Invalidates every view.
+         */
+        void clear() {
+            std::lock_guard<std::mutex> lock(mutex);
+            blocks.clear();
+            num_bytes = 0;
+            shared_writer = writer(*this);
+        }
+
+        /**
+         * Copies strings into the arena, one block at a time. Not thread safe; use one writer per thread.
+         *
+         * Copies of a writer start a new block, so that two copies never write to the same memory.
+         */
+        class writer {
+        public:
+            explicit writer(string_arena& arena) : arena(&arena) {}
+            writer(const writer& other) : arena(other.arena) {}
+            writer& operator=(const writer& other) {
+                arena = other.arena;
+                pos = end = nullptr;
+                return *this;
+            }
+
+            std::string_view copy(std::string_view str) {
+                if (str.empty()) {
+                    return {};
+                }
+                if ((std::size_t)(end - pos) < str.size()) {
+                    std::tie(pos, end) = arena->allocate_block(str.size());
+                }
+                std::memcpy(pos, str.data(), str.size());
+                std::string_view ret(pos, str.size());
+                pos += str.size();
+                return ret;
+            }
+
+        protected:
+            string_arena* arena;
+            char* pos = nullptr;
+            char* end = nullptr;
+        };
+
+    protected:
+        const std::size_t block_bytes;
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        std::size_t num_bytes = 0;
+
+        std::mutex shared_writer_mutex;
+        writer shared_writer;
+    };
+
+    /**
+     * What string_arena_parse_handler parses values into: a view of the value's text in the chunk being parsed.
+     *
+     * The view is only valid until the handler copies it into the arena. Only this type, not std::string_view,
+     * has a read_value(), so readers that would keep views into chunk buffers do not compile.
+     */
+    struct string_arena_value {
+        std::string_view text;
+        // skew-symmetric mirror. The "-" is prepended when the text is copied.
+        bool negated = false;
+    };
+
+    inline const char *read_value(const char *pos, const char *end, string_arena_value &out, [[maybe_unused]] const read_options& options = {}) {
+        const char *field_start = pos;
+        // find the end of the line
+        while (pos != end && *pos != '\n') {
+            ++pos;
+        }
+        out = string_arena_value{std::string_view(field_start, (pos - field_start)), false};
+
+        return pos;
+    }
+
+    template<> struct can_read_complex<string_arena_value> : std::true_type {};
+
+    inline string_arena_value negate(const string_arena_value& o) {
+        return string_arena_value{o.text, !o.negated};
+    }
+
+    inline string_arena_value pattern_default_value([[maybe_unused]] const string_arena_value* type) {
+        return {};
+    }
+
+    /**
+     * Parse handler wrapper that copies values into a string_arena and forwards them as std::string_view.
+     *
+     * The parsed text points into a chunk buffer that is reused, so it must be copied before the chunk is done.
+     */
+    template <typename FWD_HANDLER>
+    class string_arena_parse_handler {
+    public:
+        using coordinate_type = typename FWD_HANDLER::coordinate_type;
+        using value_type = string_arena_value;
+        static constexpr int flags = FWD_HANDLER::flags;
+
+        static_assert(std::is_same_v<typename FWD_HANDLER::value_type, std::string_view>,
+                      "Forwarded handler must take std::string_view values.");
+
+        string_arena_parse_handler(const FWD_HANDLER& handler, string_arena& arena) : handler(handler), arena_writer(arena) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, const value_type& value) {
+            if (value.negated) {
+                negated.assign("-");
+                negated.append(value.text);
+                handler.handle(row, col, arena_writer.copy(negated));
+            } else {
+                handler.handle(row, col, arena_writer.copy(value.text));
+            }
+        }
+
+        string_arena_parse_handler get_chunk_handler(int64_t offset_from_begin) {
+            // the new handler's writer starts its own block
+            string_arena_parse_handler ret(*this);
+            ret.handler = handler.get_chunk_handler(offset_from_begin);
+            return ret;
+        }
+
+    protected:
+        FWD_HANDLER handler;
+        string_arena::writer arena_writer;
+        std::string negated;
+    };
+
+    /**
+     * Read a Matrix Market file into a triplet with std::string_view values whose text is kept in `arena`.
+     *
+     * Reads any field type. Each value's text is kept exactly as it appears in the file, so files can be copied or
+     * sorted losslessly without a heap allocation per element.
+     */
+    template <typename IVEC, typename VVEC>
+    void read_matrix_market_triplet(std::istream &instream,
+                                    matrix_market_header& header,
+                                    IVEC& rows, IVEC& cols, VVEC& values,
+                                    string_arena& arena,
+                                    read_options options = {}) {
+        static_assert(std::is_same_v<typename VVEC::value_type, std::string_view>, "Values must be std::string_view.");
+
+        read_header(instream, header);
+
+        bool app_generalize = false;
+        deferred_permutation permutation;
+        if (use_app_symmetry_generalization(options)) {
+            app_generalize = true;
+            options.generalize_symmetry = false;
+            permutation = defer_permutation(options, header);
+        }
+
+        auto nnz = get_storage_nnz(header, options);
+        rows.resize(nnz);
+        cols.resize(nnz);
+        values.resize(nnz);
+
+        auto handler = string_arena_parse_handler(triplet_parse_handler(rows.begin(), cols.begin(), values.begin()), arena);
+        read_matrix_market_body(instream, header, handler, string_arena_value(), options);
+
+        if (app_generalize && header.symmetry != general) {
+            // Symmetric mirrors share the original's text. Skew-symmetric mirrors need their own, negated copy.
+            generalize_symmetry_by_index(
+                    (int64_t)rows.size(),
+                    [&](int64_t i) {
+                        return rows[i] == cols[i];
+                    },
+                    [&](int64_t new_size) {
+                        rows.resize(new_size);
+                        cols.resize(new_size);
+                        values.resize(new_size);
+                    },
+                    [&](int64_t i, int64_t dest) {
+                        rows[dest] = cols[i];
+                        cols[dest] = rows[i];
+                        if (header.symmetry == skew_symmetric) {
+                            values[dest] = arena.copy("-" + std::string(values[i]));
+                        } else {
+                            values[dest] = values[i];
+                        }
+                    },
+                    options);
+            permute_triplet(rows, cols, permutation);
+        }
+    }
+}
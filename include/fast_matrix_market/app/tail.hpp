@@ -0,0 +1,176 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <istream>
+#include <string>
+
+#include "../fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * Where a tail read stopped. Pass the same checkpoint to the next read to continue from there.
+     */
+    struct tail_checkpoint {
+        /**
+         * The file's header. Its nnz is not used, so a placeholder is fine.
+         */
+        matrix_market_header header;
+        bool header_read = false;
+
+        /**
+         * Byte offset in the file of the first byte that has not been read yet.
+         */
+        int64_t offset = 0;
+
+        /**
+         * Number of element lines parsed so far.
+         */
+        int64_t num_elements = 0;
+
+        /**
+         * Number of lines parsed so far, including the header. Used for error messages.
+         */
+        int64_t file_line = 0;
+
+        /**
+         * An incomplete last line. Parsed once the rest of it, up to the newline, has been appended.
+         */
+        std::string remainder;
+    };
+
+    /**
+     * Read the coordinate elements appended to a file since the last call, and append them to a triplet.
+     *
+     * For files that are written while they are read, such as a simulation's output with a placeholder nnz.
+     * The first call reads the header and all elements so far. Later calls only read bytes past `checkpoint`, so
+     * each call costs time proportional to the appended data. A line is parsed only once it ends in a newline.
+     * Large appends are parsed in parallel.
+     *
+     * Symmetric files are generalized as elements are read (see read_options::generalize_symmetry). The elements
+     * appended by one call are followed by their mirrors.
+     * The header must be complete before the first call. If a new line fails to parse then the exception is
+     * propagated, and the checkpoint and the triplet are left as they were before the call.
+     *
+     * @param instream seekable stream of the file. May be reopened between calls.
+     * @return number of elements appended to the triplet.
+     */
+    template <typename IVEC, typename VVEC>
+    int64_t read_matrix_market_triplet_tail(std::istream& instream,
+                                            tail_checkpoint& checkpoint,
+                                            IVEC& rows, IVEC& cols, VVEC& values,
+                                            read_options options = {}) {
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        instream.clear();
+        if (!checkpoint.header_read) {
+            instream.seekg(0);
+            checkpoint.file_line = read_header(instream, checkpoint.header);
+            if (checkpoint.header.format != coordinate) {
+                throw invalid_argument("Tail reads are only supported for coordinate files.");
+            }
+            checkpoint.offset = (int64_t)instream.tellg();
+            checkpoint.header_read = true;
+        }
+
+        // Read everything that was appended.
+        instream.seekg(0, std::ios_base::end);
+        auto file_size = (int64_t)instream.tellg();
+        if (file_size < checkpoint.offset) {
+            throw invalid_argument("File is shorter than the checkpoint. Was it rewritten?");
+        }
+
+        std::string data = checkpoint.remainder;
+        auto old_size = data.size();
+        data.resize(old_size + (std::size_t)(file_size - checkpoint.offset));
+        instream.seekg(checkpoint.offset);
+        instream.read(data.data() + old_size, file_size - checkpoint.offset);
+        auto num_read = (int64_t)instream.gcount();
+        data.resize(old_size + (std::size_t)num_read);
+
+        // Only parse whole lines.
+        auto last_newline = data.rfind('\n');
+        std::size_t body_size = last_newline == std::string::npos ? 0 : last_newline + 1;
+        std::string remainder = data.substr(body_size);
+        data.resize(body_size);
+
+        int64_t num_new = 0;
+        int64_t num_new_elements = 0;
+        int64_t num_new_lines = 0;
+        if (!data.empty()) {
+            // The body is parsed as if it were a file of its own, with nnz equal to its number of elements.
+            auto [num_lines, num_empty_lines] = count_lines(data);
+            matrix_market_header header = checkpoint.header;
+            header.nnz = num_lines - num_empty_lines;
+            header.header_line_count = checkpoint.file_line;
+
+            bool app_generalize = false;
+            deferred_permutation permutation;
+            if (use_app_symmetry_generalization(options)) {
+                app_generalize = true;
+                options.generalize_symmetry = false;
+                permutation = defer_permutation(options, header);
+            }
+
+            num_new = get_storage_nnz(header, options);
+            auto begin = (int64_t)rows.size();
+            rows.resize(begin + num_new);
+            cols.resize(begin + num_new);
+            values.resize(begin + num_new);
+
+            try {
+                memory_source source(data);
+                auto handler = triplet_parse_handler(rows.begin() + begin, cols.begin() + begin, values.begin() + begin);
+                read_matrix_market_body(source, header, handler, pattern_default_value((const VT*)nullptr), options);
+
+                if (app_generalize && header.symmetry != general) {
+                    // Only mirror the new elements, in [begin, end).
+                    read_options generalize_options = options;
+                    generalize_options.parallel_ok = limit_parallelism_for_value_type<VT>(options.parallel_ok);
+
+                    generalize_symmetry_by_index(
+                            num_new,
+                            [&](int64_t i) {
+                                return rows[begin + i] == cols[begin + i];
+                            },
+                            [&](int64_t new_size) {
+                                rows.resize(begin + new_size);
+                                cols.resize(begin + new_size);
+                                values.resize(begin + new_size);
+                            },
+                            [&](int64_t i, int64_t dest) {
+                                rows[begin + dest] = cols[begin + i];
+                                cols[begin + dest] = rows[begin + i];
+                                values[begin + dest] = get_symmetric_value<VT>(values[begin + i], header.symmetry);
+                            },
+                            generalize_options);
+                    num_new = (int64_t)rows.size() - begin;
+
+                    if (!permutation.empty()) {
+                        for (auto i = begin; i < (int64_t)rows.size(); ++i) {
+                            rows[i] = permutation.row(rows[i]);
+                            cols[i] = permutation.col(cols[i]);
+                        }
+                    }
+                }
+            } catch (...) {
+                rows.resize(begin);
+                cols.resize(begin);
+                values.resize(begin);
+                throw;
+            }
+
+            num_new_elements = header.nnz;
+            num_new_lines = num_lines;
+        }
+
+        checkpoint.offset += num_read;
+        checkpoint.remainder = std::move(remainder);
+        checkpoint.num_elements += num_new_elements;
+        checkpoint.file_line += num_new_lines;
+        return num_new;
+    }
+}
@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <numeric>
+
 #include "../fast_matrix_market.hpp"
+#include "../thirdparty/task_thread_pool.hpp"
 
 namespace fast_matrix_market {
 #if __cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
@@ -36,47 +39,165 @@ namespace fast_matrix_market {
 #define triplet_write_vector typename
 #endif
 
+    /**
+     * Generalize symmetry of any indexable element storage, in parallel if allowed.
+     *
+     * Does not duplicate diagonal elements. Works in two passes over [0, num_elements), each split into ranges
+     * that are processed in parallel: first count the off-diagonal elements in each range, then mirror them into
+     * their place following the original elements. A prefix sum of the counts gives each range its destination.
+     *
+     * @param num_elements number of elements read from the file
+     * @param is_diagonal callable (index) -> bool
+     * @param resize callable (new_num_elements). Called once, between the two passes.
+     * @param mirror callable (source_index, destination_index). Write the mirror of the source element to the
+     *               destination. Must be safe to call concurrently for different destinations.
+     * @param options parallel_ok and num_threads select parallelism
+     */
+    template <typename IS_DIAGONAL, typename RESIZE, typename MIRROR>
+    void generalize_symmetry_by_index(int64_t num_elements,
+                                      IS_DIAGONAL is_diagonal,
+                                      RESIZE resize,
+                                      MIRROR mirror,
+                                      const read_options& options = {}) {
+        // Split the elements into ranges. Ranges are about as large as the parse chunks.
+        int64_t num_ranges = 1;
+        if (options.parallel_ok && options.num_threads != 1) {
+            int64_t num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+            int64_t min_range_size = std::max(options.chunk_size_bytes / 16, (int64_t)1);
+            num_ranges = std::max(std::min(num_threads, num_elements / min_range_size), (int64_t)1);
+        }
+
+        std::vector<int64_t> range_starts(num_ranges + 1);
+        for (int64_t range = 0; range <= num_ranges; ++range) {
+            range_starts[range] = num_elements * range / num_ranges;
+        }
+
+        // Number of mirrored elements emitted by each range. Becomes the ranges' output offsets after a prefix sum.
+        std::vector<int64_t> offsets(num_ranges + 1, 0);
+
+        auto count_range = [&](int64_t range) {
+            int64_t count = 0;
+            for (int64_t i = range_starts[range]; i < range_starts[range + 1]; ++i) {
+                if (!is_diagonal(i)) {
+                    ++count;
+                }
+            }
+            offsets[range + 1] = count;
+        };
+
+        auto mirror_range = [&](int64_t range) {
+            int64_t dest = num_elements + offsets[range];
+            for (int64_t i = range_starts[range]; i < range_starts[range + 1]; ++i) {
+                if (!is_diagonal(i)) {
+                    mirror(i, dest);
+                    ++dest;
+                }
+            }
+        };
+
+        if (num_ranges == 1) {
+            count_range(0);
+            resize(num_elements + offsets[1]);
+            mirror_range(0);
+            return;
+        }
+
+        task_thread_pool::task_thread_pool pool((unsigned int)num_ranges);
+        std::vector<std::future<void>> futures;
+
+        for (int64_t range = 0; range < num_ranges; ++range) {
+            futures.push_back(pool.submit(count_range, range));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+        futures.clear();
+
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        resize(num_elements + offsets[num_ranges]);
+
+        for (int64_t range = 0; range < num_ranges; ++range) {
+            futures.push_back(pool.submit(mirror_range, range));
+        }
+        for (auto& f : futures) {
+            f.get();
+        }
+    }
+
     /**
      * Generalize symmetry of triplet.
      *
      * Does not duplicate diagonal elements.
      */
     template <typename IVEC, typename VVEC>
-    void generalize_symmetry_triplet(IVEC& rows, IVEC& cols, VVEC& values, const symmetry_type& symmetry) {
+    void generalize_symmetry_triplet(IVEC& rows, IVEC& cols, VVEC& values, const symmetry_type& symmetry,
+                                     const read_options& options = {}) {
         if (symmetry == general) {
             return;
         }
 
-        std::size_t num_diagonal_elements = 0;
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
 
-        // count how many diagonal elements there are (these do not get duplicated)
-        for (std::size_t i = 0; i < rows.size(); ++i) {
-            if (rows[i] == cols[i]) {
-                ++num_diagonal_elements;
-            }
-        }
+        read_options generalize_options = options;
+        generalize_options.parallel_ok = limit_parallelism_for_value_type<VT>(options.parallel_ok);
 
-        // resize vectors
-        auto orig_size = rows.size();
-        auto new_size = 2*orig_size - num_diagonal_elements;
-        rows.resize(new_size);
-        cols.resize(new_size);
-        values.resize(new_size);
-
-        // fill in the new values
-        auto row_iter = rows.begin() + orig_size;
-        auto col_iter = cols.begin() + orig_size;
-        auto val_iter = values.begin() + orig_size;
-        for (std::size_t i = 0; i < orig_size; ++i) {
-            if (rows[i] == cols[i]) {
-                continue;
-            }
+        generalize_symmetry_by_index(
+                (int64_t)rows.size(),
+                [&](int64_t i) {
+                    return rows[i] == cols[i];
+                },
+                [&](int64_t new_size) {
+                    rows.resize(new_size);
+                    cols.resize(new_size);
+                    values.resize(new_size);
+                },
+                [&](int64_t i, int64_t dest) {
+                    rows[dest] = cols[i];
+                    cols[dest] = rows[i];
+                    values[dest] = get_symmetric_value<VT>(values[i], symmetry);
+                },
+                generalize_options);
+    }
+
+    /**
+     * Generalize symmetry of a row/column structure with no values.
+     *
+     * Does not duplicate diagonal elements.
+     */
+    template <typename IVEC>
+    void generalize_symmetry_pattern(IVEC& rows, IVEC& cols, const symmetry_type& symmetry,
+                                     const read_options& options = {}) {
+        if (symmetry == general) {
+            return;
+        }
 
-            *row_iter = cols[i];
-            *col_iter = rows[i];
-            *val_iter = get_symmetric_value<typename VVEC::value_type>(values[i], symmetry);
+        generalize_symmetry_by_index(
+                (int64_t)rows.size(),
+                [&](int64_t i) {
+                    return rows[i] == cols[i];
+                },
+                [&](int64_t new_size) {
+                    rows.resize(new_size);
+                    cols.resize(new_size);
+                },
+                [&](int64_t i, int64_t dest) {
+                    rows[dest] = cols[i];
+                    cols[dest] = rows[i];
+                },
+                options);
+    }
 
-            ++row_iter; ++col_iter; ++val_iter;
+    /**
+     * Apply a permutation that was deferred until after symmetry generalization.
+     */
+    template <typename IVEC>
+    void permute_triplet(IVEC& rows, IVEC& cols, const deferred_permutation& permutation) {
+        if (permutation.empty()) {
+            return;
+        }
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            rows[i] = permutation.row(rows[i]);
+            cols[i] = permutation.col(cols[i]);
         }
     }
 
@@ -87,21 +208,38 @@ namespace fast_matrix_market {
                                          T pattern_value,
                                          read_options options = {}) {
         bool app_generalize = false;
-        if (options.generalize_symmetry && options.generalize_symmetry_app) {
+        deferred_permutation permutation;
+        if (use_app_symmetry_generalization(options)) {
             app_generalize = true;
             options.generalize_symmetry = false;
+            permutation = defer_permutation(options, header);
         }
 
         auto nnz = get_storage_nnz(header, options);
         rows.resize(nnz);
         cols.resize(nnz);
+
+        if (options.structure_only) {
+            values.resize(0);
+
+            auto handler = triplet_pattern_parse_handler(rows.begin(), cols.begin());
+            read_matrix_market_body_no_adapters(instream, header, handler, options);
+
+            if (app_generalize) {
+                generalize_symmetry_pattern(rows, cols, header.symmetry, options);
+                permute_triplet(rows, cols, permutation);
+            }
+            return;
+        }
+
         values.resize(nnz);
 
         auto handler = triplet_parse_handler(rows.begin(), cols.begin(), values.begin());
         read_matrix_market_body(instream, header, handler, pattern_value, options);
 
         if (app_generalize) {
-            generalize_symmetry_triplet(rows, cols, values, header.symmetry);
+            generalize_symmetry_triplet(rows, cols, values, header.symmetry, options);
+            permute_triplet(rows, cols, permutation);
         }
     }
 
@@ -133,6 +271,56 @@ namespace fast_matrix_market {
         ncols = header.ncols;
     }
 
+    /**
+     * Read a Matrix Market file into a triplet, storing only a single value if all values are equal.
+     *
+     * Large graphs often have the same value on every line. If every value is equal, or the file is a pattern
+     * file, then `values` has length 1 and `is_iso` is set to true. Otherwise `values` has one entry per element,
+     * as in read_matrix_market_triplet(). The full value vector is only allocated once a differing value is seen.
+     */
+    template <triplet_read_vector IVEC, triplet_read_vector VVEC>
+    void read_matrix_market_triplet_iso(std::istream &instream,
+                                        matrix_market_header& header,
+                                        IVEC& rows, IVEC& cols, VVEC& values,
+                                        bool& is_iso,
+                                        read_options options = {}) {
+        read_header(instream, header);
+
+        using VT = typename std::iterator_traits<decltype(values.begin())>::value_type;
+
+        bool app_generalize = false;
+        deferred_permutation permutation;
+        if (use_app_symmetry_generalization(options)) {
+            if (header.symmetry == skew_symmetric || header.symmetry == hermitian) {
+                // mirrored values differ from the originals
+                read_matrix_market_body_triplet(instream, header, rows, cols, values, pattern_default_value((const VT*)nullptr), options);
+                is_iso = false;
+                return;
+            }
+            app_generalize = true;
+            options.generalize_symmetry = false;
+            permutation = defer_permutation(options, header);
+        }
+
+        auto nnz = get_storage_nnz(header, options);
+        rows.resize(nnz);
+        cols.resize(nnz);
+        values.resize(0);
+
+        auto handler = triplet_iso_parse_handler(rows.begin(), cols.begin(), values, nnz);
+        read_matrix_market_body(instream, header, handler, pattern_default_value((const VT*)nullptr), options);
+        is_iso = handler.finish();
+
+        if (app_generalize && header.symmetry != general) {
+            if (is_iso) {
+                generalize_symmetry_pattern(rows, cols, header.symmetry, options);
+            } else {
+                generalize_symmetry_triplet(rows, cols, values, header.symmetry, options);
+            }
+            permute_triplet(rows, cols, permutation);
+        }
+    }
+
     /**
      * Write triplets to a Matrix Market file.
      */
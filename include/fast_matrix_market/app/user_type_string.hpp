@@ -24,6 +24,9 @@
  * ```
  */
 
+#include <string>
+#include <string_view>
+
 namespace fast_matrix_market {
     /**
      * (Needed for read) Parse a value.
@@ -83,4 +86,19 @@ namespace fast_matrix_market {
     inline std::string value_to_string(const std::string& value, [[maybe_unused]] int precision) {
         return value;
     }
+
+    /*
+     * Support writing std::string_view values.
+     *
+     * There is deliberately no read_value() for std::string_view: a view into the chunk being parsed would dangle
+     * once the chunk is done. Read them with the arena readers in app/string_arena.hpp instead.
+     */
+
+    inline field_type get_field_type([[maybe_unused]] const std::string_view* type) {
+        return real;
+    }
+
+    inline std::string value_to_string(const std::string_view& value, [[maybe_unused]] int precision) {
+        return std::string(value);
+    }
 }
@@ -0,0 +1,252 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace fast_matrix_market {
+
+    /**
+     * Source of bytes that the body readers pull chunks from.
+     *
+     * Only read() and good() are required. The other methods are optional capabilities.
+     * std::istream inputs are adapted with istream_source.
+     */
+    class byte_source {
+    public:
+        virtual ~byte_source() = default;
+
+        /**
+         * Read up to `count` bytes into `dest`.
+         *
+         * @return number of bytes read. Fewer than `count` only if the end was reached.
+         */
+        virtual std::size_t read(char* dest, std::size_t count) = 0;
+
+        /**
+         * @return false once the end has been reached.
+         */
+        [[nodiscard]] virtual bool good() const = 0;
+
+        /**
+         * Read the rest of the current line into `line`. The newline is consumed but not stored.
+         *
+         * @return true if the line was terminated by a newline.
+         */
+        virtual bool read_line(std::string& line) {
+            line.clear();
+            char c;
+            while (read(&c, 1) == 1) {
+                if (c == '\n') {
+                    return true;
+                }
+                line += c;
+            }
+            return false;
+        }
+
+        /**
+         * Number of bytes that are known to be available to read, or 0 if unknown. Used as a size hint.
+         */
+        virtual int64_t available() {
+            return 0;
+        }
+
+        /**
+         * Current position, or -1 if the source is not seekable.
+         */
+        virtual int64_t tell() {
+            return -1;
+        }
+
+        /**
+         * Move to an absolute position returned by tell().
+         *
+         * @return false if the source is not seekable.
+         */
+        virtual bool seek([[maybe_unused]] int64_t pos) {
+            return false;
+        }
+
+        /**
+         * @return true if borrow_lines() is supported.
+         */
+        [[nodiscard]] virtual bool can_borrow() const {
+            return false;
+        }
+
+        /**
+         * Lend the next whole lines, about `target_bytes` long, without copying them.
+         *
+         * The view ends just after a newline, or at the end of the data. The bytes are consumed. The view must stay
+         * valid for the lifetime of the source, as chunks are parsed on other threads after later chunks are lent.
+         */
+        virtual std::string_view borrow_lines([[maybe_unused]] std::size_t target_bytes) {
+            return {};
+        }
+    };
+
+    /**
+     * Sink of bytes that the body writers push chunks to.
+     *
+     * std::ostream outputs are adapted with ostream_sink.
+     */
+    class byte_sink {
+    public:
+        virtual ~byte_sink() = default;
+
+        virtual void write(const char* data, std::size_t count) = 0;
+    };
+
+    /**
+     * byte_source that reads from a std::istream. The stream is not read ahead, so it can be used directly again
+     * afterwards.
+     */
+    class istream_source : public byte_source {
+    public:
+        explicit istream_source(std::istream& instream) : instream(instream) {}
+
+        std::size_t read(char* dest, std::size_t count) override {
+            instream.read(dest, (std::streamsize)count);
+            return (std::size_t)instream.gcount();
+        }
+
+        [[nodiscard]] bool good() const override {
+            return instream.good();
+        }
+
+        bool read_line(std::string& line) override {
+            // getline() leaves `line` untouched if the stream is already at its end
+            line.clear();
+            std::getline(instream, line);
+            return instream.good();
+        }
+
+        int64_t available() override {
+            return (int64_t)instream.rdbuf()->in_avail();
+        }
+
+        int64_t tell() override {
+            return (int64_t)instream.tellg();
+        }
+
+        bool seek(int64_t pos) override {
+            instream.clear();
+            return (bool)instream.seekg(pos);
+        }
+
+    protected:
+        std::istream& instream;
+    };
+
+    /**
+     * byte_source over bytes in memory, such as a memory-mapped file. Chunks are lent to the parser without copying.
+     *
+     * The memory must outlive the source and every read that uses it.
+     */
+    class memory_source : public byte_source {
+    public:
+        memory_source(const char* data, std::size_t size) : data(data), size(size) {}
+        explicit memory_source(std::string_view str) : memory_source(str.data(), str.size()) {}
+
+        std::size_t read(char* dest, std::size_t count) override {
+            count = std::min(count, size - pos);
+            std::memcpy(dest, data + pos, count);
+            pos += count;
+            at_end = at_end || pos == size;
+            return count;
+        }
+
+        [[nodiscard]] bool good() const override {
+            return !at_end;
+        }
+
+        bool read_line(std::string& line) override {
+            const char* begin = data + pos;
+            auto newline = static_cast<const char*>(std::memchr(begin, '\n', size - pos));
+            std::size_t length = newline ? (std::size_t)(newline - begin) : size - pos;
+            line.assign(begin, length);
+            pos += length + (newline ? 1 : 0);
+            at_end = at_end || !newline;
+            return newline != nullptr;
+        }
+
+        int64_t available() override {
+            return (int64_t)(size - pos);
+        }
+
+        int64_t tell() override {
+            return (int64_t)pos;
+        }
+
+        bool seek(int64_t new_pos) override {
+            if (new_pos < 0 || (std::size_t)new_pos > size) {
+                return false;
+            }
+            pos = (std::size_t)new_pos;
+            at_end = false;
+            return true;
+        }
+
+        [[nodiscard]] bool can_borrow() const override {
+            return true;
+        }
+
+        std::string_view borrow_lines(std::size_t target_bytes) override {
+            std::size_t end = std::min(pos + std::max(target_bytes, (std::size_t)1), size);
+            if (end < size && data[end - 1] != '\n') {
+                // extend to the end of the line
+                auto newline = static_cast<const char*>(std::memchr(data + end, '\n', size - end));
+                end = newline ? (std::size_t)(newline - data) + 1 : size;
+            }
+
+            std::string_view ret(data + pos, end - pos);
+            pos = end;
+            at_end = at_end || pos == size;
+            return ret;
+        }
+
+    protected:
+        const char* data;
+        std::size_t size;
+        std::size_t pos = 0;
+        bool at_end = false;
+    };
+
+    /**
+     * byte_sink that writes to a std::ostream.
+     */
+    class ostream_sink : public byte_sink {
+    public:
+        explicit ostream_sink(std::ostream& os) : os(os) {}
+
+        void write(const char* data, std::size_t count) override {
+            os.write(data, (std::streamsize)count);
+        }
+
+    protected:
+        std::ostream& os;
+    };
+
+    /**
+     * byte_sink that appends to a std::string.
+     */
+    class string_sink : public byte_sink {
+    public:
+        explicit string_sink(std::string& str) : str(str) {}
+
+        void write(const char* data, std::size_t count) override {
+            str.append(data, count);
+        }
+
+    protected:
+        std::string& str;
+    };
+}
@@ -4,26 +4,34 @@
 
 #pragma once
 
+#include <algorithm>
 #include <istream>
 #include <string>
+#include <string_view>
+
+#include "byte_io.hpp"
 
 namespace fast_matrix_market {
-    inline void get_next_chunk(std::string& chunk, std::istream &instream, const read_options &options) {
+    /**
+     * Smallest chunk buffer worth allocating when sizing chunks to fit small inputs.
+     */
+    constexpr int64_t kMinChunkSizeBytes = 8192;
+
+    inline void get_next_chunk(std::string& chunk, byte_source &source, const read_options &options) {
         constexpr size_t chunk_extra = 4096; // extra chunk bytes to leave room for rest of line
         size_t chunk_length = 0;
 
         // ensure enough space
         chunk.resize(options.chunk_size_bytes);
 
-        // read chunk from the stream
-        auto bytes_to_read = chunk.size() > chunk_extra ? (std::streamsize) (chunk.size() - chunk_extra) : 0;
+        // read chunk from the source
+        auto bytes_to_read = chunk.size() > chunk_extra ? chunk.size() - chunk_extra : 0;
         if (bytes_to_read > 0) {
-            instream.read(chunk.data(), bytes_to_read);
-            auto num_read = instream.gcount();
+            auto num_read = source.read(chunk.data(), bytes_to_read);
             chunk_length = num_read;
 
             // test for EOF
-            if (num_read == 0 || instream.eof() || chunk[chunk_length - 1] == '\n') {
+            if (num_read == 0 || !source.good() || chunk[chunk_length - 1] == '\n') {
                 chunk.resize(chunk_length);
                 return;
             }
@@ -31,8 +39,7 @@ namespace fast_matrix_market {
 
         // Read rest of line and append to the chunk.
         std::string suffix;
-        std::getline(instream, suffix);
-        if (instream.good()) {
+        if (source.read_line(suffix)) {
             suffix += "\n";
         }
 
@@ -48,6 +55,33 @@ namespace fast_matrix_market {
         }
     }
 
+    inline void get_next_chunk(std::string& chunk, std::istream &instream, const read_options &options) {
+        istream_source source(instream);
+        get_next_chunk(chunk, source, options);
+    }
+
+    /**
+     * Get the next chunk, borrowing it from the source without a copy if the source supports it.
+     *
+     * @param buffer holds the chunk if it is copied
+     * @return the chunk. Either a borrowed view that ends in a newline and is followed by more input, or the
+     *         NUL-terminated contents of `buffer`. Parsers that stop at newlines therefore never read past the input.
+     */
+    inline std::string_view get_next_chunk_view(std::string& buffer, byte_source &source, const read_options &options) {
+        if (!source.can_borrow()) {
+            get_next_chunk(buffer, source, options);
+            return buffer;
+        }
+
+        auto view = source.borrow_lines(options.chunk_size_bytes);
+        if (!source.good()) {
+            // the last chunk is copied so that it is terminated
+            buffer.assign(view);
+            return buffer;
+        }
+        return view;
+    }
+
     inline std::string get_next_chunk(std::istream &instream, const read_options &options) {
         // allocate chunk
         std::string chunk(options.chunk_size_bytes, ' ');
@@ -55,6 +89,63 @@ namespace fast_matrix_market {
         return chunk;
     }
 
+    /**
+     * Estimate the number of bytes in a Matrix Market body, based only on the header.
+     *
+     * Used to pick between the sequential and parallel readers. Errs on the low side, as a file that is misjudged
+     * to be small is still read correctly, only without parallelism.
+     */
+    inline int64_t estimate_body_bytes(const matrix_market_header& header) {
+        auto num_digits = [](int64_t n) {
+            int64_t digits = 1;
+            for (; n >= 10; n /= 10) {
+                ++digits;
+            }
+            return digits;
+        };
+
+        int64_t line_bytes = 1; // newline
+        if (header.format == coordinate) {
+            if (header.object == matrix) {
+                line_bytes += num_digits(header.nrows) + 1 + num_digits(header.ncols);
+            } else {
+                line_bytes += num_digits(header.vector_length);
+            }
+        }
+
+        switch (header.field) {
+            case pattern:
+                break;
+            case integer:
+            case unsigned_integer:
+                line_bytes += 3;
+                break;
+            case real:
+            case double_:
+                line_bytes += 8;
+                break;
+            case complex:
+                line_bytes += 16;
+                break;
+        }
+
+        return header.nnz * line_bytes;
+    }
+
+    /**
+     * Estimate the number of bytes remaining to be read from a Matrix Market body.
+     *
+     * Uses the stream's knowledge of how many bytes are available, if any, otherwise falls back on the header.
+     */
+    inline int64_t estimate_body_bytes(byte_source& source, const matrix_market_header& header) {
+        return std::max(estimate_body_bytes(header), source.available());
+    }
+
+    inline int64_t estimate_body_bytes(std::istream& instream, const matrix_market_header& header) {
+        istream_source source(instream);
+        return estimate_body_bytes(source, header);
+    }
+
     template <typename ITER>
     bool is_all_spaces(ITER begin, ITER end) {
         return std::all_of(begin, end, [](char c) { return c == ' ' || c == '\t' || c == '\r'; });
@@ -63,7 +154,7 @@ namespace fast_matrix_market {
     /**
      * Find the number of total lines and empty lines in a multiline string.
      */
-    inline std::pair<int64_t, int64_t> count_lines(const std::string& chunk) {
+    inline std::pair<int64_t, int64_t> count_lines(std::string_view chunk) {
         int64_t num_newlines = 0;
         int64_t num_empty_lines = 0;
 
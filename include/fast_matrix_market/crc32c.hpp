@@ -0,0 +1,282 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string_view>
+
+#include "fast_matrix_market.hpp"
+
+#if defined(__SSE4_2__)
+#define FMM_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+// Compile the hardware path anyway and select it at runtime.
+#define FMM_CRC32C_SSE42 1
+#define FMM_CRC32C_RUNTIME_DISPATCH 1
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define FMM_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace fast_matrix_market {
+
+    /**
+     * The data does not match its checksum.
+     */
+    class checksum_error : public fmm_error {
+    public:
+        explicit checksum_error(std::string msg): fmm_error(std::move(msg)) {}
+    };
+
+    namespace crc32c_detail {
+        // Castagnoli polynomial, reflected
+        constexpr uint32_t kPoly = 0x82f63b78U;
+
+        using table_type = std::array<std::array<uint32_t, 256>, 8>;
+
+        inline const table_type& tables() {
+            static const table_type ret = [] {
+                table_type t{};
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; ++k) {
+                        c = (c & 1U) ? (c >> 1U) ^ kPoly : c >> 1U;
+                    }
+                    t[0][i] = c;
+                }
+                for (uint32_t i = 0; i < 256; ++i) {
+                    for (int k = 1; k < 8; ++k) {
+                        t[k][i] = (t[k - 1][i] >> 8U) ^ t[0][t[k - 1][i] & 0xffU];
+                    }
+                }
+                return t;
+            }();
+            return ret;
+        }
+
+        /**
+         * Slicing-by-8 software implementation. Operates on the raw (not inverted) CRC register.
+         */
+        inline uint32_t update_software(uint32_t c, const unsigned char* pos, std::size_t size) {
+            const auto& t = tables();
+            for (; size >= 8; size -= 8, pos += 8) {
+                uint32_t lo = c ^ ((uint32_t)pos[0] | ((uint32_t)pos[1] << 8U) |
+                                   ((uint32_t)pos[2] << 16U) | ((uint32_t)pos[3] << 24U));
+                c = t[7][lo & 0xffU] ^ t[6][(lo >> 8U) & 0xffU] ^ t[5][(lo >> 16U) & 0xffU] ^ t[4][lo >> 24U] ^
+                    t[3][pos[4]] ^ t[2][pos[5]] ^ t[1][pos[6]] ^ t[0][pos[7]];
+            }
+            for (; size > 0; --size, ++pos) {
+                c = (c >> 8U) ^ t[0][(c ^ *pos) & 0xffU];
+            }
+            return c;
+        }
+
+#ifdef FMM_CRC32C_SSE42
+#ifdef FMM_CRC32C_RUNTIME_DISPATCH
+        __attribute__((target("sse4.2")))
+#endif
+        inline uint32_t update_hardware(uint32_t c, const unsigned char* pos, std::size_t size) {
+            uint64_t c64 = c;
+            for (; size >= 8; size -= 8, pos += 8) {
+                uint64_t word;
+                std::memcpy(&word, pos, 8);
+                c64 = _mm_crc32_u64(c64, word);
+            }
+            c = (uint32_t)c64;
+            for (; size > 0; --size, ++pos) {
+                c = _mm_crc32_u8(c, *pos);
+            }
+            return c;
+        }
+
+        inline bool has_hardware() {
+#ifdef FMM_CRC32C_RUNTIME_DISPATCH
+            static const bool ret = __builtin_cpu_supports("sse4.2");
+            return ret;
+#else
+            return true;
+#endif
+        }
+#elif defined(FMM_CRC32C_ARM)
+        inline uint32_t update_hardware(uint32_t c, const unsigned char* pos, std::size_t size) {
+            for (; size >= 8; size -= 8, pos += 8) {
+                uint64_t word;
+                std::memcpy(&word, pos, 8);
+                c = __crc32cd(c, word);
+            }
+            for (; size > 0; --size, ++pos) {
+                c = __crc32cb(c, *pos);
+            }
+            return c;
+        }
+
+        inline bool has_hardware() {
+            return true;
+        }
+#else
+        inline uint32_t update_hardware(uint32_t c, const unsigned char* pos, std::size_t size) {
+            return update_software(c, pos, size);
+        }
+
+        inline bool has_hardware() {
+            return false;
+        }
+#endif
+
+        /**
+         * Multiply a and b modulo the polynomial.
+         */
+        inline uint32_t multmodp(uint32_t a, uint32_t b) {
+            uint32_t m = 1U << 31U;
+            uint32_t p = 0;
+            while (true) {
+                if (a & m) {
+                    p ^= b;
+                    if ((a & (m - 1)) == 0) {
+                        break;
+                    }
+                }
+                m >>= 1U;
+                b = (b & 1U) ? (b >> 1U) ^ kPoly : b >> 1U;
+            }
+            return p;
+        }
+
+        /**
+         * x^(n * 2^k) modulo the polynomial.
+         */
+        inline uint32_t x2nmodp(uint64_t n, unsigned k) {
+            static const std::array<uint32_t, 32> x2n_table = [] {
+                std::array<uint32_t, 32> ret{};
+                uint32_t p = 1U << 30U; // x^1
+                ret[0] = p;
+                for (std::size_t i = 1; i < ret.size(); ++i) {
+                    ret[i] = p = multmodp(p, p);
+                }
+                return ret;
+            }();
+
+            uint32_t p = 1U << 31U; // x^0
+            while (n) {
+                if (n & 1U) {
+                    p = multmodp(x2n_table[k & 31U], p);
+                }
+                n >>= 1U;
+                k++;
+            }
+            return p;
+        }
+    }
+
+    /**
+     * CRC32C (Castagnoli) of `data`, continuing from the CRC32C `crc` of any preceding data.
+     *
+     * Uses the SSE 4.2 or ARMv8 CRC instructions if available.
+     */
+    inline uint32_t crc32c(std::string_view data, uint32_t crc = 0) {
+        auto pos = reinterpret_cast<const unsigned char*>(data.data());
+        uint32_t c = ~crc;
+        if (crc32c_detail::has_hardware()) {
+            c = crc32c_detail::update_hardware(c, pos, data.size());
+        } else {
+            c = crc32c_detail::update_software(c, pos, data.size());
+        }
+        return ~c;
+    }
+
+    /**
+     * CRC32C of the concatenation of two byte sequences, given the CRC32C of each and the length of the second.
+     */
+    inline uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, int64_t length2) {
+        return crc32c_detail::multmodp(crc32c_detail::x2nmodp((uint64_t)length2, 3), crc1) ^ crc2;
+    }
+
+    /**
+     * Combines chunk checksums, in order, into a body_checksum.
+     */
+    class checksum_accumulator {
+    public:
+        explicit checksum_accumulator(bool record_ranges = false) : record_ranges(record_ranges) {}
+
+        void add(uint32_t chunk_crc, int64_t chunk_bytes) {
+            if (record_ranges) {
+                result.ranges.push_back(body_checksum::range{result.num_bytes, chunk_bytes, chunk_crc});
+            }
+            result.crc32c = crc32c_combine(result.crc32c, chunk_crc, chunk_bytes);
+            result.num_bytes += chunk_bytes;
+        }
+
+        /**
+         * Throw checksum_error if the accumulated checksum does not match `expected`.
+         */
+        void verify(const body_checksum& expected) const {
+            if (result.num_bytes != expected.num_bytes || result.crc32c != expected.crc32c) {
+                std::ostringstream oss;
+                oss << "Checksum mismatch. Expected CRC32C " << std::hex << expected.crc32c << std::dec
+                    << " of " << expected.num_bytes << " bytes, read " << std::hex << result.crc32c << std::dec
+                    << " of " << result.num_bytes << " bytes.";
+                throw checksum_error(oss.str());
+            }
+        }
+
+        body_checksum result;
+    protected:
+        bool record_ranges;
+    };
+
+    /**
+     * Write a checksum sidecar. One line with the body checksum, then one line per range:
+     *     crc32c <hex crc> <bytes>
+     *     range <offset> <bytes> <hex crc>
+     */
+    inline void write_checksum_sidecar(std::ostream& os, const body_checksum& checksum) {
+        auto hex = [](uint32_t crc) {
+            std::ostringstream oss;
+            oss << std::hex << std::setw(8) << std::setfill('0') << crc;
+            return oss.str();
+        };
+
+        os << "crc32c " << hex(checksum.crc32c) << " " << checksum.num_bytes << "\n";
+        for (const auto& r : checksum.ranges) {
+            os << "range " << r.offset << " " << r.num_bytes << " " << hex(r.crc32c) << "\n";
+        }
+    }
+
+    /**
+     * Read a checksum sidecar written by write_checksum_sidecar().
+     */
+    inline body_checksum read_checksum_sidecar(std::istream& instream) {
+        body_checksum ret;
+        std::string line;
+        bool found = false;
+        while (std::getline(instream, line)) {
+            std::istringstream iss(line);
+            std::string kind;
+            iss >> kind;
+            if (kind == "crc32c") {
+                iss >> std::hex >> ret.crc32c >> std::dec >> ret.num_bytes;
+                found = !iss.fail();
+            } else if (kind == "range") {
+                body_checksum::range r{};
+                iss >> r.offset >> r.num_bytes >> std::hex >> r.crc32c;
+                if (iss.fail()) {
+                    throw invalid_argument("Invalid checksum range line: " + line);
+                }
+                ret.ranges.push_back(r);
+            }
+        }
+        if (!found) {
+            throw invalid_argument("Checksum sidecar has no crc32c line.");
+        }
+        return ret;
+    }
+}
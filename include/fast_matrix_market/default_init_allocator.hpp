@@ -0,0 +1,55 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fast_matrix_market {
+    /**
+     * Allocator adaptor that default-initializes instead of value-initializes. For trivial types such as int or
+     * double this means `resize()` leaves new elements uninitialized instead of zero-filling them.
+     *
+     * The readers size the output vectors and then overwrite every element, often from many threads. With this
+     * allocator the sizing does not make an extra pass over memory, and pages are first touched by the parser threads.
+     */
+    template <typename T, typename A = std::allocator<T>>
+    class default_init_allocator : public A {
+        using traits = std::allocator_traits<A>;
+    public:
+        template <typename U>
+        struct rebind {
+            using other = default_init_allocator<U, typename traits::template rebind_alloc<U>>;
+        };
+
+        using A::A;
+
+        template <typename U>
+        void construct(U* ptr) noexcept(std::is_nothrow_default_constructible<U>::value) {
+            ::new(static_cast<void*>(ptr)) U;
+        }
+
+        template <typename U, typename... ARGS>
+        void construct(U* ptr, ARGS&&... args) {
+            traits::construct(static_cast<A&>(*this), ptr, std::forward<ARGS>(args)...);
+        }
+    };
+
+    /**
+     * A std::vector whose `resize()` does not initialize new trivial elements.
+     */
+    template <typename T>
+    using uninitialized_vector = std::vector<T, default_init_allocator<T>>;
+
+    /**
+     * Like `std::make_unique<T[]>(size)`, but default-initializes the elements.
+     */
+    template <typename T>
+    std::unique_ptr<T[]> make_uninitialized_array(std::size_t size) {
+        return std::unique_ptr<T[]>(new T[size]);
+    }
+}
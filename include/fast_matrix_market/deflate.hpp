@@ -0,0 +1,619 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/**
+ * Deflate (RFC 1951) decoder for a chunk of a stream whose preceding data is not known yet. Used by gzip.hpp to
+ * decompress single-member gzip files in parallel. Requires no library.
+ *
+ * The chunk is decoded from the first offset where a dynamic Huffman block header is valid and the block decodes.
+ * Back-references into the 32 KiB that precede the chunk are written as markers, which are replaced by the actual
+ * bytes once the preceding chunk is done. After 32 KiB of output without markers, later output cannot reference
+ * the unknown window any more, so the rest of the chunk is decoded straight to bytes.
+ *
+ * The block found by search may be a false positive. A chunk is only correct if it starts where the preceding
+ * chunk's decoding ended, so the caller must check that. This is the approach of pugz and rapidgzip.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace fast_matrix_market {
+
+    constexpr std::size_t kDeflateWindowSize = 1U << 15U;
+
+    /**
+     * Decoded symbols at or above this are markers for byte `symbol - kDeflateMarkerBase` of the unknown window
+     * that precedes a chunk. Byte 0 is the oldest.
+     */
+    constexpr uint16_t kDeflateMarkerBase = 1U << 15U;
+
+    /**
+     * Reads a deflate stream's bits, least significant bit of each byte first.
+     */
+    class deflate_bit_reader {
+    public:
+        deflate_bit_reader(const uint8_t* data, std::size_t size, int64_t bit_pos) :
+                data(data), size(size), byte_pos((std::size_t)(bit_pos / 8)) {
+            refill();
+            consume((unsigned)(bit_pos % 8));
+        }
+
+        /**
+         * Buffer at least 56 bits. Zeros are read past the end of the data, see overrun().
+         */
+        void refill() {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            if (byte_pos + 8 <= size) {
+                // Load 8 bytes at once. The bits above num_bits are the bytes that the next refill loads again.
+                uint64_t word;
+                std::memcpy(&word, data + byte_pos, 8);
+                bits |= word << num_bits;
+                auto num_bytes = (63 - num_bits) / 8;
+                byte_pos += num_bytes;
+                num_bits += num_bytes * 8;
+                return;
+            }
+#endif
+            while (num_bits <= 56) {
+                uint64_t byte = byte_pos < size ? data[byte_pos] : 0;
+                bits |= byte << num_bits;
+                ++byte_pos;
+                num_bits += 8;
+            }
+        }
+
+        [[nodiscard]] uint32_t peek(unsigned n) const {
+            return (uint32_t)(bits & ((uint64_t(1) << n) - 1));
+        }
+
+        void consume(unsigned n) {
+            bits >>= n;
+            num_bits -= n;
+        }
+
+        uint32_t read(unsigned n) {
+            refill();
+            return read_buffered(n);
+        }
+
+        /**
+         * read() if at least `n` bits are buffered.
+         */
+        uint32_t read_buffered(unsigned n) {
+            auto ret = peek(n);
+            consume(n);
+            return ret;
+        }
+
+        void align_to_byte() {
+            consume(num_bits % 8);
+        }
+
+        [[nodiscard]] int64_t position() const {
+            return (int64_t)byte_pos * 8 - num_bits;
+        }
+
+        /**
+         * Whether more bits were read than the data has.
+         */
+        [[nodiscard]] bool overrun() const {
+            return position() > (int64_t)size * 8;
+        }
+
+    protected:
+        const uint8_t* data;
+        std::size_t size;
+        std::size_t byte_pos;
+        uint64_t bits = 0;
+        unsigned num_bits = 0;
+    };
+
+    /**
+     * Canonical Huffman code, decoded with a single lookup table indexed by the next bits of input.
+     */
+    class deflate_huffman {
+    public:
+        /**
+         * Build the code for the given code lengths. Follows zlib: a code may not be oversubscribed, and only a
+         * single code of length 1 may be incomplete. Codes with no symbols are accepted but decode nothing.
+         *
+         * @param is_code_length_code the code that encodes the other codes' lengths must be complete.
+         * @return false if the lengths are not a valid code.
+         */
+        bool build(const uint8_t* lengths, unsigned num_symbols, bool is_code_length_code) {
+            std::array<unsigned, 16> count{};
+            unsigned max_length = 0;
+            for (unsigned sym = 0; sym < num_symbols; ++sym) {
+                ++count[lengths[sym]];
+                max_length = std::max(max_length, (unsigned)lengths[sym]);
+            }
+            count[0] = 0;
+
+            int left = 1;
+            for (unsigned len = 1; len < 16; ++len) {
+                left <<= 1;
+                left -= (int)count[len];
+                if (left < 0) {
+                    // oversubscribed
+                    return false;
+                }
+            }
+            if (max_length == 0) {
+                if (is_code_length_code) {
+                    return false;
+                }
+            } else if (left > 0 && (is_code_length_code || max_length != 1)) {
+                // incomplete
+                return false;
+            }
+
+            table_bits = max_length;
+            table.assign(std::size_t(1) << table_bits, 0);
+
+            std::array<unsigned, 16> next_code{};
+            unsigned code = 0;
+            for (unsigned len = 1; len <= max_length; ++len) {
+                code = (code + count[len - 1]) << 1U;
+                next_code[len] = code;
+            }
+
+            for (unsigned sym = 0; sym < num_symbols; ++sym) {
+                unsigned len = lengths[sym];
+                if (len == 0) {
+                    continue;
+                }
+                // Codes are stored most significant bit first, but read least significant bit first.
+                unsigned c = next_code[len]++;
+                unsigned reversed = 0;
+                for (unsigned i = 0; i < len; ++i) {
+                    reversed = (reversed << 1U) | ((c >> i) & 1U);
+                }
+                for (std::size_t i = reversed; i < table.size(); i += std::size_t(1) << len) {
+                    table[i] = (uint16_t)((sym << 4U) | len);
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @return the next symbol, or -1 if the input is not a code.
+         */
+        int decode(deflate_bit_reader& in) const {
+            in.refill();
+            return decode_buffered(in);
+        }
+
+        /**
+         * decode() if at least 15 bits are buffered.
+         */
+        int decode_buffered(deflate_bit_reader& in) const {
+            uint16_t entry = table[in.peek(table_bits)];
+            if (entry == 0) {
+                return -1;
+            }
+            in.consume(entry & 15U);
+            return entry >> 4U;
+        }
+
+    protected:
+        // symbol << 4 | code length. 0 if no code matches.
+        std::vector<uint16_t> table = std::vector<uint16_t>(1, 0);
+        unsigned table_bits = 0;
+    };
+
+    /**
+     * Codes of a dynamic Huffman block, and scratch space to build them.
+     */
+    struct deflate_codes {
+        deflate_huffman literal_length;
+        deflate_huffman distance;
+        deflate_huffman code_length;
+    };
+
+    /**
+     * Read the code definitions at the start of a dynamic Huffman block, after the 3-bit block header.
+     *
+     * @return false if they are not valid.
+     */
+    inline bool read_deflate_dynamic_codes(deflate_bit_reader& in, deflate_codes& codes) {
+        static constexpr std::array<uint8_t, 19> order = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+        unsigned num_literal_length = in.read(5) + 257;
+        unsigned num_distance = in.read(5) + 1;
+        unsigned num_code_length = in.read(4) + 4;
+        if (num_literal_length > 286 || num_distance > 30) {
+            return false;
+        }
+
+        std::array<uint8_t, 19> code_length_lengths{};
+        for (unsigned i = 0; i < num_code_length; ++i) {
+            code_length_lengths[order[i]] = (uint8_t)in.read(3);
+        }
+        if (!codes.code_length.build(code_length_lengths.data(), 19, true)) {
+            return false;
+        }
+
+        std::array<uint8_t, 286 + 30> lengths{};
+        unsigned total = num_literal_length + num_distance;
+        unsigned n = 0;
+        while (n < total) {
+            int sym = codes.code_length.decode(in);
+            if (sym < 0) {
+                return false;
+            }
+            if (sym < 16) {
+                lengths[n++] = (uint8_t)sym;
+                continue;
+            }
+
+            uint8_t value = 0;
+            unsigned repeat;
+            if (sym == 16) {
+                if (n == 0) {
+                    return false;
+                }
+                value = lengths[n - 1];
+                repeat = 3 + in.read(2);
+            } else if (sym == 17) {
+                repeat = 3 + in.read(3);
+            } else {
+                repeat = 11 + in.read(7);
+            }
+            if (n + repeat > total) {
+                return false;
+            }
+            std::fill_n(lengths.begin() + n, repeat, value);
+            n += repeat;
+        }
+
+        if (lengths[256] == 0) {
+            // no end-of-block code
+            return false;
+        }
+        return codes.literal_length.build(lengths.data(), num_literal_length, false) &&
+               codes.distance.build(lengths.data() + num_literal_length, num_distance, false);
+    }
+
+    /**
+     * Codes of fixed Huffman blocks.
+     */
+    inline const deflate_codes& deflate_fixed_codes() {
+        static const deflate_codes ret = [] {
+            deflate_codes codes;
+            std::array<uint8_t, 288> lengths{};
+            std::fill(lengths.begin(), lengths.begin() + 144, 8);
+            std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+            std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+            std::fill(lengths.begin() + 280, lengths.end(), 8);
+            codes.literal_length.build(lengths.data(), 288, false);
+
+            std::fill(lengths.begin(), lengths.begin() + 30, 5);
+            codes.distance.build(lengths.data(), 30, false);
+            return codes;
+        }();
+        return ret;
+    }
+
+    /**
+     * Decoded symbols, after a window of kDeflateWindowSize symbols that back-references can reach into.
+     *
+     * @tparam CONTAINER std::string for bytes, std::vector<uint16_t> for bytes and markers.
+     */
+    template <typename CONTAINER>
+    struct deflate_output {
+        CONTAINER symbols;
+        std::size_t size = 0;
+        // Index of the last marker. Only tracked for markers.
+        std::size_t last_marker = 0;
+
+        void reserve_more(std::size_t n) {
+            if (size + n > symbols.size()) {
+                symbols.resize(std::max(symbols.size() * 2, size + n));
+            }
+        }
+    };
+
+    enum class deflate_status {ok, invalid, out_of_data};
+
+    /**
+     * Decode the symbols of a Huffman block, up to and including the end-of-block code.
+     */
+    template <typename CONTAINER>
+    deflate_status inflate_deflate_block_data(deflate_bit_reader& in, const deflate_codes& codes,
+                                              deflate_output<CONTAINER>& out, int64_t data_bits) {
+        using SYM = typename CONTAINER::value_type;
+        static constexpr std::array<uint16_t, 29> length_base = {
+                3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr std::array<uint8_t, 29> length_extra = {
+                0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr std::array<uint16_t, 30> distance_base = {
+                1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+                4097, 6145, 8193, 12289, 16385, 24577};
+        static constexpr std::array<uint8_t, 30> distance_extra = {
+                0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        while (true) {
+            // Past the end of the data the reader returns zeros, which may decode forever.
+            if (in.position() > data_bits) {
+                return deflate_status::out_of_data;
+            }
+
+            out.reserve_more(258);
+            SYM* buf = out.symbols.data();
+
+            // One refill covers the longest symbol: 15 + 5 length bits and 15 + 13 distance bits.
+            in.refill();
+            int sym = codes.literal_length.decode_buffered(in);
+            if (sym < 0) {
+                return deflate_status::invalid;
+            }
+            if (sym < 256) {
+                buf[out.size++] = (SYM)sym;
+                continue;
+            }
+            if (sym == 256) {
+                return deflate_status::ok;
+            }
+
+            sym -= 257;
+            if (sym >= 29) {
+                return deflate_status::invalid;
+            }
+            std::size_t length = length_base[sym] + in.read_buffered(length_extra[sym]);
+
+            int dist_sym = codes.distance.decode_buffered(in);
+            if (dist_sym < 0 || dist_sym >= 30) {
+                return deflate_status::invalid;
+            }
+            std::size_t distance = distance_base[dist_sym] + in.read_buffered(distance_extra[dist_sym]);
+            if (distance > out.size) {
+                return deflate_status::invalid;
+            }
+
+            SYM* dest = buf + out.size;
+            const SYM* src = dest - distance;
+            if constexpr (std::is_same_v<SYM, uint16_t>) {
+                for (std::size_t i = 0; i < length; ++i) {
+                    dest[i] = src[i];
+                    if (dest[i] >= kDeflateMarkerBase) {
+                        out.last_marker = out.size + i;
+                    }
+                }
+            } else if (distance >= length) {
+                std::memcpy(dest, src, length);
+            } else {
+                // the source and destination overlap
+                for (std::size_t i = 0; i < length; ++i) {
+                    dest[i] = src[i];
+                }
+            }
+            out.size += length;
+        }
+    }
+
+    /**
+     * Decode one block, including its header.
+     */
+    template <typename CONTAINER>
+    deflate_status inflate_deflate_block(deflate_bit_reader& in, deflate_codes& codes, deflate_output<CONTAINER>& out,
+                                         int64_t data_bits, bool& is_final) {
+        using SYM = typename CONTAINER::value_type;
+
+        is_final = in.read(1) != 0;
+        unsigned type = in.read(2);
+
+        deflate_status status;
+        if (type == 0) {
+            // stored
+            in.align_to_byte();
+            unsigned length = in.read(16);
+            unsigned inverse = in.read(16);
+            if (length != (~inverse & 0xffffU)) {
+                return deflate_status::invalid;
+            }
+            out.reserve_more(length);
+            for (unsigned i = 0; i < length; ++i) {
+                out.symbols[out.size++] = (SYM)in.read(8);
+            }
+            status = deflate_status::ok;
+        } else if (type == 1) {
+            status = inflate_deflate_block_data(in, deflate_fixed_codes(), out, data_bits);
+        } else if (type == 2) {
+            if (!read_deflate_dynamic_codes(in, codes)) {
+                status = deflate_status::invalid;
+            } else {
+                status = inflate_deflate_block_data(in, codes, out, data_bits);
+            }
+        } else {
+            status = deflate_status::invalid;
+        }
+
+        if (in.overrun()) {
+            return deflate_status::out_of_data;
+        }
+        return status;
+    }
+
+    /**
+     * A chunk decoded without knowing the data that precedes it.
+     */
+    struct deflate_chunk {
+        /**
+         * Bit offset of the first block. -1 if no block was found.
+         */
+        int64_t begin_bit = -1;
+
+        /**
+         * Bit offset after the last decoded block.
+         */
+        int64_t end_bit = -1;
+
+        /**
+         * Whether the last decoded block is the final block of the stream.
+         */
+        bool final = false;
+
+        /**
+         * The start of the output, which may contain markers. See resolve_deflate_markers().
+         */
+        std::vector<uint16_t> marked;
+
+        /**
+         * The rest of the output.
+         */
+        std::string plain;
+    };
+
+    /**
+     * Decode blocks from `begin_bit` until the first block that starts at or after `stop_bit`, or to the end of
+     * the final block. Decoding also stops before a block that runs past the end of the data.
+     *
+     * @return false if the first block is not valid or does not fit in the data.
+     */
+    inline bool inflate_deflate_chunk(const uint8_t* data, std::size_t size, int64_t begin_bit, int64_t stop_bit,
+                                      deflate_codes& codes, deflate_chunk& chunk) {
+        const auto data_bits = (int64_t)size * 8;
+        deflate_bit_reader in(data, size, begin_bit);
+
+        deflate_output<std::vector<uint16_t>> marked;
+        marked.symbols.resize(2 * kDeflateWindowSize);
+        for (std::size_t i = 0; i < kDeflateWindowSize; ++i) {
+            marked.symbols[i] = (uint16_t)(kDeflateMarkerBase + i);
+        }
+        marked.size = kDeflateWindowSize;
+        marked.last_marker = kDeflateWindowSize - 1;
+
+        deflate_output<std::string> plain;
+        bool markers_done = false;
+
+        chunk = deflate_chunk();
+        bool first = true;
+        while (first || in.position() < stop_bit) {
+            bool is_final = false;
+            deflate_status status;
+            std::size_t block_begin_size;
+            if (!markers_done) {
+                block_begin_size = marked.size;
+                status = inflate_deflate_block(in, codes, marked, data_bits, is_final);
+            } else {
+                block_begin_size = plain.size;
+                status = inflate_deflate_block(in, codes, plain, data_bits, is_final);
+            }
+
+            if (status != deflate_status::ok) {
+                if (first || status == deflate_status::invalid) {
+                    // a false positive, or a corrupt stream
+                    return false;
+                }
+                // keep the complete blocks
+                (markers_done ? plain.size : marked.size) = block_begin_size;
+                break;
+            }
+
+            first = false;
+            chunk.end_bit = in.position();
+            if (is_final) {
+                chunk.final = true;
+                break;
+            }
+
+            if (!markers_done && marked.size - marked.last_marker > kDeflateWindowSize) {
+                // The last window has no markers, so nothing after this can reference the unknown window.
+                plain.symbols.resize(2 * kDeflateWindowSize);
+                std::copy(marked.symbols.begin() + (std::ptrdiff_t)(marked.size - kDeflateWindowSize),
+                          marked.symbols.begin() + (std::ptrdiff_t)marked.size,
+                          plain.symbols.begin());
+                plain.size = kDeflateWindowSize;
+                markers_done = true;
+            }
+        }
+
+        chunk.begin_bit = begin_bit;
+        chunk.marked.assign(marked.symbols.begin() + kDeflateWindowSize, marked.symbols.begin() + (std::ptrdiff_t)marked.size);
+        if (markers_done) {
+            plain.symbols.resize(plain.size);
+            plain.symbols.erase(0, kDeflateWindowSize);
+            chunk.plain = std::move(plain.symbols);
+        }
+        return true;
+    }
+
+    /**
+     * Whether a non-final dynamic Huffman block could start at `bit`, judging by the first 17 bits only.
+     */
+    inline bool could_be_deflate_dynamic_block(const uint8_t* data, std::size_t size, int64_t bit) {
+        auto byte = (std::size_t)(bit / 8);
+        if (byte + 3 >= size) {
+            return false;
+        }
+        uint32_t v = (uint32_t)data[byte] | ((uint32_t)data[byte + 1] << 8U) | ((uint32_t)data[byte + 2] << 16U) |
+                     ((uint32_t)data[byte + 3] << 24U);
+        v >>= (unsigned)(bit % 8);
+        // BFINAL = 0, BTYPE = 2, and at most 286 literal/length and 30 distance codes
+        return (v & 7U) == 4U && ((v >> 3U) & 31U) < 30U && ((v >> 8U) & 31U) < 30U;
+    }
+
+    /**
+     * Search [search_begin_bit, search_end_bit) for the first non-final dynamic Huffman block whose codes are valid
+     * and that decodes, and decode from there (see inflate_deflate_chunk()).
+     *
+     * Stored and fixed Huffman blocks have too little structure to be told apart from random bits, so they are
+     * not searched for.
+     *
+     * @return the chunk, with begin_bit -1 if none was found.
+     */
+    inline deflate_chunk inflate_deflate_chunk_speculative(const uint8_t* data, std::size_t size,
+                                                           int64_t search_begin_bit, int64_t search_end_bit,
+                                                           int64_t stop_bit) {
+        deflate_codes codes;
+        deflate_chunk chunk;
+        for (int64_t bit = search_begin_bit; bit < search_end_bit; ++bit) {
+            if (!could_be_deflate_dynamic_block(data, size, bit)) {
+                continue;
+            }
+
+            // Check the codes before allocating any output.
+            deflate_bit_reader in(data, size, bit + 3);
+            if (!read_deflate_dynamic_codes(in, codes)) {
+                continue;
+            }
+
+            if (inflate_deflate_chunk(data, size, bit, stop_bit, codes, chunk)) {
+                return chunk;
+            }
+        }
+        return {};
+    }
+
+    /**
+     * Replace the markers in `marked` with bytes of `window`, and append the result to `out`.
+     *
+     * @param window the data that precedes the chunk; the last kDeflateWindowSize bytes, or all of it if shorter.
+     * @return false if a marker refers to a byte before the start of the window.
+     */
+    inline bool resolve_deflate_markers(const std::vector<uint16_t>& marked, const std::string& window, std::string& out) {
+        std::size_t begin = out.size();
+        out.resize(begin + marked.size());
+        for (std::size_t i = 0; i < marked.size(); ++i) {
+            uint16_t sym = marked[i];
+            if (sym < 256) {
+                out[begin + i] = (char)sym;
+                continue;
+            }
+            std::size_t from_end = kDeflateWindowSize - (sym - kDeflateMarkerBase);
+            if (from_end > window.size()) {
+                return false;
+            }
+            out[begin + i] = window[window.size() - from_end];
+        }
+        return true;
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/**
+ * Explicit instantiations of the triplet, CSC and array read and write methods for common index and value types.
+ *
+ * Included by fast_matrix_market.hpp if FMM_EXTERN_TEMPLATES is defined. The `extern template` declarations then
+ * stop each translation unit from instantiating the parse and format stack for these types, and the definitions are
+ * linked from the fast_matrix_market::instantiated library instead. Other types are instantiated as usual.
+ *
+ * The library is compiled with the default configuration, so consumers must not define FMM_* feature macros
+ * (such as FMM_NO_VECTOR) that change the instantiated code.
+ */
+
+#include <complex>
+#include <vector>
+
+#include "fast_matrix_market.hpp"
+
+// src/instantiations.cpp defines FMM_EXTERN as empty to turn the declarations into definitions.
+#ifndef FMM_EXTERN
+#define FMM_EXTERN extern
+#endif
+
+#define FMM_INSTANTIATE_TRIPLET(IT, VT)                                                                               \
+    FMM_EXTERN template void read_matrix_market_body_triplet<std::vector<IT>, std::vector<VT>, VT>(                   \
+        std::istream&, const matrix_market_header&, std::vector<IT>&, std::vector<IT>&, std::vector<VT>&, VT,          \
+        read_options);                                                                                                 \
+    FMM_EXTERN template void read_matrix_market_triplet<std::vector<IT>, std::vector<VT>>(                            \
+        std::istream&, matrix_market_header&, std::vector<IT>&, std::vector<IT>&, std::vector<VT>&,                    \
+        const read_options&);                                                                                          \
+    FMM_EXTERN template void read_matrix_market_triplet<std::vector<IT>, std::vector<VT>, int64_t>(                   \
+        std::istream&, int64_t&, int64_t&, std::vector<IT>&, std::vector<IT>&, std::vector<VT>&,                       \
+        const read_options&);                                                                                          \
+    FMM_EXTERN template void write_matrix_market_triplet<std::vector<IT>, std::vector<VT>>(                           \
+        std::ostream&, matrix_market_header, const std::vector<IT>&, const std::vector<IT>&, const std::vector<VT>&,   \
+        const write_options&);                                                                                         \
+    FMM_EXTERN template void write_matrix_market_csc<std::vector<IT>, std::vector<VT>>(                               \
+        std::ostream&, matrix_market_header, const std::vector<IT>&, const std::vector<IT>&, const std::vector<VT>&,   \
+        bool, const write_options&);
+
+#define FMM_INSTANTIATE_ARRAY(VT)                                                                                     \
+    FMM_EXTERN template void read_matrix_market_array<std::vector<VT>>(                                               \
+        std::istream&, matrix_market_header&, std::vector<VT>&, storage_order, const read_options&);                  \
+    FMM_EXTERN template void read_matrix_market_array<std::vector<VT>, int64_t>(                                      \
+        std::istream&, int64_t&, int64_t&, std::vector<VT>&, storage_order, const read_options&);                     \
+    FMM_EXTERN template void write_matrix_market_array<std::vector<VT>>(                                              \
+        std::ostream&, matrix_market_header, const std::vector<VT>&, storage_order, const write_options&);
+
+namespace fast_matrix_market {
+    FMM_INSTANTIATE_TRIPLET(int32_t, double)
+    FMM_INSTANTIATE_TRIPLET(int32_t, float)
+    FMM_INSTANTIATE_TRIPLET(int32_t, int64_t)
+    FMM_INSTANTIATE_TRIPLET(int32_t, std::complex<double>)
+    FMM_INSTANTIATE_TRIPLET(int64_t, double)
+    FMM_INSTANTIATE_TRIPLET(int64_t, float)
+    FMM_INSTANTIATE_TRIPLET(int64_t, int64_t)
+    FMM_INSTANTIATE_TRIPLET(int64_t, std::complex<double>)
+
+    FMM_INSTANTIATE_ARRAY(double)
+    FMM_INSTANTIATE_ARRAY(float)
+    FMM_INSTANTIATE_ARRAY(int64_t)
+    FMM_INSTANTIATE_ARRAY(std::complex<double>)
+}
+
+#undef FMM_INSTANTIATE_TRIPLET
+#undef FMM_INSTANTIATE_ARRAY
+#undef FMM_EXTERN
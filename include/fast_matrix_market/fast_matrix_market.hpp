@@ -17,6 +17,8 @@
 #include <vector>
 
 #include "types.hpp"
+#include "trace.hpp"
+#include "default_init_allocator.hpp"
 
 // Support std::string as a user type
 #include "app/user_type_string.hpp"
@@ -59,6 +61,14 @@ namespace fast_matrix_market {
         void prepend_line_number(int64_t line_num) {
             msg = std::string("Line ") + std::to_string(line_num) + ": " + msg;
         }
+
+        /**
+         * For text parsed apart from the rest of the file, where file line numbers are not known. The line number
+         * in the message is then relative to the start of the chunk at `byte_offset`.
+         */
+        void prepend_chunk_offset(int64_t byte_offset) {
+            msg = std::string("Chunk at byte ") + std::to_string(byte_offset) + ": " + msg;
+        }
     };
 
     /**
@@ -152,6 +162,24 @@ namespace fast_matrix_market {
         return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
     }
 
+    /**
+     * Apply a row or column permutation (see read_options and write_options) to a zero-based index.
+     * A null permutation is the identity.
+     *
+     * The permutation must have an entry for every index below `n`. Only its entries are checked, not its length.
+     */
+    template <typename IT>
+    IT permute_index(const IT index, const int64_t* permutation, int64_t n) {
+        if (permutation == nullptr) {
+            return index;
+        }
+        int64_t ret = permutation[index];
+        if (ret < 0 || ret >= n) {
+            throw invalid_argument("Permutation maps index " + std::to_string(index) + " out of bounds.");
+        }
+        return static_cast<IT>(ret);
+    }
+
     /**
      * @param flags flags bitwise ORed together
      * @param flag flag bit to test for
@@ -212,6 +240,7 @@ namespace fast_matrix_market {
 }
 
 #include "field_conv.hpp"
+#include "crc32c.hpp"
 #include "header.hpp"
 #include "parse_handlers.hpp"
 #include "formatters.hpp"
@@ -221,4 +250,8 @@ namespace fast_matrix_market {
 #include "app/doublet.hpp"
 #include "app/triplet.hpp"
 
+#ifdef FMM_EXTERN_TEMPLATES
+#include "extern_templates.hpp"
+#endif
+
 #endif
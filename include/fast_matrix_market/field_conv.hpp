@@ -45,19 +45,34 @@ namespace fast_matrix_market {
         return pos;
     }
 
+    /**
+     * Same as above, but does not read past `end`. For chunks that are not NUL terminated, but end in a newline.
+     */
+    inline const char* skip_spaces_and_newlines(const char* pos, const char* end, int64_t& line_num) {
+        pos = skip_spaces(pos);
+        while (pos != end && *pos == '\n') {
+            ++line_num;
+            ++pos;
+            if (pos != end) {
+                pos = skip_spaces(pos);
+            }
+        }
+        return pos;
+    }
+
     inline const char* bump_to_next_line(const char* pos, const char* end) {
         if (pos == end) {
             return pos;
         }
 
-        // find the newline
-        pos = std::strchr(pos, '\n');
+        // find the newline. The last line of the body may not have one.
+        auto newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        if (newline == nullptr) {
+            return end;
+        }
 
         // bump to start of next line
-        if (pos != end) {
-            ++pos;
-        }
-        return pos;
+        return newline + 1;
     }
 
     ///////////////////////////////////////////
@@ -384,6 +399,80 @@ namespace fast_matrix_market {
     }
 #endif
 
+    /**
+     * Maximum number of characters written by write_int(): sign plus 20 digits.
+     */
+    constexpr int kMaxIntChars = 21;
+
+    /**
+     * Pairs of decimal digits "00", "01", ..., "99".
+     */
+    constexpr char kDigitPairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+    /**
+     * Write the decimal representation of `value` to `out`, two digits at a time.
+     *
+     * @param out must have room for kMaxIntChars characters.
+     * @return pointer one past the last character written.
+     */
+    inline char* write_uint64(char* out, uint64_t value) {
+        char buf[kMaxIntChars];
+        char* pos = buf + kMaxIntChars;
+
+        while (value >= 100) {
+            auto idx = (value % 100) * 2;
+            value /= 100;
+            pos -= 2;
+            pos[0] = kDigitPairs[idx];
+            pos[1] = kDigitPairs[idx + 1];
+        }
+        if (value >= 10) {
+            pos -= 2;
+            pos[0] = kDigitPairs[value * 2];
+            pos[1] = kDigitPairs[value * 2 + 1];
+        } else {
+            *--pos = (char)('0' + value);
+        }
+
+        auto len = (buf + kMaxIntChars) - pos;
+        std::memcpy(out, pos, len);
+        return out + len;
+    }
+
+    /**
+     * Write the decimal representation of an integer of up to 64 bits to `out`.
+     *
+     * @param out must have room for kMaxIntChars characters.
+     * @return pointer one past the last character written.
+     */
+    template <typename T>
+    char* write_int(char* out, const T& value) {
+        static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+        if constexpr (std::is_signed_v<T>) {
+            if (value < 0) {
+                *out++ = '-';
+                // negate in unsigned arithmetic so that the minimum value does not overflow
+                return write_uint64(out, 0 - static_cast<uint64_t>(value));
+            }
+        }
+        return write_uint64(out, static_cast<uint64_t>(value));
+    }
+
+    /**
+     * Append the decimal representation of an integer to `out` without creating a temporary string.
+     */
+    template <typename T>
+    void append_int(std::string& out, const T& value) {
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t)) {
+            auto old_size = out.size();
+            out.resize(old_size + kMaxIntChars);
+            char* end = write_int(out.data() + old_size, value);
+            out.resize(end - out.data());
+        } else {
+            out += int_to_string(value);
+        }
+    }
+
     inline std::string value_to_string([[maybe_unused]] const pattern_placeholder_type& value, [[maybe_unused]] int precision) {
         return {};
     }
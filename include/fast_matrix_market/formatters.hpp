@@ -5,12 +5,95 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+#include <string_view>
 #include <utility>
 
 #include "fast_matrix_market.hpp"
 
 namespace fast_matrix_market {
 
+    /**
+     * Small cache of formatted values.
+     *
+     * Many matrices have only a few distinct values, such as unit weights, +-1 incidence matrices or small integer
+     * labels. Formatting those once and reusing the text is much faster than running the float formatter on every
+     * element.
+     *
+     * Values are compared by their bit pattern. The cache turns itself off as soon as it sees more than kCapacity
+     * distinct values, so high-cardinality data pays only for the first few lookups.
+     */
+    template <typename VT>
+    class value_format_cache {
+    public:
+        static constexpr int kCapacity = 8;
+
+        // Cheap-to-format and non-trivially-copyable types are not cached.
+        static constexpr bool kSupported = std::is_trivially_copyable_v<VT> && !std::is_same_v<VT, bool> &&
+                                           (std::is_arithmetic_v<VT> || is_complex<VT>::value);
+
+        /**
+         * Use `text` for every value. Used for iso-valued matrices, where all values are known to be equal.
+         */
+        void set_constant(std::string text) {
+            constant = true;
+            enabled = true;
+            texts[0] = std::move(text);
+            size = 1;
+        }
+
+        /**
+         * Append the formatted `value` to `out`.
+         */
+        void append(std::string& out, const VT& value, int precision) {
+            if constexpr (kSupported) {
+                if (constant) {
+                    out += texts[0];
+                    return;
+                }
+                if (enabled) {
+                    key_type key;
+                    std::memcpy(key.data(), &value, sizeof(VT));
+
+                    for (int i = 0; i < size; ++i) {
+                        if (keys[i] == key) {
+                            out += texts[i];
+                            return;
+                        }
+                    }
+
+                    if (size < kCapacity) {
+                        keys[size] = key;
+                        texts[size] = value_to_string(value, precision);
+                        out += texts[size];
+                        ++size;
+                        return;
+                    }
+
+                    // too many distinct values
+                    enabled = false;
+                }
+            }
+
+            if constexpr (std::is_same_v<VT, std::string> || std::is_same_v<VT, std::string_view>) {
+                // already text, so skip the temporary string
+                out += value;
+            } else {
+                out += value_to_string(value, precision);
+            }
+        }
+
+    protected:
+        using key_type = std::array<unsigned char, sizeof(VT)>;
+
+        bool enabled = kSupported;
+        bool constant = false;
+        int size = 0;
+        std::array<key_type, kSupported ? kCapacity : 0> keys{};
+        std::array<std::string, kSupported ? kCapacity : 1> texts;
+    };
+
     /**
      * Format individual lines (matrix version).
      */
@@ -18,56 +101,122 @@ namespace fast_matrix_market {
     class line_formatter {
     public:
         line_formatter(const matrix_market_header &header, const write_options &options) : header(header),
-                                                                                           options(options) {}
+                                                                                           options(options) {
+            if (header.format == array && (options.row_permutation != nullptr || options.col_permutation != nullptr)) {
+                throw invalid_argument("Permutations are only supported when writing coordinate files.");
+            }
+        }
 
         std::string coord_matrix(const IT& row, const IT& col, const VT& val) {
+            std::string line{};
+            append_coord_matrix(line, row, col, val);
+            return line;
+        }
+
+        std::string coord_matrix_pattern(const IT& row, const IT& col) {
+            std::string line{};
+            append_coord_matrix_pattern(line, row, col);
+            return line;
+        }
+
+        /**
+         * Append a line to `out`. Indices are formatted directly into `out`.
+         */
+        void append_coord_matrix(std::string& out, const IT& row, const IT& col, const VT& val) {
             if (header.format == array) {
-                return array_matrix(row, col, val);
+                append_array_matrix(out, row, col, val);
+                return;
             }
 
-            std::string line{};
-            line += int_to_string(row + 1);
-            line += kSpace;
-            line += int_to_string(col + 1);
+            append_int(out, permute_row(row) + 1);
+            out += kSpace;
+            append_int(out, permute_col(col) + 1);
 
             if (header.field != pattern) {
-                line += kSpace;
-                line += value_to_string(val, options.precision);
+                out += kSpace;
+                value_cache.append(out, val, options.precision);
             }
-            line += kNewline;
+            out += kNewline;
+        }
 
-            return line;
+        void append_coord_matrix_pattern(std::string& out, const IT& row, const IT& col) {
+            append_int(out, permute_row(row) + 1);
+            out += kSpace;
+            append_int(out, permute_col(col) + 1);
+            out += kNewline;
         }
 
-        std::string coord_matrix_pattern(const IT& row, const IT& col) {
-            std::string line{};
-            line += int_to_string(row + 1);
-            line += kSpace;
-            line += int_to_string(col + 1);
-            line += kNewline;
+        /**
+         * Apply write_options::row_permutation and col_permutation, if any. For formatters that format indices
+         * themselves. The permutations must have header.nrows and header.ncols entries.
+         */
+        template <typename T>
+        T permute_row(const T& row) const {
+            return permute_index(row, options.row_permutation, header.nrows);
+        }
 
-            return line;
+        template <typename T>
+        T permute_col(const T& col) const {
+            return permute_index(col, options.col_permutation, header.ncols);
+        }
+
+        /**
+         * Append a line whose indices have already been formatted (one-based).
+         *
+         * Lets CSC/CSR formatters format each column index once and reuse it for every element in that column.
+         */
+        void append_formatted_coord_matrix(std::string& out, std::string_view row, std::string_view col, const VT& val) {
+            out += row;
+            out += kSpace;
+            out += col;
+
+            if (header.field != pattern) {
+                out += kSpace;
+                value_cache.append(out, val, options.precision);
+            }
+            out += kNewline;
+        }
+
+        void append_formatted_coord_matrix_pattern(std::string& out, std::string_view row, std::string_view col) {
+            out += row;
+            out += kSpace;
+            out += col;
+            out += kNewline;
         }
 
         std::string array_matrix(const IT& row, const IT& col, const VT& val) {
+            std::string ret{};
+            append_array_matrix(ret, row, col, val);
+            return ret;
+        }
+
+        void append_array_matrix(std::string& out, const IT& row, const IT& col, const VT& val) {
             if (header.symmetry != general) {
                 if (row < col) {
                     // omit upper triangle
-                    return {};
+                    return;
                 }
                 if (header.symmetry == skew_symmetric && row == col) {
                     // omit diagonal for skew-symmetric
-                    return {};
+                    return;
                 }
             }
 
-            std::string ret = value_to_string(val, options.precision);
-            ret += kNewline;
-            return ret;
+            value_cache.append(out, val, options.precision);
+            out += kNewline;
+        }
+
+        /**
+         * Declare that every value equals `val`, such as for an iso-valued matrix. The value is formatted only once.
+         */
+        void set_iso_value(const VT& val) {
+            value_cache.set_constant(value_to_string(val, options.precision));
         }
+
     protected:
         const matrix_market_header& header;
         const write_options& options;
+        value_format_cache<VT> value_cache;
     };
 
     /**
@@ -78,30 +227,54 @@ namespace fast_matrix_market {
     public:
         vector_line_formatter(const matrix_market_header &header, const write_options &options) : header(header),
                                                                                                   options(options) {}
-        std::string coord_matrix(const IT& row, [[maybe_unused]] const IT& col, const VT& val) {
+        std::string coord_matrix(const IT& row, const IT& col, const VT& val) {
             std::string line{};
-            line += int_to_string(row + 1);
+            append_coord_matrix(line, row, col, val);
+            return line;
+        }
+
+        std::string coord_matrix_pattern(const IT& row, const IT& col) {
+            std::string line{};
+            append_coord_matrix_pattern(line, row, col);
+            return line;
+        }
+
+        void append_coord_matrix(std::string& out, const IT& row, [[maybe_unused]] const IT& col, const VT& val) {
+            append_int(out, permute_row(row) + 1);
 
             if (header.field != pattern) {
-                line += kSpace;
-                line += value_to_string(val, options.precision);
+                out += kSpace;
+                value_cache.append(out, val, options.precision);
             }
-            line += kNewline;
+            out += kNewline;
+        }
 
-            return line;
+        void append_coord_matrix_pattern(std::string& out, const IT& row, [[maybe_unused]] const IT& col) {
+            append_int(out, permute_row(row) + 1);
+            out += kNewline;
         }
 
-        std::string coord_matrix_pattern(const IT& row, [[maybe_unused]] const IT& col) {
-            std::string line{};
-            line += int_to_string(row + 1);
-            line += kNewline;
+        /**
+         * Apply write_options::row_permutation, if any. It must have header.vector_length entries.
+         */
+        template <typename T>
+        T permute_row(const T& row) const {
+            return permute_index(row, options.row_permutation, header.vector_length);
+        }
 
-            return line;
+        template <typename T>
+        T permute_col(const T& col) const {
+            return col;
+        }
+
+        void set_iso_value(const VT& val) {
+            value_cache.set_constant(value_to_string(val, options.precision));
         }
 
     protected:
         const matrix_market_header& header;
         const write_options& options;
+        value_format_cache<VT> value_cache;
     };
 
     /**
@@ -152,10 +325,10 @@ namespace fast_matrix_market {
 
                 for (; row_iter != row_end; ++row_iter, ++col_iter) {
                     if (val_iter != val_end) {
-                        chunk += line_formatter.coord_matrix(*row_iter, *col_iter, *val_iter);
+                        line_formatter.append_coord_matrix(chunk, *row_iter, *col_iter, *val_iter);
                         ++val_iter;
                     } else {
-                        chunk += line_formatter.coord_matrix_pattern(*row_iter, *col_iter);
+                        line_formatter.append_coord_matrix_pattern(chunk, *row_iter, *col_iter);
                     }
                 }
 
@@ -242,8 +415,15 @@ namespace fast_matrix_market {
                 // emit the columns [ptr_iter, ptr_end)
 
                 // iterate over assigned columns
+                char column_buf[kMaxIntChars];
+                char row_buf[kMaxIntChars];
                 for (; ptr_iter != ptr_end; ++ptr_iter) {
                     auto column_number = (int64_t)(ptr_iter - ptr_begin);
+                    column_number = transpose ? line_formatter.permute_row(column_number)
+                                              : line_formatter.permute_col(column_number);
+
+                    // format the column index once for all elements in the column
+                    std::string_view column_str(column_buf, write_int(column_buf, column_number + 1) - column_buf);
 
                     // iterate over rows in column
                     IND_ITER row_end = ind_begin + *(ptr_iter+1);
@@ -253,18 +433,22 @@ namespace fast_matrix_market {
                         val_iter = val_begin + *ptr_iter;
                     }
                     for (; row_iter != row_end; ++row_iter) {
+                        int64_t row_number = *row_iter;
+                        row_number = transpose ? line_formatter.permute_col(row_number)
+                                               : line_formatter.permute_row(row_number);
+                        std::string_view row_str(row_buf, write_int(row_buf, row_number + 1) - row_buf);
 
-                        int64_t lf_row = *row_iter;
-                        int64_t lf_col = column_number;
+                        std::string_view lf_row = row_str;
+                        std::string_view lf_col = column_str;
                         if (transpose) {
                             std::swap(lf_row, lf_col);
                         }
 
                         if (val_iter != val_end) {
-                            chunk += line_formatter.coord_matrix(lf_row, lf_col, *val_iter);
+                            line_formatter.append_formatted_coord_matrix(chunk, lf_row, lf_col, *val_iter);
                             ++val_iter;
                         } else {
-                            chunk += line_formatter.coord_matrix_pattern(lf_row, lf_col);
+                            line_formatter.append_formatted_coord_matrix_pattern(chunk, lf_row, lf_col);
                         }
                     }
                 }
@@ -305,6 +489,126 @@ namespace fast_matrix_market {
         double nnz_per_column;
     };
 
+    /**
+     * Format block sparse row (BSR) structures.
+     *
+     * `ptr` and `ind` index block rows and block columns. Each block is `block_size` x `block_size` values, stored
+     * contiguously in row-major order. Every value of every block is written, including zeros.
+     * Value range may be empty to write a pattern.
+     */
+    template<typename LF, typename PTR_ITER, typename IND_ITER, typename VAL_ITER>
+    class bsr_formatter {
+    public:
+        explicit bsr_formatter(LF lf,
+                               const PTR_ITER ptr_begin, const PTR_ITER ptr_end,
+                               const IND_ITER ind_begin, const IND_ITER ind_end,
+                               const VAL_ITER val_begin, const VAL_ITER val_end,
+                               int64_t block_size) :
+                line_formatter(lf),
+                ptr_begin(ptr_begin), ptr_iter(ptr_begin), ptr_end(ptr_end),
+                ind_begin(ind_begin),
+                val_begin(val_begin), val_end(val_end),
+                block_size(block_size) {
+            if (block_size <= 0) {
+                throw invalid_argument("Block size must be positive.");
+            }
+            if ((ind_end - ind_begin) * block_size * block_size != val_end - val_begin && val_end != val_begin) {
+                throw invalid_argument("Value range must have block_size^2 values per block index.");
+            }
+
+            auto num_block_rows = (ptr_end - ptr_iter);
+            auto nnz = (ind_end - ind_begin) * block_size * block_size;
+            nnz_per_block_row = num_block_rows > 0 ? std::max(((double)nnz) / num_block_rows, 1.0) : 1.0;
+        }
+
+        [[nodiscard]] bool has_next() const {
+            return ptr_iter != ptr_end;
+        }
+
+        class chunk {
+        public:
+            explicit chunk(LF lf,
+                           const PTR_ITER ptr_begin, const PTR_ITER ptr_iter, const PTR_ITER ptr_end,
+                           const IND_ITER ind_begin,
+                           const VAL_ITER val_begin, const VAL_ITER val_end,
+                           int64_t block_size) :
+                    line_formatter(lf),
+                    ptr_begin(ptr_begin), ptr_iter(ptr_iter), ptr_end(ptr_end),
+                    ind_begin(ind_begin),
+                    val_begin(val_begin), val_end(val_end),
+                    block_size(block_size) {}
+
+            std::string operator()() {
+                std::string chunk;
+                chunk.reserve((ptr_end - ptr_iter) * block_size * 250);
+
+                // emit the block rows [ptr_iter, ptr_end), one scalar row at a time
+                char row_buf[kMaxIntChars];
+                char col_buf[kMaxIntChars];
+                const int64_t block_values = block_size * block_size;
+                for (; ptr_iter != ptr_end; ++ptr_iter) {
+                    auto block_row = (int64_t)(ptr_iter - ptr_begin);
+
+                    for (int64_t r = 0; r < block_size; ++r) {
+                        int64_t row_number = line_formatter.permute_row(block_row * block_size + r);
+
+                        // format the row index once for the whole row
+                        std::string_view row_str(row_buf, write_int(row_buf, row_number + 1) - row_buf);
+
+                        for (auto block = (int64_t)*ptr_iter; block < (int64_t)*(ptr_iter + 1); ++block) {
+                            int64_t block_col = *(ind_begin + block);
+
+                            for (int64_t c = 0; c < block_size; ++c) {
+                                int64_t col_number = line_formatter.permute_col(block_col * block_size + c);
+                                std::string_view col_str(col_buf, write_int(col_buf, col_number + 1) - col_buf);
+
+                                if (val_begin != val_end) {
+                                    line_formatter.append_formatted_coord_matrix(
+                                            chunk, row_str, col_str, *(val_begin + (block * block_values + r * block_size + c)));
+                                } else {
+                                    line_formatter.append_formatted_coord_matrix_pattern(chunk, row_str, col_str);
+                                }
+                            }
+                        }
+                    }
+                }
+
+                return chunk;
+            }
+
+            LF line_formatter;
+            PTR_ITER ptr_begin, ptr_iter, ptr_end;
+            IND_ITER ind_begin;
+            VAL_ITER val_begin, val_end;
+            int64_t block_size;
+        };
+
+        chunk next_chunk(const write_options& options) {
+            auto num_block_rows = (int64_t)(((double)options.chunk_size_values / nnz_per_block_row) + 1);
+
+            num_block_rows = std::min(num_block_rows, (int64_t)(ptr_end - ptr_iter));
+            PTR_ITER ptr_chunk_end = ptr_iter + num_block_rows;
+
+            chunk c(line_formatter,
+                    ptr_begin, ptr_iter, ptr_chunk_end,
+                    ind_begin,
+                    val_begin, val_end,
+                    block_size);
+
+            ptr_iter = ptr_chunk_end;
+
+            return c;
+        }
+
+    protected:
+        LF line_formatter;
+        PTR_ITER ptr_begin, ptr_iter, ptr_end;
+        IND_ITER ind_begin;
+        VAL_ITER val_begin, val_end;
+        int64_t block_size;
+        double nnz_per_block_row;
+    };
+
     /**
      * Format dense arrays.
      */
@@ -335,7 +639,7 @@ namespace fast_matrix_market {
                         offset = cur_col * nrows + row;
                     }
 
-                    c += line_formatter.array_matrix(row, cur_col, *(values + offset));
+                    line_formatter.append_array_matrix(c, row, cur_col, *(values + offset));
                 }
 
                 return c;
@@ -390,7 +694,7 @@ namespace fast_matrix_market {
 
                     for (DIM row = 0; row < nrows; ++row)
                     {
-                        chunk += line_formatter.array_matrix(row, col_iter, mat(row, col_iter));
+                        line_formatter.append_array_matrix(chunk, row, col_iter, mat(row, col_iter));
                     }
                 }
 
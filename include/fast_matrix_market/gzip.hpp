@@ -0,0 +1,722 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/**
+ * gzip input stage. Requires zlib, so it is not included by fast_matrix_market.hpp.
+ *
+ * Usage:
+ *     std::ifstream f("matrix.mtx.gz", std::ios::binary);
+ *     fast_matrix_market::gzip_istream gz(f);
+ *     fast_matrix_market::read_matrix_market_triplet(gz, ...);
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+#include <zlib.h>
+
+#include "fast_matrix_market.hpp"
+#include "deflate.hpp"
+#include "thirdparty/task_thread_pool.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * The compressed stream is corrupt or not gzip.
+     */
+    class gzip_error : public fmm_error {
+    public:
+        explicit gzip_error(std::string msg): fmm_error(std::move(msg)) {}
+    };
+
+    /**
+     * Size of each decompressed block handed to the parser.
+     */
+    constexpr std::size_t kGzipBlockBytes = 1U << 20U;
+
+    /**
+     * Sequential zlib decompressor. Handles concatenated gzip members.
+     */
+    class gzip_inflater {
+    public:
+        /**
+         * @param source compressed input
+         * @param prefix compressed bytes that were already read from `source`
+         */
+        explicit gzip_inflater(std::istream& source, std::string prefix = {}) : source(source), in(std::move(prefix)) {
+            zs.zalloc = Z_NULL;
+            zs.zfree = Z_NULL;
+            zs.opaque = Z_NULL;
+            zs.next_in = reinterpret_cast<Bytef*>(in.data());
+            zs.avail_in = (uInt)in.size();
+            // 15 + 32: max window, detect gzip or zlib header
+            if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+                throw gzip_error("Failed to initialize zlib.");
+            }
+        }
+
+        ~gzip_inflater() {
+            inflateEnd(&zs);
+        }
+
+        gzip_inflater(const gzip_inflater&) = delete;
+        gzip_inflater& operator=(const gzip_inflater&) = delete;
+
+        /**
+         * Decompress up to `max_bytes` into `out`.
+         *
+         * @return false if the stream is finished and `out` is empty.
+         */
+        bool next(std::string& out, std::size_t max_bytes = kGzipBlockBytes) {
+            out.resize(max_bytes);
+            zs.next_out = reinterpret_cast<Bytef*>(out.data());
+            zs.avail_out = (uInt)out.size();
+
+            while (zs.avail_out > 0 && !finished) {
+                if (zs.avail_in == 0 && !refill()) {
+                    if (member_started) {
+                        throw gzip_error("Truncated gzip stream.");
+                    }
+                    finished = true;
+                    break;
+                }
+
+                member_started = true;
+                int ret = inflate(&zs, Z_NO_FLUSH);
+                if (ret == Z_STREAM_END) {
+                    member_started = false;
+                    // Another member may follow.
+                    if (zs.avail_in == 0 && !refill()) {
+                        finished = true;
+                    } else if (zs.next_in[0] != 0x1f) {
+                        // trailing garbage, such as zero padding, is ignored like gzip does
+                        finished = true;
+                    } else {
+                        inflateReset(&zs);
+                    }
+                } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                    throw gzip_error(std::string("gzip decompression failed: ") + (zs.msg ? zs.msg : "unknown error"));
+                }
+            }
+
+            out.resize(out.size() - zs.avail_out);
+            return !out.empty();
+        }
+
+    protected:
+        bool refill() {
+            in.resize(kGzipBlockBytes);
+            source.read(in.data(), (std::streamsize)in.size());
+            in.resize((std::size_t)source.gcount());
+            zs.next_in = reinterpret_cast<Bytef*>(in.data());
+            zs.avail_in = (uInt)in.size();
+            return !in.empty();
+        }
+
+        std::istream& source;
+        std::string in;
+        z_stream zs{};
+        bool member_started = false;
+        bool finished = false;
+    };
+
+    /**
+     * Decompress a buffer of complete gzip members.
+     */
+    inline std::string gzip_inflate_members(const std::string& compressed) {
+        std::istringstream iss(compressed);
+        gzip_inflater inflater(iss);
+
+        std::string ret, block;
+        while (inflater.next(block)) {
+            ret += block;
+        }
+        return ret;
+    }
+
+    /**
+     * Length of a gzip member header, or 0 if `member` does not start with a complete gzip header.
+     */
+    inline std::size_t gzip_header_size(const std::string& member) {
+        auto byte = [&](std::size_t i) { return (unsigned int)(unsigned char)member[i]; };
+
+        // ID1 ID2 CM FLG MTIME(4) XFL OS
+        if (member.size() < 10 || byte(0) != 0x1f || byte(1) != 0x8b || byte(2) != 8) {
+            return 0;
+        }
+        unsigned int flags = byte(3);
+        std::size_t pos = 10;
+        if (flags & 0x04U) {
+            // FEXTRA
+            if (pos + 2 > member.size()) {
+                return 0;
+            }
+            pos += 2 + (byte(pos) | (byte(pos + 1) << 8U));
+        }
+        for (unsigned int flag : {0x08U, 0x10U}) {
+            // FNAME, FCOMMENT: zero-terminated
+            if (flags & flag) {
+                auto terminator = member.find('\0', pos);
+                if (terminator == std::string::npos) {
+                    return 0;
+                }
+                pos = terminator + 1;
+            }
+        }
+        if (flags & 0x02U) {
+            // FHCRC
+            pos += 2;
+        }
+        return pos <= member.size() ? pos : 0;
+    }
+
+    /**
+     * A std::streambuf that decompresses a gzip stream.
+     *
+     * If parallelism is allowed, decompression runs on a separate thread so that it overlaps with parsing.
+     * Files made of BGZF blocks (such as written by `bgzip`) record each member's compressed size in the header,
+     * so those members are decompressed in parallel. Other members are a single deflate stream. That stream is
+     * split into pieces of read_options::chunk_size_bytes compressed bytes, and each piece is decoded in parallel
+     * from the first block boundary found in it (see deflate.hpp). Where a piece's decoding does not start where
+     * the previous piece's ended, zlib decompresses the gap sequentially.
+     *
+     * If parallelism is not allowed, the stream is decompressed on the calling thread as it is read.
+     */
+    class gzip_streambuf : public std::streambuf {
+    public:
+        explicit gzip_streambuf(std::istream& source, const read_options& options = {}) :
+                source(source), piece_bytes(std::max(options.chunk_size_bytes, (int64_t)1)) {
+            if (!options.parallel_ok || options.num_threads == 1) {
+                inflater = std::make_unique<gzip_inflater>(source);
+                return;
+            }
+
+            unsigned int num_threads = options.num_threads > 0 ? (unsigned int)options.num_threads
+                                                               : std::thread::hardware_concurrency();
+            num_threads = std::max(num_threads, 1U);
+            max_queued = 2 * num_threads;
+            pool = std::make_unique<task_thread_pool::task_thread_pool>(num_threads);
+            producer = std::thread([this] { produce(); });
+        }
+
+        ~gzip_streambuf() override {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            cv.notify_all();
+            if (producer.joinable()) {
+                producer.join();
+            }
+        }
+
+        gzip_streambuf(const gzip_streambuf&) = delete;
+        gzip_streambuf& operator=(const gzip_streambuf&) = delete;
+
+    protected:
+        int_type underflow() override {
+            do {
+                if (!next_block(current)) {
+                    return traits_type::eof();
+                }
+            } while (current.empty());
+
+            setg(current.data(), current.data(), current.data() + current.size());
+            return traits_type::to_int_type(current[0]);
+        }
+
+        bool next_block(std::string& out) {
+            if (inflater) {
+                return inflater->next(out);
+            }
+
+            std::future<std::string> block;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return !queue.empty() || done; });
+                if (queue.empty()) {
+                    return false;
+                }
+                block = std::move(queue.front());
+                queue.pop_front();
+            }
+            cv.notify_all();
+
+            out = block.get();
+            return true;
+        }
+
+        /**
+         * Add a block to the queue, waiting for space.
+         *
+         * @return false if the streambuf is being destroyed.
+         */
+        bool push(std::future<std::string> block) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return queue.size() < max_queued || stopping; });
+            if (stopping) {
+                return false;
+            }
+            queue.push_back(std::move(block));
+            lock.unlock();
+            cv.notify_all();
+            return true;
+        }
+
+        bool is_stopping() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return stopping;
+        }
+
+        bool push_ready(std::string block) {
+            std::promise<std::string> p;
+            p.set_value(std::move(block));
+            return push(p.get_future());
+        }
+
+        /**
+         * Read from the source until `buf` has at least `size` bytes, or the source ends.
+         */
+        void top_up(std::string& buf, std::size_t size) {
+            if (buf.size() >= size) {
+                return;
+            }
+            auto old_size = buf.size();
+            buf.resize(size);
+            source.read(buf.data() + old_size, (std::streamsize)(size - old_size));
+            buf.resize(old_size + (std::size_t)source.gcount());
+        }
+
+        /**
+         * Read from the source until `prefix` holds a complete gzip header.
+         *
+         * @return false if `prefix` does not start with a gzip header.
+         */
+        bool read_gzip_header(std::string& prefix) {
+            while (gzip_header_size(prefix) == 0) {
+                auto byte = [&](std::size_t i) { return (unsigned int)(unsigned char)prefix[i]; };
+                if (prefix.size() >= 3 && (byte(0) != 0x1f || byte(1) != 0x8b || byte(2) != 8)) {
+                    return false;
+                }
+                auto old_size = prefix.size();
+                top_up(prefix, std::max(2 * old_size, (std::size_t)64));
+                if (prefix.size() == old_size) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Producer thread body.
+         */
+        void produce() {
+            try {
+                std::string prefix = produce_bgzf();
+
+                // Members that are not BGZF.
+                bool any_member = false;
+                while (!is_stopping() && read_gzip_header(prefix)) {
+                    prefix = produce_member(std::move(prefix));
+                    any_member = true;
+                }
+
+                bool is_garbage = any_member && !prefix.empty() && (unsigned char)prefix[0] != 0x1f;
+                if (!is_stopping() && !is_garbage && (!prefix.empty() || source.peek() != std::istream::traits_type::eof())) {
+                    // Not gzip, or a truncated member. zlib reports the error.
+                    gzip_inflater sequential(source, std::move(prefix));
+                    std::string block;
+                    while (sequential.next(block)) {
+                        if (!push_ready(std::move(block))) {
+                            break;
+                        }
+                    }
+                }
+            } catch (...) {
+                std::promise<std::string> p;
+                p.set_exception(std::current_exception());
+                push(p.get_future());
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+            }
+            cv.notify_all();
+        }
+
+        /**
+         * Decompress BGZF members in parallel, in batches.
+         *
+         * @return bytes of a member that is not BGZF, which is decompressed along with the rest of the stream by
+         *         produce_member(). Empty if the stream ended.
+         */
+        std::string produce_bgzf() {
+            constexpr std::size_t batch_bytes = kGzipBlockBytes / 4;
+            std::string batch;
+
+            auto submit_batch = [&]() {
+                if (batch.empty()) {
+                    return true;
+                }
+                bool ret = push(pool->submit(gzip_inflate_members, std::move(batch)));
+                batch.clear();
+                return ret;
+            };
+
+            while (true) {
+                // gzip header: ID1 ID2 CM FLG MTIME(4) XFL OS, then XLEN(2) if FLG.FEXTRA
+                std::string member(12, '\0');
+                source.read(member.data(), (std::streamsize)member.size());
+                member.resize((std::size_t)source.gcount());
+
+                auto byte = [&](std::size_t i) { return (unsigned int)(unsigned char)member[i]; };
+
+                if (member.size() < 12 || byte(0) != 0x1f || byte(1) != 0x8b || (byte(3) & 0x04U) == 0) {
+                    submit_batch();
+                    return member;
+                }
+
+                std::size_t xlen = byte(10) | (byte(11) << 8U);
+                member.resize(12 + xlen);
+                source.read(member.data() + 12, (std::streamsize)xlen);
+                member.resize(12 + (std::size_t)source.gcount());
+
+                // find the BC subfield that holds the member size
+                std::size_t member_size = 0;
+                for (std::size_t pos = 12; pos + 4 <= member.size();) {
+                    std::size_t slen = byte(pos + 2) | (byte(pos + 3) << 8U);
+                    if (byte(pos) == 'B' && byte(pos + 1) == 'C' && slen == 2 && pos + 6 <= member.size()) {
+                        member_size = (byte(pos + 4) | (byte(pos + 5) << 8U)) + 1;
+                        break;
+                    }
+                    pos += 4 + slen;
+                }
+
+                if (member_size < member.size()) {
+                    submit_batch();
+                    return member;
+                }
+
+                std::size_t header_size = member.size();
+                member.resize(member_size);
+                source.read(member.data() + header_size, (std::streamsize)(member_size - header_size));
+                member.resize(header_size + (std::size_t)source.gcount());
+
+                batch += member;
+                if (batch.size() >= batch_bytes && !submit_batch()) {
+                    return {};
+                }
+
+                if (source.peek() == std::istream::traits_type::eof()) {
+                    submit_batch();
+                    return {};
+                }
+            }
+        }
+
+        /**
+         * A piece of a compressed member.
+         */
+        struct member_piece {
+            // offset of the piece in the member
+            int64_t begin = 0;
+            std::shared_ptr<const std::string> bytes;
+
+            int64_t end() const {
+                return begin + (int64_t)bytes->size();
+            }
+        };
+
+        /**
+         * A pool task's decoding of a piece, and the CRC-32 of its output after the markers.
+         */
+        struct speculative_piece {
+            deflate_chunk chunk;
+            uLong plain_crc = 0;
+        };
+
+        /**
+         * Decompress a gzip member with speculative parallel decoding of its deflate stream.
+         *
+         * The member is split into pieces of `piece_bytes`. A pool task searches each piece for its first block
+         * boundary and decodes from there to the first boundary in the next piece. This thread then stitches the
+         * pieces together in order. Pieces that start where their predecessor ended have their markers replaced by
+         * their predecessor's bytes. For the others, zlib decompresses from where the predecessor ended.
+         *
+         * @param prefix bytes of the member that were already read, including a complete gzip header.
+         * @return bytes read from the source after the member.
+         */
+        std::string produce_member(std::string prefix) {
+            std::deque<member_piece> pieces;
+            bool source_done = false;
+
+            // Read pieces until the one that contains `offset`. Returns its index, or -1 if the member ends first.
+            auto piece_at = [&](int64_t offset) -> int64_t {
+                while (true) {
+                    for (std::size_t i = 0; i < pieces.size(); ++i) {
+                        if (offset < pieces[i].end()) {
+                            return (int64_t)i;
+                        }
+                    }
+                    if (source_done) {
+                        return -1;
+                    }
+                    std::string bytes = pieces.empty() ? std::move(prefix) : std::string();
+                    top_up(bytes, (std::size_t)piece_bytes);
+                    source_done = bytes.size() < (std::size_t)piece_bytes;
+                    int64_t begin = pieces.empty() ? 0 : pieces.back().end();
+                    pieces.push_back({begin, std::make_shared<const std::string>(std::move(bytes))});
+                }
+            };
+
+            piece_at(0);
+            int64_t pos = (int64_t)gzip_header_size(*pieces[0].bytes) * 8;
+            bool final = false;
+
+            // Output
+            std::string window;
+            uLong crc = crc32(0, Z_NULL, 0);
+            uint64_t total_size = 0;
+            auto emit = [&](std::string block, const uLong* block_crc) {
+                if (block.empty()) {
+                    return;
+                }
+                crc = block_crc ? crc32_combine(crc, *block_crc, (z_off_t)block.size())
+                                : crc32(crc, reinterpret_cast<const Bytef*>(block.data()), (uInt)block.size());
+                total_size += block.size();
+                if (block.size() >= kDeflateWindowSize) {
+                    window.assign(block, block.size() - kDeflateWindowSize, kDeflateWindowSize);
+                } else {
+                    window += block;
+                    if (window.size() > kDeflateWindowSize) {
+                        window.erase(0, window.size() - kDeflateWindowSize);
+                    }
+                }
+                if (!push_ready(std::move(block))) {
+                    throw stopping_exception();
+                }
+            };
+
+            // Speculative decoding of the pieces after the current one, by member offset of the piece.
+            std::map<int64_t, std::future<speculative_piece>> jobs;
+            int64_t next_job = 0;
+            auto submit_jobs = [&](int64_t current) {
+                next_job = std::max(next_job, pieces[current].end());
+                while ((int64_t)jobs.size() < (int64_t)max_queued) {
+                    auto index = piece_at(next_job);
+                    if (index < 0) {
+                        break;
+                    }
+                    // a piece and the one after it, where its last block ends
+                    auto next_index = piece_at(pieces[index].end());
+                    auto data = std::make_shared<std::string>(*pieces[index].bytes);
+                    if (next_index >= 0) {
+                        *data += *pieces[next_index].bytes;
+                    }
+                    auto stop_bit = (int64_t)pieces[index].bytes->size() * 8;
+                    jobs[next_job] = pool->submit([data, stop_bit]() {
+                        speculative_piece ret;
+                        ret.chunk = inflate_deflate_chunk_speculative(reinterpret_cast<const uint8_t*>(data->data()),
+                                                                      data->size(), 0, stop_bit, stop_bit);
+                        ret.plain_crc = crc32(0, reinterpret_cast<const Bytef*>(ret.chunk.plain.data()), (uInt)ret.chunk.plain.size());
+                        return ret;
+                    });
+                    next_job = pieces[index].end();
+                }
+            };
+
+            // zlib decompression from `pos` to the first block boundary at or after `stop_bit`.
+            auto inflate_exact = [&](int64_t stop_bit) {
+                z_stream zs{};
+                if (inflateInit2(&zs, -15) != Z_OK) {
+                    throw gzip_error("Failed to initialize zlib.");
+                }
+                try {
+                    if (!window.empty()) {
+                        inflateSetDictionary(&zs, reinterpret_cast<const Bytef*>(window.data()), (uInt)window.size());
+                    }
+
+                    // Offset of the byte after zlib's input.
+                    int64_t input_end = pos / 8;
+                    auto next_input = [&]() {
+                        auto index = piece_at(input_end);
+                        if (index < 0) {
+                            throw gzip_error("Truncated gzip stream.");
+                        }
+                        const auto& piece = pieces[index];
+                        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(piece.bytes->data())) + (input_end - piece.begin);
+                        zs.avail_in = (uInt)(piece.end() - input_end);
+                        input_end = piece.end();
+                    };
+
+                    next_input();
+                    if (pos % 8 != 0) {
+                        // start mid-byte
+                        auto skip = (int)(pos % 8);
+                        inflatePrime(&zs, 8 - skip, zs.next_in[0] >> skip);
+                        ++zs.next_in;
+                        --zs.avail_in;
+                    }
+
+                    std::string out;
+                    while (true) {
+                        if (zs.avail_in == 0) {
+                            next_input();
+                        }
+                        if (out.empty()) {
+                            out.resize(kGzipBlockBytes);
+                            zs.next_out = reinterpret_cast<Bytef*>(out.data());
+                            zs.avail_out = (uInt)out.size();
+                        }
+
+                        int ret = inflate(&zs, Z_BLOCK);
+                        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                            throw gzip_error(std::string("gzip decompression failed: ") + (zs.msg ? zs.msg : "unknown error"));
+                        }
+
+                        // bit offset in the member of zlib's next unread bit
+                        int64_t in_bit = (input_end - (int64_t)zs.avail_in) * 8 - (zs.data_type & 7);
+                        // data_type has 128 at a block boundary, and 64 if the block before it is the final one
+                        bool end_of_final = ret == Z_STREAM_END || ((zs.data_type & 128) && (zs.data_type & 64));
+                        bool at_boundary = end_of_final || ((zs.data_type & 128) && in_bit >= stop_bit);
+                        if (zs.avail_out == 0 || at_boundary) {
+                            out.resize(out.size() - zs.avail_out);
+                            emit(std::move(out), nullptr);
+                            out.clear();
+                        }
+                        if (at_boundary) {
+                            pos = in_bit;
+                            final = end_of_final;
+                            break;
+                        }
+                    }
+                } catch (...) {
+                    inflateEnd(&zs);
+                    throw;
+                }
+                inflateEnd(&zs);
+            };
+
+            try {
+                int64_t current = 0;
+                while (!final) {
+                    // find the piece that holds `pos`
+                    current = piece_at(pos / 8);
+                    if (current < 0) {
+                        throw gzip_error("Truncated gzip stream.");
+                    }
+                    const int64_t piece_begin = pieces[current].begin;
+                    const int64_t piece_end_bit = pieces[current].end() * 8;
+                    jobs.erase(jobs.begin(), jobs.lower_bound(piece_begin));
+                    submit_jobs(current);
+
+                    auto job = jobs.find(piece_begin);
+                    if (job != jobs.end()) {
+                        speculative_piece spec = job->second.get();
+                        jobs.erase(job);
+
+                        if (spec.chunk.begin_bit >= 0 && piece_begin * 8 + spec.chunk.begin_bit == pos) {
+                            std::string resolved;
+                            if (!resolve_deflate_markers(spec.chunk.marked, window, resolved)) {
+                                throw gzip_error("gzip decompression failed: invalid distance too far back");
+                            }
+                            emit(std::move(resolved), nullptr);
+                            emit(std::move(spec.chunk.plain), &spec.plain_crc);
+                            pos = piece_begin * 8 + spec.chunk.end_bit;
+                            final = spec.chunk.final;
+                        }
+                    }
+
+                    if (!final && pos < piece_end_bit) {
+                        inflate_exact(piece_end_bit);
+                    }
+
+                    // drop pieces that are behind
+                    while (pieces.size() > 1 && pieces[1].begin <= pos / 8) {
+                        pieces.pop_front();
+                    }
+                }
+            } catch (const stopping_exception&) {
+                return {};
+            }
+
+            // trailer: CRC32 and ISIZE, little endian
+            int64_t trailer = (pos + 7) / 8;
+            std::string rest;
+            auto index = piece_at(trailer);
+            if (index >= 0) {
+                rest = pieces[index].bytes->substr((std::size_t)(trailer - pieces[index].begin));
+                for (auto i = (std::size_t)index + 1; i < pieces.size(); ++i) {
+                    rest += *pieces[i].bytes;
+                }
+            }
+            top_up(rest, 8);
+            if (rest.size() < 8) {
+                throw gzip_error("Truncated gzip stream.");
+            }
+            auto le32 = [&](std::size_t i) {
+                return (uint32_t)(unsigned char)rest[i] | ((uint32_t)(unsigned char)rest[i + 1] << 8U) |
+                       ((uint32_t)(unsigned char)rest[i + 2] << 16U) | ((uint32_t)(unsigned char)rest[i + 3] << 24U);
+            };
+            if (le32(0) != (uint32_t)crc) {
+                throw gzip_error("gzip decompression failed: incorrect data check");
+            }
+            if (le32(4) != (uint32_t)total_size) {
+                throw gzip_error("gzip decompression failed: incorrect length check");
+            }
+            return rest.substr(8);
+        }
+
+        /**
+         * Thrown out of produce_member() when the streambuf is being destroyed.
+         */
+        struct stopping_exception {};
+
+        std::istream& source;
+        const int64_t piece_bytes;
+        std::string current;
+
+        // sequential mode
+        std::unique_ptr<gzip_inflater> inflater;
+
+        // threaded mode
+        std::unique_ptr<task_thread_pool::task_thread_pool> pool;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::future<std::string>> queue;
+        std::size_t max_queued = 0;
+        bool done = false;
+        bool stopping = false;
+        std::thread producer;
+    };
+
+    /**
+     * An std::istream that reads decompressed data from a gzip stream. See gzip_streambuf.
+     *
+     * A corrupt stream throws gzip_error from the read that encounters it.
+     */
+    class gzip_istream : public std::istream {
+    public:
+        explicit gzip_istream(std::istream& source, const read_options& options = {}) :
+                std::istream(nullptr), buf(source, options) {
+            rdbuf(&buf);
+            // rethrow decompression errors instead of only setting badbit
+            exceptions(std::ios_base::badbit);
+        }
+
+    protected:
+        gzip_streambuf buf;
+    };
+}
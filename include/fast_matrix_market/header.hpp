@@ -159,16 +159,16 @@ namespace fast_matrix_market {
 
     /**
      * Reads
-     * @param instream stream to read from
+     * @param source source to read from
      * @param header structure that will be filled with read header
      * @return number of lines read
      */
-    inline int64_t read_header(std::istream& instream, matrix_market_header& header) {
+    inline int64_t read_header(byte_source& source, matrix_market_header& header) {
         int64_t lines_read = 0;
         std::string line;
 
         // read banner
-        std::getline(instream, line);
+        source.read_line(line);
         strip_trailing_cr(line);
         lines_read++;
 
@@ -195,11 +195,11 @@ namespace fast_matrix_market {
 
         // Read any comments
         do {
-            std::getline(instream, line);
+            bool premature_eof = !source.read_line(line) && line.empty();
             strip_trailing_cr(line);
             lines_read++;
 
-            if (!instream) {
+            if (premature_eof) {
                 throw invalid_mm("Invalid MatrixMarket header: Premature EOF", lines_read);
             }
         } while (read_comment(header, line));
@@ -275,6 +275,11 @@ namespace fast_matrix_market {
         return lines_read;
     }
 
+    inline int64_t read_header(std::istream& instream, matrix_market_header& header) {
+        istream_source source(instream);
+        return read_header(source, header);
+    }
+
     inline bool write_header(std::ostream& os, const matrix_market_header& header, const write_options options = {}) {
         // Write the banner
         os << kMatrixMarketBanner << kSpace;
@@ -309,4 +314,12 @@ namespace fast_matrix_market {
         return true;
     }
 
+    inline bool write_header(byte_sink& sink, const matrix_market_header& header, const write_options options = {}) {
+        std::ostringstream oss;
+        write_header(oss, header, options);
+        std::string str = oss.str();
+        sink.write(str.data(), str.size());
+        return true;
+    }
+
 }
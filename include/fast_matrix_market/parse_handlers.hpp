@@ -5,10 +5,14 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <complex>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <type_traits>
+#include <vector>
 
 #include "fast_matrix_market.hpp"
 
@@ -113,6 +117,189 @@ namespace fast_matrix_market {
         VT_ITER values;
     };
 
+    /**
+     * Triplet handler that only allocates the value vector if the values are not all equal.
+     *
+     * Each chunk remembers its first value and stores nothing as long as later values match it. The first value
+     * that differs allocates the value vector (once, for all chunks) and the chunk writes its values from then on.
+     * finish() merges the per-chunk results: either all values are equal and `values` holds just that one value,
+     * or the ranges of chunks that never wrote are filled with their value.
+     *
+     * @tparam VVEC resizable value vector, such as std::vector.
+     */
+    template<typename IT_ITER, typename VVEC>
+    class triplet_iso_parse_handler {
+    public:
+        using coordinate_type = typename std::iterator_traits<IT_ITER>::value_type;
+        using value_type = typename std::iterator_traits<decltype(std::declval<VVEC&>().begin())>::value_type;
+        static constexpr int flags = kParallelOk;
+
+        explicit triplet_iso_parse_handler(const IT_ITER& rows,
+                                           const IT_ITER& cols,
+                                           VVEC& values,
+                                           int64_t num_elements) : begin_rows(rows), begin_cols(cols),
+                                                                   rows(rows), cols(cols),
+                                                                   state(std::make_shared<shared_state>(values, num_elements)) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, const value_type value) {
+            *rows = row;
+            *cols = col;
+
+            ++rows;
+            ++cols;
+
+            if (chunk_index < 0) {
+                chunk_index = state->add_chunk(offset, value);
+                chunk_value = value;
+            } else if (!writing && !is_same_value(value, chunk_value)) {
+                values = state->begin_writing(chunk_index, num_handled);
+                writing = true;
+            }
+
+            if (writing) {
+                *values = value;
+                ++values;
+            }
+            ++num_handled;
+        }
+
+        triplet_iso_parse_handler<IT_ITER, VVEC> get_chunk_handler(int64_t offset_from_begin) {
+            triplet_iso_parse_handler ret(*this);
+            ret.rows = begin_rows + offset_from_begin;
+            ret.cols = begin_cols + offset_from_begin;
+            ret.offset = offset_from_begin;
+            ret.chunk_index = -1;
+            ret.num_handled = 0;
+            ret.writing = false;
+            return ret;
+        }
+
+        /**
+         * Call once parsing is done.
+         *
+         * @return true if all values are equal, in which case `values` has length one. Otherwise `values` has
+         * num_elements entries.
+         */
+        bool finish() {
+            return state->finish();
+        }
+
+        /**
+         * Bitwise-meaningful equality: 0.0 and -0.0 differ, NaN never equals anything.
+         */
+        static bool is_same_value(const value_type& a, const value_type& b) {
+            if constexpr (std::is_floating_point_v<value_type>) {
+                return a == b && std::signbit(a) == std::signbit(b);
+            } else if constexpr (is_complex<value_type>::value) {
+                return is_same_component(a.real(), b.real()) && is_same_component(a.imag(), b.imag());
+            } else {
+                return a == b;
+            }
+        }
+
+    protected:
+        using VT_ITER = decltype(std::declval<VVEC&>().begin());
+
+        template <typename T>
+        static bool is_same_component(const T& a, const T& b) {
+            return a == b && std::signbit(a) == std::signbit(b);
+        }
+
+        struct chunk_entry {
+            int64_t offset;
+            value_type value;
+            bool written = false;
+        };
+
+        class shared_state {
+        public:
+            shared_state(VVEC& values, int64_t num_elements) : values(values), num_elements(num_elements) {}
+
+            int64_t add_chunk(int64_t offset, const value_type& value) {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunks.push_back(chunk_entry{offset, value});
+                return (int64_t)chunks.size() - 1;
+            }
+
+            /**
+             * Allocate the value vector if needed and fill in the values the chunk has skipped so far.
+             * @return iterator to the chunk's next value.
+             */
+            VT_ITER begin_writing(int64_t chunk_index, int64_t num_skipped) {
+                chunk_entry entry;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!allocated) {
+                        values.resize(num_elements);
+                        allocated = true;
+                    }
+                    chunks[chunk_index].written = true;
+                    entry = chunks[chunk_index];
+                }
+
+                auto begin = values.begin() + entry.offset;
+                std::fill(begin, begin + num_skipped, entry.value);
+                return begin + num_skipped;
+            }
+
+            bool finish() {
+                if (chunks.empty()) {
+                    values.resize(0);
+                    return false;
+                }
+
+                if (!allocated) {
+                    const value_type& first = chunks.front().value;
+                    bool iso = std::all_of(chunks.begin(), chunks.end(), [&](const chunk_entry& c) {
+                        return is_same_value(c.value, first);
+                    });
+                    if (iso) {
+                        values.resize(1);
+                        *values.begin() = first;
+                        return true;
+                    }
+                    values.resize(num_elements);
+                    allocated = true;
+                }
+
+                // Chunks that never wrote cover the elements up to the next chunk.
+                std::sort(chunks.begin(), chunks.end(), [](const chunk_entry& lhs, const chunk_entry& rhs) {
+                    return lhs.offset < rhs.offset;
+                });
+                for (std::size_t i = 0; i < chunks.size(); ++i) {
+                    if (!chunks[i].written) {
+                        int64_t end = (i + 1 < chunks.size() ? chunks[i + 1].offset : num_elements);
+                        std::fill(values.begin() + chunks[i].offset, values.begin() + end, chunks[i].value);
+                    }
+                }
+                return false;
+            }
+
+        protected:
+            std::mutex mutex;
+            VVEC& values;
+            int64_t num_elements;
+            bool allocated = false;
+            std::vector<chunk_entry> chunks;
+        };
+
+        IT_ITER begin_rows;
+        IT_ITER begin_cols;
+
+        IT_ITER rows;
+        IT_ITER cols;
+
+        // this chunk
+        int64_t offset = 0;
+        int64_t chunk_index = -1;
+        int64_t num_handled = 0;
+        value_type chunk_value{};
+        bool writing = false;
+        VT_ITER values{};
+
+        std::shared_ptr<shared_state> state;
+    };
+
     /**
      * Triplet handler for pattern matrices. Row and column vectors only.
      */
@@ -182,6 +369,39 @@ namespace fast_matrix_market {
         int64_t offset;
     };
 
+    /**
+     * Triplet handler for pattern matrices, or structure-only reads. Row and column arrays only.
+     * Uses operator(index) to write, like triplet_calling_parse_handler.
+     */
+    template<typename IT, typename IT_ARR>
+    class triplet_calling_pattern_parse_handler {
+    public:
+        using coordinate_type = IT;
+        using value_type = pattern_placeholder_type;
+        static constexpr int flags = kParallelOk;
+
+        explicit triplet_calling_pattern_parse_handler(IT_ARR& rows,
+                                                       IT_ARR& cols,
+                                                       int64_t offset = 0) : rows(rows), cols(cols), offset(offset) {}
+
+        void handle(const coordinate_type row, const coordinate_type col, [[maybe_unused]] const value_type ignored) {
+            rows(offset) = row;
+            cols(offset) = col;
+
+            ++offset;
+        }
+
+        triplet_calling_pattern_parse_handler<IT, IT_ARR> get_chunk_handler(int64_t offset_from_begin) {
+            return triplet_calling_pattern_parse_handler(rows, cols, offset_from_begin);
+        }
+
+    protected:
+        IT_ARR& rows;
+        IT_ARR& cols;
+
+        int64_t offset;
+    };
+
     /**
      * Doublet handler, for a (index, value) sparse vector.
      */
@@ -241,7 +461,11 @@ namespace fast_matrix_market {
     };
 
     /**
-     * Dense array handler (row-major).
+     * Dense array handler.
+     *
+     * Element (row, col) is stored at values[(row + row_offset) * ld + (col + col_offset)] for row-major storage,
+     * and at values[(col + col_offset) * ld + (row + row_offset)] for column-major storage. The leading dimension `ld`
+     * defaults to a packed nrows-by-ncols array.
      */
     template <typename VT_ITER>
     class dense_adding_parse_handler {
@@ -251,14 +475,18 @@ namespace fast_matrix_market {
         static constexpr int flags = kParallelOk | kDense;
 
         explicit dense_adding_parse_handler(const VT_ITER& values, storage_order order, int64_t nrows, int64_t ncols) :
-        values(values), order(order), nrows(nrows), ncols(ncols) {}
+        values(values), order(order), ld(order == row_major ? ncols : nrows) {}
+
+        explicit dense_adding_parse_handler(const VT_ITER& values, storage_order order, int64_t ld,
+                                            int64_t row_offset, int64_t col_offset) :
+        values(values), order(order), ld(ld), row_offset(row_offset), col_offset(col_offset) {}
 
         void handle(const coordinate_type row, const coordinate_type col, const value_type value) {
             int64_t offset;
             if (order == row_major) {
-                offset = row * ncols + col;
+                offset = (row + row_offset) * ld + (col + col_offset);
             } else {
-                offset = col * nrows + row;
+                offset = (col + col_offset) * ld + (row + row_offset);
             }
             values[offset] = std::plus<value_type>()(values[offset], value);
         }
@@ -270,7 +498,8 @@ namespace fast_matrix_market {
     protected:
         VT_ITER values;
         storage_order order;
-        int64_t nrows;
-        int64_t ncols;
+        int64_t ld;
+        int64_t row_offset = 0;
+        int64_t col_offset = 0;
     };
 }
\ No newline at end of file
@@ -49,6 +49,96 @@ namespace fast_matrix_market {
         typename FWD_HANDLER::value_type fwd_value;
     };
 
+    /**
+     * A handler wrapper that applies read_options::row_permutation and col_permutation to each index.
+     *
+     * Holds a reference to the wrapped handler and is only constructed for the duration of a chunk.
+     */
+    template<typename FWD_HANDLER>
+    class permuting_parse_adapter {
+    public:
+        using coordinate_type = typename FWD_HANDLER::coordinate_type;
+        using value_type = typename FWD_HANDLER::value_type;
+        static constexpr int flags = FWD_HANDLER::flags;
+
+        permuting_parse_adapter(FWD_HANDLER &handler, const int64_t* row_permutation, const int64_t* col_permutation,
+                                int64_t nrows, int64_t ncols) :
+                handler(handler), row_permutation(row_permutation), col_permutation(col_permutation),
+                nrows(nrows), ncols(ncols) {}
+
+        template <typename VT>
+        void handle(const coordinate_type row, const coordinate_type col, const VT& val) {
+            handler.handle(permute_index(row, row_permutation, nrows), permute_index(col, col_permutation, ncols), val);
+        }
+
+    protected:
+        FWD_HANDLER& handler;
+        const int64_t* row_permutation;
+        const int64_t* col_permutation;
+        int64_t nrows;
+        int64_t ncols;
+    };
+
+    template <typename HANDLER>
+    struct is_permuting_parse_adapter : std::false_type {};
+    template <typename HANDLER>
+    struct is_permuting_parse_adapter<permuting_parse_adapter<HANDLER>> : std::true_type {};
+
+    /**
+     * Whether the read should apply a permutation to the indices.
+     */
+    inline bool has_permutation(const read_options& options) {
+        return options.row_permutation != nullptr || options.col_permutation != nullptr;
+    }
+
+    /**
+     * Whether an application binding may generalize symmetry as a post-processing step.
+     *
+     * If it does, it must also call defer_permutation().
+     */
+    inline bool use_app_symmetry_generalization(const read_options& options) {
+        return options.generalize_symmetry && options.generalize_symmetry_app;
+    }
+
+    /**
+     * Permutation that a binding applies itself, after it has generalized symmetry.
+     */
+    struct deferred_permutation {
+        const int64_t* row_permutation = nullptr;
+        const int64_t* col_permutation = nullptr;
+        int64_t nrows = 0;
+        int64_t ncols = 0;
+
+        [[nodiscard]] bool empty() const {
+            return row_permutation == nullptr && col_permutation == nullptr;
+        }
+
+        template <typename IT>
+        IT row(const IT index) const {
+            return permute_index(index, row_permutation, nrows);
+        }
+
+        template <typename IT>
+        IT col(const IT index) const {
+            return permute_index(index, col_permutation, ncols);
+        }
+    };
+
+    /**
+     * Symmetry is generalized in file coordinates. Mirroring already-permuted elements is only correct if the rows
+     * and columns share the same permutation. Otherwise take the permutations out of `options`, so that the body is
+     * read in file coordinates, and return them to be applied after mirroring.
+     */
+    inline deferred_permutation defer_permutation(read_options& options, const matrix_market_header& header) {
+        deferred_permutation ret;
+        if (header.symmetry != general && options.row_permutation != options.col_permutation) {
+            ret = {options.row_permutation, options.col_permutation, header.nrows, header.ncols};
+            options.row_permutation = nullptr;
+            options.col_permutation = nullptr;
+        }
+        return ret;
+    }
+
 #ifndef FMM_SCIPY_PRUNE
     /**
      * A handler wrapper so that real/integer files can be read into std::complex matrices by setting all
@@ -209,22 +299,44 @@ namespace fast_matrix_market {
         }
     }
 
+    /**
+     * Line number of `line_start` within the file, found by counting newlines from the start of the chunk.
+     *
+     * The parse loops only track element counts. This re-scan is only done to build an error message.
+     */
+    inline int64_t recover_file_line(std::string_view chunk, const char* line_start, const line_counts& chunk_start) {
+        return chunk_start.file_line + std::count(chunk.data(), line_start, '\n');
+    }
+
     template<typename HANDLER>
-    line_counts read_chunk_matrix_coordinate(const std::string &chunk, const matrix_market_header &header,
+    line_counts read_chunk_matrix_coordinate(std::string_view chunk, const matrix_market_header &header,
                                              line_counts line, HANDLER &handler, const read_options &options) {
-        const char *pos = chunk.c_str();
+        if constexpr (!is_permuting_parse_adapter<HANDLER>::value) {
+            if (has_permutation(options)) {
+                permuting_parse_adapter<HANDLER> permuting_handler(handler, options.row_permutation,
+                                                                   options.col_permutation, header.nrows, header.ncols);
+                return read_chunk_matrix_coordinate(chunk, header, line, permuting_handler, options);
+            }
+        }
+
+        const char *pos = chunk.data();
         const char *end = pos + chunk.size();
 
-        while (pos != end) {
-            try {
+        const line_counts chunk_start = line;
+        const char *line_start = pos;
+        int64_t empty_lines = 0;
+
+        try {
+            while (pos != end) {
                 typename HANDLER::coordinate_type row, col;
                 typename HANDLER::value_type value;
 
-                pos = skip_spaces_and_newlines(pos, line.file_line);
+                pos = skip_spaces_and_newlines(pos, end, empty_lines);
                 if (pos == end) {
                     // empty line
                     break;
                 }
+                line_start = pos;
                 if (line.element_num >= header.nnz) {
                     throw invalid_mm("Too many lines in file (file too long)");
                 }
@@ -266,33 +378,48 @@ namespace fast_matrix_market {
                     handler.handle(row, col, pattern_placeholder_type());
                 }
 
-                ++line.file_line;
                 ++line.element_num;
-            } catch (invalid_mm& inv) {
-                inv.prepend_line_number(line.file_line + 1);
-                throw;
             }
+        } catch (invalid_mm& inv) {
+            inv.prepend_line_number(recover_file_line(chunk, line_start, chunk_start) + 1);
+            throw;
         }
+
+        // every element occupies exactly one line
+        line.file_line += (line.element_num - chunk_start.element_num) + empty_lines;
         return line;
     }
 
 #ifndef FMM_NO_VECTOR
     template<typename HANDLER>
-    line_counts read_chunk_vector_coordinate(const std::string &chunk, const matrix_market_header &header,
+    line_counts read_chunk_vector_coordinate(std::string_view chunk, const matrix_market_header &header,
                                              line_counts line, HANDLER &handler, const read_options &options) {
-        const char *pos = chunk.c_str();
+        if constexpr (!is_permuting_parse_adapter<HANDLER>::value) {
+            if (options.row_permutation != nullptr) {
+                permuting_parse_adapter<HANDLER> permuting_handler(handler, options.row_permutation, nullptr,
+                                                                   header.vector_length, 1);
+                return read_chunk_vector_coordinate(chunk, header, line, permuting_handler, options);
+            }
+        }
+
+        const char *pos = chunk.data();
         const char *end = pos + chunk.size();
 
-        while (pos != end) {
-            try {
+        const line_counts chunk_start = line;
+        const char *line_start = pos;
+        int64_t empty_lines = 0;
+
+        try {
+            while (pos != end) {
                 typename HANDLER::coordinate_type row;
                 typename HANDLER::value_type value;
 
-                pos = skip_spaces_and_newlines(pos, line.file_line);
+                pos = skip_spaces_and_newlines(pos, end, empty_lines);
                 if (pos == end) {
                     // empty line
                     break;
                 }
+                line_start = pos;
                 if (line.element_num >= header.nnz) {
                     throw invalid_mm("Too many lines in file (file too long)");
                 }
@@ -317,23 +444,36 @@ namespace fast_matrix_market {
                     handler.handle(row, 0, pattern_placeholder_type());
                 }
 
-                ++line.file_line;
                 ++line.element_num;
-            } catch (invalid_mm& inv) {
-                inv.prepend_line_number(line.file_line + 1);
-                throw;
             }
+        } catch (invalid_mm& inv) {
+            inv.prepend_line_number(recover_file_line(chunk, line_start, chunk_start) + 1);
+            throw;
         }
+
+        // every element occupies exactly one line
+        line.file_line += (line.element_num - chunk_start.element_num) + empty_lines;
         return line;
     }
 #endif
 
     template<typename HANDLER>
-    line_counts read_chunk_array(const std::string &chunk, const matrix_market_header &header, line_counts line,
+    line_counts read_chunk_array(std::string_view chunk, const matrix_market_header &header, line_counts line,
                                  HANDLER &handler, const read_options &options,
                                  typename HANDLER::coordinate_type &row,
                                  typename HANDLER::coordinate_type &col) {
-        const char *pos = chunk.c_str();
+        if constexpr (!is_permuting_parse_adapter<HANDLER>::value) {
+            if (has_permutation(options)) {
+                // row and col track the position in the file, so are not permuted
+                const bool is_vector = header.object == vector;
+                permuting_parse_adapter<HANDLER> permuting_handler(handler, options.row_permutation,
+                                                                   is_vector ? nullptr : options.col_permutation,
+                                                                   header.nrows, header.ncols);
+                return read_chunk_array(chunk, header, line, permuting_handler, options, row, col);
+            }
+        }
+
+        const char *pos = chunk.data();
         const char *end = pos + chunk.size();
 
         if (header.symmetry == skew_symmetric) {
@@ -346,15 +486,20 @@ namespace fast_matrix_market {
             }
         }
 
-        while (pos != end) {
-            try {
+        const line_counts chunk_start = line;
+        const char *line_start = pos;
+        int64_t empty_lines = 0;
+
+        try {
+            while (pos != end) {
                 typename HANDLER::value_type value;
 
-                pos = skip_spaces_and_newlines(pos, line.file_line);
+                pos = skip_spaces_and_newlines(pos, end, empty_lines);
                 if (pos == end) {
                     // empty line
                     break;
                 }
+                line_start = pos;
                 if (static_cast<int64_t>(col) >= header.ncols) {
                     throw invalid_mm("Too many values in array (file too long)");
                 }
@@ -388,13 +533,15 @@ namespace fast_matrix_market {
                     }
                 }
 
-                ++line.file_line;
                 ++line.element_num;
-            } catch (invalid_mm& inv) {
-                inv.prepend_line_number(line.file_line + 1);
-                throw;
             }
+        } catch (invalid_mm& inv) {
+            inv.prepend_line_number(recover_file_line(chunk, line_start, chunk_start) + 1);
+            throw;
         }
+
+        // every element occupies exactly one line
+        line.file_line += (line.element_num - chunk_start.element_num) + empty_lines;
         return line;
     }
 
@@ -409,13 +556,18 @@ namespace fast_matrix_market {
 namespace fast_matrix_market {
 
     template <typename HANDLER>
-    line_counts read_coordinate_body_sequential(std::istream& instream, const matrix_market_header& header,
+    line_counts read_coordinate_body_sequential(byte_source& source, const matrix_market_header& header,
                                                 HANDLER& handler, const read_options& options = {}) {
         line_counts lc{header.header_line_count, 0};
-
-        // Read the file in chunks
-        while (instream.good()) {
-            std::string chunk = get_next_chunk(instream, options);
+        checksum_accumulator checksum;
+
+        // Read the file in chunks. Reuse the same chunk buffer.
+        std::string buffer;
+        while (source.good()) {
+            std::string_view chunk = get_next_chunk_view(buffer, source, options);
+            if (options.expected_checksum) {
+                checksum.add(crc32c(chunk), (int64_t)chunk.size());
+            }
 
             // parse the chunk
             if (header.object == matrix) {
@@ -429,11 +581,21 @@ namespace fast_matrix_market {
             }
         }
 
+        if (options.expected_checksum) {
+            checksum.verify(*options.expected_checksum);
+        }
         return lc;
     }
 
     template <typename HANDLER>
-    line_counts read_array_body_sequential(std::istream& instream, const matrix_market_header& header,
+    line_counts read_coordinate_body_sequential(std::istream& instream, const matrix_market_header& header,
+                                                HANDLER& handler, const read_options& options = {}) {
+        istream_source source(instream);
+        return read_coordinate_body_sequential(source, header, handler, options);
+    }
+
+    template <typename HANDLER>
+    line_counts read_array_body_sequential(byte_source& source, const matrix_market_header& header,
                                            HANDLER& handler,
                                            const read_options& options = {}) {
         line_counts lc{header.header_line_count, 0};
@@ -441,22 +603,39 @@ namespace fast_matrix_market {
         typename HANDLER::coordinate_type row = 0;
         typename HANDLER::coordinate_type col = 0;
 
-        // Read the file in chunks
-        while (instream.good()) {
-            std::string chunk = get_next_chunk(instream, options);
+        checksum_accumulator checksum;
+
+        // Read the file in chunks. Reuse the same chunk buffer.
+        std::string buffer;
+        while (source.good()) {
+            std::string_view chunk = get_next_chunk_view(buffer, source, options);
+            if (options.expected_checksum) {
+                checksum.add(crc32c(chunk), (int64_t)chunk.size());
+            }
 
             // parse the chunk
             lc = read_chunk_array(chunk, header, lc, handler, options, row, col);
         }
 
+        if (options.expected_checksum) {
+            checksum.verify(*options.expected_checksum);
+        }
         return lc;
     }
 
+    template <typename HANDLER>
+    line_counts read_array_body_sequential(std::istream& instream, const matrix_market_header& header,
+                                           HANDLER& handler,
+                                           const read_options& options = {}) {
+        istream_source source(instream);
+        return read_array_body_sequential(source, header, handler, options);
+    }
+
     /**
      * Read the body with no automatic adaptations.
      */
     template <typename HANDLER, compile_format FORMAT = compile_all>
-    void read_matrix_market_body_no_adapters(std::istream& instream, const matrix_market_header& header,
+    void read_matrix_market_body_no_adapters(byte_source& source, const matrix_market_header& header,
                                              HANDLER& handler, const read_options& options = {}) {
 #ifdef FMM_NO_VECTOR
         if (header.object == vector) {
@@ -488,18 +667,28 @@ namespace fast_matrix_market {
             threads = false;
         }
 
+        // Small inputs are not worth the overhead of a thread pool.
+        auto body_bytes = estimate_body_bytes(source, header);
+        if (body_bytes <= options.chunk_size_bytes) {
+            threads = false;
+        }
+
         if (threads) {
-            lc = read_body_threads<HANDLER, FORMAT>(instream, header, handler, options);
+            lc = read_body_threads<HANDLER, FORMAT>(source, header, handler, options);
         } else {
+            // Do not allocate a full-size chunk buffer for a body that is much smaller.
+            read_options seq_options = options;
+            seq_options.chunk_size_bytes = std::min(options.chunk_size_bytes, body_bytes + kMinChunkSizeBytes);
+
             if (header.format == coordinate) {
                 if constexpr ((FORMAT & compile_coordinate_only) == compile_coordinate_only) {
-                    lc = read_coordinate_body_sequential(instream, header, handler, options);
+                    lc = read_coordinate_body_sequential(source, header, handler, seq_options);
                 } else {
                     throw support_not_selected("Matrix is coordinate but reading coordinate files not enabled for this method.");
                 }
             } else {
                 if constexpr ((FORMAT & compile_array_only) == compile_array_only) {
-                    lc = read_array_body_sequential(instream, header, handler, options);
+                    lc = read_array_body_sequential(source, header, handler, seq_options);
                 } else {
                     throw support_not_selected("Matrix is array but reading array files not enabled for this method.");
                 }
@@ -515,6 +704,13 @@ namespace fast_matrix_market {
         }
     }
 
+    template <typename HANDLER, compile_format FORMAT = compile_all>
+    void read_matrix_market_body_no_adapters(std::istream& instream, const matrix_market_header& header,
+                                             HANDLER& handler, const read_options& options = {}) {
+        istream_source source(instream);
+        read_matrix_market_body_no_adapters<HANDLER, FORMAT>(source, header, handler, options);
+    }
+
 #ifndef FMM_SCIPY_PRUNE
     /**
      * Read the body by adapting real files to complex HANDLER.
@@ -557,9 +753,11 @@ namespace fast_matrix_market {
      * This will handle the following adaptations automatically:
      *  - If the file is a pattern file, the pattern_value will be substituted for each element
      *  - If the HANDLER expects std::complex values but the file is not complex then imag=0 is provided for each value.
+     *
+     * The body is read from a byte_source, so any transport can be plugged in. See byte_io.hpp.
      */
     template <typename HANDLER, compile_format FORMAT = compile_all>
-    void read_matrix_market_body(std::istream& instream, const matrix_market_header& header,
+    void read_matrix_market_body(byte_source& source, const matrix_market_header& header,
                                  HANDLER& handler,
                                  typename HANDLER::value_type pattern_value,
                                  const read_options& options = {}) {
@@ -569,6 +767,15 @@ namespace fast_matrix_market {
         }
 
         auto fwd_handler = pattern_parse_adapter<HANDLER>(handler, pattern_value);
-        read_matrix_market_body_no_adapters<decltype(fwd_handler), FORMAT>(instream, header, fwd_handler, options);
+        read_matrix_market_body_no_adapters<decltype(fwd_handler), FORMAT>(source, header, fwd_handler, options);
+    }
+
+    template <typename HANDLER, compile_format FORMAT = compile_all>
+    void read_matrix_market_body(std::istream& instream, const matrix_market_header& header,
+                                 HANDLER& handler,
+                                 typename HANDLER::value_type pattern_value,
+                                 const read_options& options = {}) {
+        istream_source source(instream);
+        read_matrix_market_body<HANDLER, FORMAT>(source, header, handler, pattern_value, options);
     }
 }
\ No newline at end of file
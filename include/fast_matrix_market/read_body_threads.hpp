@@ -4,33 +4,57 @@
 
 #pragma once
 
+#include <deque>
 #include <future>
 #include <queue>
 
 #include "fast_matrix_market.hpp"
+#include "task_completion_tracker.hpp"
 #include "thirdparty/task_thread_pool.hpp"
 
 namespace fast_matrix_market {
 
     struct line_count_result_s {
+        /**
+         * Buffer for chunks that are copied from the source.
+         */
         std::string chunk;
+
+        /**
+         * The chunk. Either points into `chunk` or is borrowed from the source.
+         */
+        std::string_view view;
         line_counts counts;
 
-        explicit line_count_result_s(std::string && c): chunk(c) {}
+        /**
+         * CRC32C of the chunk, if requested.
+         */
+        uint32_t crc32c = 0;
+
+        /**
+         * Position of the chunk in the file. Identifies the chunk in traces.
+         */
+        int64_t chunk_num = 0;
+
+        explicit line_count_result_s(std::string && c): chunk(c), view(chunk) {}
     };
 
     using line_count_result = std::shared_ptr<line_count_result_s>;
 
-    inline line_count_result count_chunk_lines(line_count_result lcr) {
-        auto [lines, empties] = count_lines(lcr->chunk);
+    inline line_count_result count_chunk_lines(line_count_result lcr, bool checksum) {
+        FMM_TRACE_SCOPE("count lines", lcr->chunk_num);
+        auto [lines, empties] = count_lines(lcr->view);
 
         lcr->counts.file_line = lines;
         lcr->counts.element_num = lines - empties;
+        if (checksum) {
+            lcr->crc32c = crc32c(lcr->view);
+        }
         return lcr;
     }
 
     template <typename HANDLER, compile_format FORMAT = compile_all>
-    line_counts read_body_threads(std::istream& instream, const matrix_market_header& header,
+    line_counts read_body_threads(byte_source& source, const matrix_market_header& header,
                                   HANDLER& handler, const read_options& options = {}) {
         /*
          * Pipeline:
@@ -52,13 +76,40 @@ namespace fast_matrix_market {
          * the input stream and start its line count.
          *
          * The line count step is significantly faster than the parse step. As a form of backpressure we don't read
-         * additional chunks if there are too many inflight chunks.
+         * additional chunks if there are too many inflight chunks, or if the inflight chunks are too large in total.
          */
         line_counts lc{header.header_line_count, 0};
 
         std::queue<std::future<line_count_result>> line_count_futures;
-        std::queue<std::future<line_count_result>> parse_futures;
-        task_thread_pool::task_thread_pool pool(options.num_threads);
+        std::deque<std::future<line_count_result>> parse_futures;
+        task_completion_tracker parse_tracker;
+
+        unsigned num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+        num_threads = std::max(num_threads, 1u);
+
+        // Total size of chunks that have been read but not yet parsed.
+        int64_t inflight_bytes = 0;
+        auto within_byte_budget = [&]() {
+            return options.max_inflight_bytes <= 0 || inflight_bytes < options.max_inflight_bytes;
+        };
+
+        // Read the first batch of chunks before starting the pool.
+        // Inputs with only a few chunks then do not start threads that would have nothing to do.
+        std::queue<line_count_result> seed_chunks;
+        int64_t num_chunks_read = 0;
+        while (seed_chunks.size() < num_threads + 1 && source.good() && (seed_chunks.empty() || within_byte_budget())) {
+            auto lcr = std::make_shared<line_count_result_s>("");
+            lcr->chunk_num = num_chunks_read++;
+            FMM_TRACE_SCOPE("read chunk", lcr->chunk_num);
+            lcr->view = get_next_chunk_view(lcr->chunk, source, options);
+            inflight_bytes += (int64_t)lcr->view.size();
+            seed_chunks.push(lcr);
+        }
+        if (!source.good()) {
+            num_threads = std::max((unsigned)seed_chunks.size(), 1u);
+        }
+
+        task_thread_pool::task_thread_pool pool(num_threads);
 
         // Reuse the line_count_result objects. Each chunk would otherwise allocate a new 1MB std::string.
         // The lifetime of these strings is relatively short, but some allocators do not immediately reuse the memory.
@@ -67,36 +118,84 @@ namespace fast_matrix_market {
 
         int generalizing_symmetry_factor = (header.symmetry != general && options.generalize_symmetry) ? 2 : 1;
 
+        // Chunk checksums are computed by the line count tasks and combined in file order.
+        const bool verify_checksum = options.expected_checksum != nullptr;
+        checksum_accumulator checksum;
+
         // Number of concurrent chunks available to work on.
         // Too few may starve workers (such as due to uneven chunk splits)
         // Too many increases costs, such as storing chunk results in memory before they're written.
-        const unsigned inflight_count = pool.get_num_threads() + 1;
+        // Large chunks are further limited by the byte budget.
+        const std::size_t inflight_count = pool.get_num_threads() + 1;
+
+        // Collect the parse results that are ready. This will throw any parse errors.
+        auto collect_finished_parses = [&]() {
+            int num_collected = 0;
+            for (auto it = parse_futures.begin(); it != parse_futures.end();) {
+                if (!is_ready(*it)) {
+                    ++it;
+                    continue;
+                }
+
+                line_count_result lcr_to_reuse;
+                try {
+                    lcr_to_reuse = it->get();
+                } catch (...) {
+                    // Report the error that appears first in the file.
+                    for (auto prior = parse_futures.begin(); prior != it; ++prior) {
+                        prior->get();
+                    }
+                    throw;
+                }
+                FMM_TRACE_SCOPE("commit", lcr_to_reuse->chunk_num);
+                it = parse_futures.erase(it);
+                inflight_bytes -= (int64_t)lcr_to_reuse->view.size();
+                ++num_collected;
 
-        // Start reading chunks and counting lines.
-        for (unsigned seed_i = 0; seed_i < inflight_count && instream.good(); ++seed_i) {
-            line_count_result lcr = std::make_shared<line_count_result_s>(get_next_chunk(instream, options));
-            line_count_futures.push(pool.submit(count_chunk_lines, lcr));
+                // save the lcr struct to reuse the memory
+                lcr_reuse_pool.push(lcr_to_reuse);
+            }
+            return num_collected;
+        };
+
+        // Start counting lines.
+        for (; !seed_chunks.empty(); seed_chunks.pop()) {
+            line_count_futures.push(pool.submit(count_chunk_lines, seed_chunks.front(), verify_checksum));
         }
 
         // Read chunks in order, as they become available.
         while (!line_count_futures.empty()) {
 
-            // Wait on any parse results. This serves as backpressure.
-            while (!parse_futures.empty() && (is_ready(parse_futures.front()) || parse_futures.size() > inflight_count)) {
-                // This will throw any parse errors.
-                auto lcr_to_reuse = parse_futures.front().get();
-                parse_futures.pop();
-
-                // save the lcr struct to reuse the memory
-                lcr_reuse_pool.push(lcr_to_reuse);
+            // Collect finished parse results, in any order. Waiting on them serves as backpressure.
+            // Waiting on only the oldest chunk would let a single slow chunk stall the pipeline.
+            collect_finished_parses();
+            while (!parse_futures.empty() && (parse_futures.size() > inflight_count || !within_byte_budget())) {
+                auto seen_completed = parse_tracker.get_num_completed();
+                if (collect_finished_parses() == 0) {
+                    FMM_TRACE_SCOPE("wait parse", -1);
+                    if (parse_tracker.get_num_running() == 0) {
+                        // Parse is done but its future is not yet ready.
+                        parse_futures.front().wait();
+                    } else {
+                        parse_tracker.wait_for_completion(seen_completed);
+                    }
+                }
             }
 
             // We are ready to start another parse task.
-            line_count_result lcr = line_count_futures.front().get();
+            line_count_result lcr;
+            {
+                FMM_TRACE_SCOPE("wait line count", -1);
+                lcr = line_count_futures.front().get();
+            }
             line_count_futures.pop();
+            if (verify_checksum) {
+                checksum.add(lcr->crc32c, (int64_t)lcr->view.size());
+            }
 
-            // Next chunk has finished line count. Start another to replace it.
-            if (instream.good()) {
+            // Next chunk has finished line count. Start another to replace it, if the budget allows.
+            while (source.good() && line_count_futures.size() < inflight_count &&
+                   (line_count_futures.empty() || within_byte_budget())) {
                 line_count_result lcr_reuse;
                 // attempt to reuse the chunk string object from a previous chunk
                 if (lcr_reuse_pool.empty()) {
@@ -106,8 +205,13 @@ namespace fast_matrix_market {
                     lcr_reuse_pool.pop();
                 }
 
-                get_next_chunk(lcr_reuse->chunk, instream, options);
-                line_count_futures.push(pool.submit(count_chunk_lines, lcr_reuse));
+                lcr_reuse->chunk_num = num_chunks_read++;
+                {
+                    FMM_TRACE_SCOPE("read chunk", lcr_reuse->chunk_num);
+                    lcr_reuse->view = get_next_chunk_view(lcr_reuse->chunk, source, options);
+                }
+                inflight_bytes += (int64_t)lcr_reuse->view.size();
+                line_count_futures.push(pool.submit(count_chunk_lines, lcr_reuse, verify_checksum));
             }
 
             // Parse it.
@@ -121,8 +225,9 @@ namespace fast_matrix_market {
                     typename HANDLER::coordinate_type row = lc.element_num % header.nrows;
                     typename HANDLER::coordinate_type col = lc.element_num / header.nrows;
 
-                    parse_futures.push(pool.submit([=]() mutable {
-                        read_chunk_array(lcr->chunk, header, lc, chunk_handler, options, row, col);
+                    parse_futures.push_back(parse_tracker.submit(pool, [=]() mutable {
+                        FMM_TRACE_SCOPE("parse", lcr->chunk_num);
+                        read_chunk_array(lcr->view, header, lc, chunk_handler, options, row, col);
                         return lcr;
                     }));
                 } else {
@@ -130,8 +235,9 @@ namespace fast_matrix_market {
                 }
             } else if (header.object == matrix) {
                 if constexpr ((FORMAT & compile_coordinate_only) == compile_coordinate_only) {
-                    parse_futures.push(pool.submit([=]() mutable {
-                        read_chunk_matrix_coordinate(lcr->chunk, header, lc, chunk_handler, options);
+                    parse_futures.push_back(parse_tracker.submit(pool, [=]() mutable {
+                        FMM_TRACE_SCOPE("parse", lcr->chunk_num);
+                        read_chunk_matrix_coordinate(lcr->view, header, lc, chunk_handler, options);
                         return lcr;
                     }));
                 } else {
@@ -141,8 +247,9 @@ namespace fast_matrix_market {
 #ifdef FMM_NO_VECTOR
                 throw no_vector_support("Vector Matrix Market files not supported.");
 #else
-                parse_futures.push(pool.submit([=]() mutable {
-                    read_chunk_vector_coordinate(lcr->chunk, header, lc, chunk_handler, options);
+                parse_futures.push_back(parse_tracker.submit(pool, [=]() mutable {
+                    FMM_TRACE_SCOPE("parse", lcr->chunk_num);
+                    read_chunk_vector_coordinate(lcr->view, header, lc, chunk_handler, options);
                     return lcr;
                 }));
 #endif
@@ -155,10 +262,26 @@ namespace fast_matrix_market {
 
         // Wait on any parse results. This will throw any parse errors.
         while (!parse_futures.empty()) {
-            parse_futures.front().get();
-            parse_futures.pop();
+            line_count_result lcr;
+            {
+                FMM_TRACE_SCOPE("wait parse", -1);
+                lcr = parse_futures.front().get();
+            }
+            FMM_TRACE_SCOPE("commit", lcr->chunk_num);
+            parse_futures.pop_front();
+        }
+
+        if (verify_checksum) {
+            checksum.verify(*options.expected_checksum);
         }
 
         return lc;
     }
+
+    template <typename HANDLER, compile_format FORMAT = compile_all>
+    line_counts read_body_threads(std::istream& instream, const matrix_market_header& header,
+                                  HANDLER& handler, const read_options& options = {}) {
+        istream_source source(instream);
+        return read_body_threads<HANDLER, FORMAT>(source, header, handler, options);
+    }
 }
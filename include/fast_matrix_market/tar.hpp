@@ -0,0 +1,394 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/**
+ * Read members of a tar archive without extracting them. Not included by fast_matrix_market.hpp.
+ *
+ * The archive is read sequentially in a single pass, so it may be any stream, including a gzip_istream:
+ *     std::ifstream f("matrix.tar.gz", std::ios::binary);
+ *     fast_matrix_market::gzip_istream gz(f);
+ *     fast_matrix_market::tar_reader tar(gz);
+ *     if (fast_matrix_market::find_tar_member(tar, "*.mtx")) {
+ *         fast_matrix_market::read_matrix_market_triplet(tar.member(), ...);
+ *     }
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <istream>
+#include <limits>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "fast_matrix_market.hpp"
+
+namespace fast_matrix_market {
+
+    /**
+     * The archive is corrupt or not a tar file.
+     */
+    class tar_error : public fmm_error {
+    public:
+        explicit tar_error(std::string msg): fmm_error(std::move(msg)) {}
+    };
+
+    constexpr int64_t kTarBlockBytes = 512;
+
+    /**
+     * Match `name` against a shell-style pattern. `*` matches any sequence of characters, including '/',
+     * and `?` matches any one character.
+     */
+    inline bool tar_glob_match(const std::string& pattern, const std::string& name) {
+        std::size_t p = 0, n = 0;
+        std::size_t star = std::string::npos, star_n = 0;
+
+        while (n < name.size()) {
+            if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+                ++p;
+                ++n;
+            } else if (p < pattern.size() && pattern[p] == '*') {
+                star = p++;
+                star_n = n;
+            } else if (star != std::string::npos) {
+                // let the last star absorb one more character
+                p = star + 1;
+                n = ++star_n;
+            } else {
+                return false;
+            }
+        }
+
+        while (p < pattern.size() && pattern[p] == '*') {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    /**
+     * A std::streambuf over the next `size` bytes of another stream.
+     */
+    class bounded_streambuf : public std::streambuf {
+    public:
+        explicit bounded_streambuf(std::istream& source) : source(source) {}
+
+        void reset(int64_t size) {
+            remaining = size;
+            setg(buffer.data(), buffer.data(), buffer.data());
+        }
+
+        /**
+         * Bytes of the source that have not been read yet.
+         */
+        [[nodiscard]] int64_t unread() const {
+            return remaining;
+        }
+
+    protected:
+        int_type underflow() override {
+            if (remaining <= 0) {
+                return traits_type::eof();
+            }
+            buffer.resize(kBufferBytes);
+            auto num_read = read_source(buffer.data(), (std::streamsize)buffer.size());
+            if (num_read <= 0) {
+                return traits_type::eof();
+            }
+            setg(buffer.data(), buffer.data(), buffer.data() + num_read);
+            return traits_type::to_int_type(buffer[0]);
+        }
+
+        std::streamsize xsgetn(char_type* s, std::streamsize count) override {
+            // drain the get area, then read large requests straight from the source
+            std::streamsize ret = std::min(count, (std::streamsize)(egptr() - gptr()));
+            std::copy(gptr(), gptr() + ret, s);
+            gbump((int)ret);
+
+            if (ret < count) {
+                ret += read_source(s + ret, count - ret);
+            }
+            return ret;
+        }
+
+        std::streamsize read_source(char_type* s, std::streamsize count) {
+            count = std::min(count, (std::streamsize)remaining);
+            source.read(s, count);
+            auto num_read = source.gcount();
+            remaining -= num_read;
+            if (num_read < count) {
+                throw tar_error("Truncated tar archive.");
+            }
+            return num_read;
+        }
+
+        static constexpr std::size_t kBufferBytes = 1U << 16U;
+
+        std::istream& source;
+        std::string buffer;
+        int64_t remaining = 0;
+    };
+
+    /**
+     * An archive entry.
+     */
+    struct tar_entry {
+        std::string name;
+        int64_t size = 0;
+
+        /**
+         * The ustar typeflag, such as '0' for a regular file or '5' for a directory.
+         */
+        char type = '0';
+
+        [[nodiscard]] bool is_regular_file() const {
+            return type == '0' || type == '\0' || type == '7';
+        }
+    };
+
+    /**
+     * Reads the entries of a tar archive in order.
+     *
+     * Supports ustar, GNU long names, and pax extended headers for long paths and large sizes.
+     * The archive is never seeked; unread member data is skipped by reading it.
+     */
+    class tar_reader {
+    public:
+        explicit tar_reader(std::istream& archive) : archive(archive), member_buf(archive), member_stream(&member_buf) {
+            // surface tar_error thrown by the streambuf to the parser
+            member_stream.exceptions(std::ios_base::badbit);
+        }
+
+        tar_reader(const tar_reader&) = delete;
+        tar_reader& operator=(const tar_reader&) = delete;
+
+        /**
+         * Advance to the next entry, skipping whatever is left of the current one.
+         *
+         * @return false at the end of the archive.
+         */
+        bool next() {
+            skip_member();
+
+            std::string long_name;
+            int64_t pax_size = -1;
+
+            while (true) {
+                std::string header(kTarBlockBytes, '\0');
+                archive.read(header.data(), kTarBlockBytes);
+                if (archive.gcount() == 0) {
+                    // missing end-of-archive marker, as written by some tools
+                    return false;
+                }
+                if (archive.gcount() != kTarBlockBytes) {
+                    throw tar_error("Truncated tar archive.");
+                }
+                if (header.find_first_not_of('\0') == std::string::npos) {
+                    // end-of-archive marker
+                    return false;
+                }
+                check_checksum(header);
+
+                current.type = header[156];
+                current.size = parse_number(header, 124, 12);
+
+                if (current.type == 'L' || current.type == 'x' || current.type == 'g') {
+                    std::string data = read_data(current.size);
+                    if (current.type == 'L') {
+                        long_name = data.substr(0, data.find('\0'));
+                    } else if (current.type == 'x') {
+                        parse_pax(data, long_name, pax_size);
+                    }
+                    continue;
+                }
+
+                if (!long_name.empty()) {
+                    current.name = long_name;
+                } else {
+                    current.name = field(header, 0, 100);
+                    std::string prefix = field(header, 345, 155);
+                    if (header.compare(257, 5, "ustar") == 0 && !prefix.empty()) {
+                        current.name = prefix + "/" + current.name;
+                    }
+                }
+                if (pax_size >= 0) {
+                    current.size = pax_size;
+                }
+
+                member_buf.reset(current.is_regular_file() ? current.size : 0);
+                padding = current.is_regular_file() ? padding_for(current.size) : 0;
+                if (!current.is_regular_file()) {
+                    // directories, links, etc. have no data, except for unknown types
+                    skip(current.size + padding_for(current.size));
+                }
+                member_stream.clear();
+                return true;
+            }
+        }
+
+        [[nodiscard]] const tar_entry& entry() const {
+            return current;
+        }
+
+        /**
+         * Stream of the current entry's data.
+         */
+        std::istream& member() {
+            return member_stream;
+        }
+
+    protected:
+        static int64_t padding_for(int64_t size) {
+            return (kTarBlockBytes - size % kTarBlockBytes) % kTarBlockBytes;
+        }
+
+        static std::string field(const std::string& header, std::size_t offset, std::size_t length) {
+            std::string ret = header.substr(offset, length);
+            return ret.substr(0, ret.find('\0'));
+        }
+
+        /**
+         * Octal number, or base-256 if the high bit of the first byte is set.
+         */
+        static int64_t parse_number(const std::string& header, std::size_t offset, std::size_t length) {
+            auto first = (unsigned char)header[offset];
+            int64_t ret = 0;
+            if (first & 0x80U) {
+                ret = first & 0x7fU;
+                for (std::size_t i = 1; i < length; ++i) {
+                    ret = (ret << 8U) | (unsigned char)header[offset + i];
+                }
+                return ret;
+            }
+
+            for (std::size_t i = 0; i < length; ++i) {
+                char c = header[offset + i];
+                if (c == ' ' && ret == 0) {
+                    continue;
+                }
+                if (c < '0' || c > '7') {
+                    break;
+                }
+                ret = ret * 8 + (c - '0');
+            }
+            return ret;
+        }
+
+        static void check_checksum(const std::string& header) {
+            int64_t sum = 0;
+            for (std::size_t i = 0; i < header.size(); ++i) {
+                // the checksum field counts as spaces
+                sum += (i >= 148 && i < 156) ? ' ' : (unsigned char)header[i];
+            }
+            if (sum != parse_number(header, 148, 8)) {
+                throw tar_error("Invalid tar header checksum.");
+            }
+        }
+
+        /**
+         * Read pax records of the form "<length> <key>=<value>\n".
+         */
+        static void parse_pax(const std::string& data, std::string& path, int64_t& size) {
+            std::size_t pos = 0;
+            while (pos < data.size()) {
+                std::size_t space = data.find(' ', pos);
+                if (space == std::string::npos) {
+                    break;
+                }
+                auto length = std::strtoll(data.c_str() + pos, nullptr, 10);
+                if (length <= 0 || pos + length > data.size()) {
+                    throw tar_error("Invalid pax extended header.");
+                }
+
+                std::string record = data.substr(space + 1, pos + length - space - 2);
+                std::size_t eq = record.find('=');
+                if (eq != std::string::npos) {
+                    std::string key = record.substr(0, eq);
+                    if (key == "path") {
+                        path = record.substr(eq + 1);
+                    } else if (key == "size") {
+                        size = std::strtoll(record.c_str() + eq + 1, nullptr, 10);
+                    }
+                }
+                pos += length;
+            }
+        }
+
+        std::string read_data(int64_t size) {
+            std::string ret((std::size_t)size, '\0');
+            archive.read(ret.data(), size);
+            if (archive.gcount() != size) {
+                throw tar_error("Truncated tar archive.");
+            }
+            skip(padding_for(size));
+            return ret;
+        }
+
+        void skip(int64_t num_bytes) {
+            while (num_bytes > 0) {
+                auto count = (std::streamsize)std::min(num_bytes, (int64_t)std::numeric_limits<std::streamsize>::max());
+                archive.ignore(count);
+                if (archive.gcount() != count) {
+                    throw tar_error("Truncated tar archive.");
+                }
+                num_bytes -= count;
+            }
+        }
+
+        void skip_member() {
+            skip(member_buf.unread() + padding);
+            member_buf.reset(0);
+            padding = 0;
+        }
+
+        std::istream& archive;
+        tar_entry current;
+        bounded_streambuf member_buf;
+        std::istream member_stream;
+        int64_t padding = 0;
+    };
+
+    /**
+     * Advance to the next regular file whose name matches `pattern`. See tar_glob_match().
+     *
+     * @return false if the archive ended without a match.
+     */
+    inline bool find_tar_member(tar_reader& tar, const std::string& pattern) {
+        while (tar.next()) {
+            if (tar.entry().is_regular_file() && tar_glob_match(pattern, tar.entry().name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Visit every regular file in the archive whose name matches any of `patterns`, in a single pass.
+     *
+     * `callback(const tar_entry&, std::istream&)` is called with a stream of each matching member's data,
+     * which it may read fully, partially, or not at all.
+     *
+     * @return the number of matching members.
+     */
+    template <typename CALLBACK>
+    int64_t read_tar_members(std::istream& archive, const std::vector<std::string>& patterns, CALLBACK callback) {
+        tar_reader tar(archive);
+        int64_t num_matched = 0;
+
+        while (tar.next()) {
+            if (!tar.entry().is_regular_file()) {
+                continue;
+            }
+            for (const auto& pattern : patterns) {
+                if (tar_glob_match(pattern, tar.entry().name)) {
+                    ++num_matched;
+                    callback(tar.entry(), tar.member());
+                    break;
+                }
+            }
+        }
+        return num_matched;
+    }
+}
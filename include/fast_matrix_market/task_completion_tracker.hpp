@@ -0,0 +1,88 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace fast_matrix_market {
+
+    /**
+     * Tracks tasks submitted to a thread pool so that the submitting thread can wait for *any* task to finish,
+     * not just a particular one.
+     *
+     * This lets the parallel pipelines keep workers busy with later chunks while an earlier, slower, chunk is still
+     * in progress.
+     */
+    class task_completion_tracker {
+    public:
+        /**
+         * Submit a task to the pool. The task is tracked until it returns or throws.
+         *
+         * @return the std::future returned by pool.submit().
+         */
+        template <typename POOL, typename F, typename... A>
+        auto submit(POOL& pool, F func, A... args) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++num_submitted;
+            }
+            return pool.submit([this, func, args...]() mutable {
+                completion_guard guard(*this);
+                return func(args...);
+            });
+        }
+
+        /**
+         * @return number of tasks that have finished so far.
+         */
+        int64_t get_num_completed() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return num_completed;
+        }
+
+        /**
+         * @return number of tasks that have been submitted but not yet finished.
+         */
+        int64_t get_num_running() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return num_submitted - num_completed;
+        }
+
+        /**
+         * Block until more than `seen_completed` tasks have finished, or no tasks are running.
+         *
+         * Note that a task's future may become ready slightly after the task is counted as finished.
+         *
+         * @param seen_completed a previous value of get_num_completed().
+         */
+        void wait_for_completion(int64_t seen_completed) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return num_completed != seen_completed || num_completed == num_submitted; });
+        }
+
+    protected:
+        class completion_guard {
+        public:
+            explicit completion_guard(task_completion_tracker& tracker) : tracker(tracker) {}
+            ~completion_guard() {
+                {
+                    std::lock_guard<std::mutex> lock(tracker.mutex);
+                    ++tracker.num_completed;
+                }
+                tracker.cv.notify_all();
+            }
+
+        protected:
+            task_completion_tracker& tracker;
+        };
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        int64_t num_submitted = 0;
+        int64_t num_completed = 0;
+    };
+}
@@ -100,6 +100,11 @@
 #include <thread>
 #include <type_traits>
 
+// Hook for an external tracer to record how long the scope it is placed in takes. No-op by default.
+#ifndef TASK_THREAD_POOL_TRACE_SCOPE
+#define TASK_THREAD_POOL_TRACE_SCOPE(name)
+#endif
+
 // MSVC does not correctly set the __cplusplus macro by default, so we must read it from _MSVC_LANG
 // See https://devblogs.microsoft.com/cppblog/msvc-now-correctly-reports-__cplusplus/
 #if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
@@ -313,7 +318,10 @@ namespace task_thread_pool {
                     }
                 }
 
-                task_cv.wait(tasks_lock, [&]() { return !pool_running || (!pool_paused && !tasks.empty()); });
+                {
+                    TASK_THREAD_POOL_TRACE_SCOPE("pool idle");
+                    task_cv.wait(tasks_lock, [&]() { return !pool_running || (!pool_paused && !tasks.empty()); });
+                }
 
                 if (!pool_running) {
                     break;
@@ -327,6 +335,7 @@ namespace task_thread_pool {
                 tasks_lock.unlock();
 
                 try {
+                    TASK_THREAD_POOL_TRACE_SCOPE("pool task");
                     task();
                 } catch (...) {
                     // std::packaged_task::operator() may throw in some error conditions, such as if the task
@@ -0,0 +1,198 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#pragma once
+
+/**
+ * Pipeline tracer. Define FMM_TRACE before including fast_matrix_market to record when each chunk is read,
+ * counted, parsed, formatted and written, on which thread, and where the main thread waits on workers.
+ * Without FMM_TRACE the trace macros expand to nothing.
+ *
+ * Each thread records events into its own ring buffer, so the oldest events are dropped on long runs. The buffer of
+ * an exited thread is reused by the next new thread, so there are only as many buffers as threads that ran at once.
+ * Call trace::dump_chrome_trace() while no reads or writes are running to get Chrome Trace Event JSON,
+ * viewable in chrome://tracing or https://ui.perfetto.dev.
+ */
+
+#ifdef FMM_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace fast_matrix_market {
+    namespace trace {
+        /**
+         * Events kept per thread.
+         */
+        constexpr std::size_t kRingCapacity = 1U << 16U;
+
+        struct event {
+            const char* name;
+            int64_t begin_ns;
+            int64_t duration_ns;
+            int64_t arg;
+        };
+
+        class ring_buffer {
+        public:
+            explicit ring_buffer(int64_t tid) : tid(tid), events(kRingCapacity) {}
+
+            void push(const event& e) {
+                auto n = count.load(std::memory_order_relaxed);
+                events[n % kRingCapacity] = e;
+                count.store(n + 1, std::memory_order_release);
+            }
+
+            const int64_t tid;
+            std::vector<event> events;
+            std::atomic<uint64_t> count{0};
+        };
+
+        class registry {
+        public:
+            static registry& get() {
+                static registry ret;
+                return ret;
+            }
+
+            ring_buffer* acquire() {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!free_buffers.empty()) {
+                    auto buffer = free_buffers.back();
+                    free_buffers.pop_back();
+                    return buffer;
+                }
+                buffers.push_back(std::make_unique<ring_buffer>((int64_t)buffers.size()));
+                return buffers.back().get();
+            }
+
+            void release(ring_buffer* buffer) {
+                std::lock_guard<std::mutex> lock(mutex);
+                free_buffers.push_back(buffer);
+            }
+
+            std::mutex mutex;
+            // Buffers keep their events after their thread exits, such as when a thread pool is destroyed.
+            // A later thread then appends to the same buffer, so its tid is a lane rather than an OS thread.
+            std::vector<std::unique_ptr<ring_buffer>> buffers;
+            std::vector<ring_buffer*> free_buffers;
+            const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        };
+
+        /**
+         * Holds a thread's buffer, and returns it to the registry when the thread exits.
+         */
+        class thread_lease {
+        public:
+            thread_lease() : buffer(registry::get().acquire()) {}
+            ~thread_lease() { registry::get().release(buffer); }
+
+            thread_lease(const thread_lease&) = delete;
+            thread_lease& operator=(const thread_lease&) = delete;
+
+            ring_buffer* const buffer;
+        };
+
+        inline ring_buffer& thread_buffer() {
+            thread_local thread_lease lease;
+            return *lease.buffer;
+        }
+
+        /**
+         * Write a nanosecond count as microseconds with a three-digit fraction, so no precision is lost.
+         */
+        inline void write_microseconds(std::ostream& os, int64_t ns) {
+            os << ns / 1000 << '.'
+               << (char)('0' + ns % 1000 / 100) << (char)('0' + ns % 100 / 10) << (char)('0' + ns % 10);
+        }
+
+        inline int64_t now_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - registry::get().epoch).count();
+        }
+
+        /**
+         * Records an event spanning its lifetime.
+         */
+        class scope {
+        public:
+            explicit scope(const char* name, int64_t arg = -1) : name(name), arg(arg), begin_ns(now_ns()) {}
+
+            ~scope() {
+                thread_buffer().push(event{name, begin_ns, now_ns() - begin_ns, arg});
+            }
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+
+        protected:
+            const char* name;
+            int64_t arg;
+            int64_t begin_ns;
+        };
+
+        /**
+         * Drop all recorded events.
+         */
+        inline void clear() {
+            auto& reg = registry::get();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (auto& buffer : reg.buffers) {
+                buffer->count.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * Write the recorded events as Chrome Trace Event JSON.
+         */
+        inline void dump_chrome_trace(std::ostream& os) {
+            auto& reg = registry::get();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+
+            os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            bool first = true;
+            for (const auto& buffer : reg.buffers) {
+                auto count = buffer->count.load(std::memory_order_acquire);
+                uint64_t begin = count > kRingCapacity ? count - kRingCapacity : 0;
+                for (auto i = begin; i < count; ++i) {
+                    const event& e = buffer->events[i % kRingCapacity];
+                    os << (first ? "\n" : ",\n");
+                    first = false;
+                    // timestamps are in microseconds
+                    os << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+                    write_microseconds(os, e.begin_ns);
+                    os << ",\"dur\":";
+                    write_microseconds(os, e.duration_ns);
+                    if (e.arg >= 0) {
+                        os << ",\"args\":{\"chunk\":" << e.arg << "}";
+                    }
+                    os << "}";
+                }
+            }
+            os << "\n]}\n";
+        }
+    }
+}
+
+#define FMM_TRACE_CONCAT_INNER(a, b) a##b
+#define FMM_TRACE_CONCAT(a, b) FMM_TRACE_CONCAT_INNER(a, b)
+
+/**
+ * Record an event named `name` (a string literal) that lasts until the end of the enclosing scope.
+ * `arg` is the chunk number, or -1.
+ */
+#define FMM_TRACE_SCOPE(name, arg) ::fast_matrix_market::trace::scope FMM_TRACE_CONCAT(fmm_trace_scope_, __LINE__)(name, arg)
+
+// Hook into the thread pool. Must be defined before task_thread_pool.hpp is included.
+#define TASK_THREAD_POOL_TRACE_SCOPE(name) FMM_TRACE_SCOPE(name, -1)
+
+#else
+
+#define FMM_TRACE_SCOPE(name, arg)
+
+#endif
@@ -8,6 +8,7 @@
 #include <map>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace fast_matrix_market {
 
@@ -71,6 +72,24 @@ namespace fast_matrix_market {
         int64_t header_line_count = 1;
     };
 
+    /**
+     * CRC32C checksum of a Matrix Market body, i.e. of every byte after the header.
+     */
+    struct body_checksum {
+        uint32_t crc32c = 0;
+        int64_t num_bytes = 0;
+
+        /**
+         * Checksum of a byte range of the body. Optional, to localize corruption.
+         */
+        struct range {
+            int64_t offset;
+            int64_t num_bytes;
+            uint32_t crc32c;
+        };
+        std::vector<range> ranges;
+    };
+
     enum storage_order {row_major = 1, col_major = 2};
     enum out_of_range_behavior {BestMatch = 1, ThrowOutOfRange = 2};
 
@@ -96,6 +115,25 @@ namespace fast_matrix_market {
          */
         bool generalize_symmetry_app = true;
 
+        /**
+         * If true, read only the sparsity structure, as if the file were a `pattern` file. Value tokens are skipped
+         * without being parsed, and the value vector is left empty.
+         *
+         * Only the triplet readers (read_matrix_market_triplet() and read_matrix_market_body_triplet()) honor this.
+         * Bindings that build a matrix from values, such as Blaze, Armadillo, BSR and SELL, ignore it.
+         */
+        bool structure_only = false;
+
+        /**
+         * Optional row and column permutations applied as indices are parsed, before the parse handler sees them.
+         * If not null, row `i` (zero-based) of the file is delivered as row `row_permutation[i]`, and likewise for
+         * columns. The arrays must have `nrows` and `ncols` entries and stay alive during the read.
+         * Symmetry generalization mirrors elements in file coordinates, so the result is the permuted full matrix.
+         * For vectors only `row_permutation` is used.
+         */
+        const int64_t* row_permutation = nullptr;
+        const int64_t* col_permutation = nullptr;
+
         /**
          * Generalize Symmetry:
          * How to handle a value on the diagonal of a symmetric coordinate matrix.
@@ -120,6 +158,13 @@ namespace fast_matrix_market {
          */
         int num_threads = 0;
 
+        /**
+         * Limit on the total size of chunks that have been read but not yet parsed, in bytes.
+         * The reader stops reading ahead once this is reached. At least one chunk is always in flight.
+         * 0 means no byte limit, only the chunk-count limit of num_threads + 1 chunks.
+         */
+        int64_t max_inflight_bytes = 1LL << 30;
+
         /**
          * How to handle floating-point values that do not fit into their declared type.
          * For example, parsing 1e9999 will
@@ -127,6 +172,12 @@ namespace fast_matrix_market {
          *  - ThrowOutOfRange: throw out_of_range exception
          */
         out_of_range_behavior float_out_of_range_behavior = BestMatch;
+
+        /**
+         * If not null, the CRC32C of the body is computed by the parse workers and compared with this checksum
+         * after the body is read. A mismatch throws checksum_error.
+         */
+        const body_checksum* expected_checksum = nullptr;
     };
 
     struct write_options {
@@ -142,6 +193,13 @@ namespace fast_matrix_market {
          */
         int num_threads = 0;
 
+        /**
+         * Limit on the total size of chunks that have been formatted but not yet written, in bytes.
+         * No new chunks are started once this is reached. At least one chunk is always in flight.
+         * 0 means no byte limit, only the chunk-count limit of 2 * num_threads chunks.
+         */
+        int64_t max_inflight_bytes = 1LL << 30;
+
         /**
          * Floating-point formatting precision.
          * Placeholder. Currently not used due to the various supported float rendering backends.
@@ -164,6 +222,22 @@ namespace fast_matrix_market {
          *  - Writing integer structures as real
          */
         bool fill_header_field_type = true;
+
+        /**
+         * Optional row and column permutations applied while formatting coordinate output.
+         * If not null, row `i` is written as row `row_permutation[i]`, and likewise for columns.
+         * The arrays must have `nrows` and `ncols` entries. Not supported for array output.
+         */
+        const int64_t* row_permutation = nullptr;
+        const int64_t* col_permutation = nullptr;
+
+        /**
+         * If not null, the CRC32C of the body is computed by the formatting workers and stored here, such as to
+         * save in a sidecar with write_checksum_sidecar().
+         * If `checksum_ranges` is true then the checksum of each written chunk is also recorded.
+         */
+        body_checksum* checksum = nullptr;
+        bool checksum_ranges = false;
     };
 
     template<class T> struct is_complex : std::false_type {};
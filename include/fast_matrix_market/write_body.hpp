@@ -47,28 +47,53 @@ namespace fast_matrix_market {
      * Chunks are computed and written sequentially.
      */
     template <typename FORMATTER>
-    void write_body_sequential(std::ostream& os,
+    void write_body_sequential(byte_sink& sink,
                                FORMATTER& formatter, const write_options& options = {}) {
 
+        checksum_accumulator checksum(options.checksum_ranges);
+
         while (formatter.has_next()) {
             std::string chunk = formatter.next_chunk(options)();
+            if (options.checksum) {
+                checksum.add(crc32c(chunk), (int64_t)chunk.size());
+            }
+
+            sink.write(chunk.data(), chunk.size());
+        }
 
-            os.write(chunk.c_str(), (std::streamsize)chunk.size());
+        if (options.checksum) {
+            *options.checksum = std::move(checksum.result);
         }
     }
 
+    template <typename FORMATTER>
+    void write_body_sequential(std::ostream& os,
+                               FORMATTER& formatter, const write_options& options = {}) {
+        ostream_sink sink(os);
+        write_body_sequential(sink, formatter, options);
+    }
+
     /**
      * Write Matrix Market body.
      *
+     * The body is written to a byte_sink, so any transport can be plugged in. See byte_io.hpp.
+     *
      * @tparam FORMATTER implementation class that writes chunks.
      */
     template <typename FORMATTER>
-    void write_body(std::ostream& os,
+    void write_body(byte_sink& sink,
                     FORMATTER& formatter, const write_options& options = {}) {
         if (options.parallel_ok && options.num_threads != 1) {
-            write_body_threads(os, formatter, options);
+            write_body_threads(sink, formatter, options);
             return;
         }
-        write_body_sequential(os, formatter, options);
+        write_body_sequential(sink, formatter, options);
+    }
+
+    template <typename FORMATTER>
+    void write_body(std::ostream& os,
+                    FORMATTER& formatter, const write_options& options = {}) {
+        ostream_sink sink(os);
+        write_body(sink, formatter, options);
     }
 }
\ No newline at end of file
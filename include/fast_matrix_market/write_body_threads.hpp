@@ -4,12 +4,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <queue>
 
 #include "fast_matrix_market.hpp"
+#include "task_completion_tracker.hpp"
 #include "thirdparty/task_thread_pool.hpp"
 
 namespace fast_matrix_market {
+    /**
+     * A formatted chunk and its CRC32C, if requested.
+     */
+    struct formatted_chunk {
+        std::string chunk;
+        uint32_t crc32c = 0;
+    };
+
     /**
      * Write Matrix Market body.
      *
@@ -17,7 +28,7 @@ namespace fast_matrix_market {
      * @tparam FORMATTER implementation class that writes chunks.
      */
     template <typename FORMATTER>
-    void write_body_threads(std::ostream& os,
+    void write_body_threads(byte_sink& sink,
                             FORMATTER& formatter, const write_options& options = {}) {
         /*
          * Requirements:
@@ -31,35 +42,140 @@ namespace fast_matrix_market {
          * The biggest obstacle is the final requirement to write all chunks sequentially.
          *
          * We take a simple approach. The main thread handles the serial chunk generation and I/O,
-         * and a thread pool performs the parallel work.
+         * and a thread pool performs the parallel work. Chunks that finish out of order are held until all
+         * chunks before them have been written.
          */
-        std::queue<std::future<std::string>> futures;
-        task_thread_pool::task_thread_pool pool(options.num_threads);
+        using CHUNK = decltype(formatter.next_chunk(options));
+        std::queue<std::future<formatted_chunk>> futures;
+        checksum_accumulator checksum(options.checksum_ranges);
 
-        // Number of concurrent chunks available to work on.
+        unsigned num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+        num_threads = std::max(num_threads, 1u);
+
+        // Create the first batch of chunks before starting the pool.
+        // Chunk creation is cheap, and knowing how many chunks there are avoids starting idle threads.
+        std::queue<CHUNK> seed_chunks;
+        while (seed_chunks.size() < 2 * num_threads && formatter.has_next()) {
+            seed_chunks.push(formatter.next_chunk(options));
+        }
+
+        if (!formatter.has_next()) {
+            if (seed_chunks.size() <= 1) {
+                // Small enough to not need any parallelism.
+                for (; !seed_chunks.empty(); seed_chunks.pop()) {
+                    std::string chunk = seed_chunks.front()();
+                    if (options.checksum) {
+                        checksum.add(crc32c(chunk), (int64_t)chunk.size());
+                    }
+                    sink.write(chunk.data(), chunk.size());
+                }
+                if (options.checksum) {
+                    *options.checksum = std::move(checksum.result);
+                }
+                return;
+            }
+            num_threads = std::min(num_threads, (unsigned)seed_chunks.size());
+        }
+
+        // Total size of chunks that have been formatted but not yet written.
+        // Declared before the pool so that it outlives any running tasks.
+        std::atomic<int64_t> inflight_bytes{0};
+        const bool compute_checksum = options.checksum != nullptr;
+        auto format_chunk = [&inflight_bytes, compute_checksum]([[maybe_unused]] int64_t chunk_num, auto chunk) {
+            FMM_TRACE_SCOPE("format", chunk_num);
+            formatted_chunk ret{chunk(), 0};
+            if (compute_checksum) {
+                // computed by the worker, so checksums cost no extra time on the writing thread
+                ret.crc32c = crc32c(ret.chunk);
+            }
+            inflight_bytes += (int64_t)ret.chunk.size();
+            return ret;
+        };
+        task_completion_tracker tracker;
+
+        // Chunk numbers identify chunks in traces.
+        int64_t num_chunks_started = 0;
+        int64_t num_chunks_written = 0;
+
+        task_thread_pool::task_thread_pool pool(num_threads);
+
+        // Number of chunks being formatted at once.
         // Too few may starve workers (such as due to uneven chunk splits)
         // Too many increases costs, such as storing chunk results in memory before they're written.
-        const int inflight_count = 2 * (int)pool.get_num_threads();
+        const int64_t running_count = 2 * (int64_t)pool.get_num_threads();
+
+        // Formatted chunks wait their turn to be written in the futures queue. The queue acts as a reorder buffer
+        // whose size is limited by the byte budget, not by a chunk count. This way a single slow chunk does not
+        // stall the workers. Without a byte budget the queue is limited to running_count chunks instead.
+        auto can_start_chunk = [&]() {
+            if (futures.empty()) {
+                return true;
+            }
+            if (tracker.get_num_running() >= running_count) {
+                return false;
+            }
+            if (options.max_inflight_bytes <= 0) {
+                return (int64_t)futures.size() < running_count;
+            }
+            return inflight_bytes < options.max_inflight_bytes;
+        };
 
         // Start computing tasks.
-        for (int batch_i = 0; batch_i < inflight_count && formatter.has_next(); ++batch_i) {
-            // Could push the chunk directly, but MSVC.
-            futures.push(pool.submit([](auto chunk){ return chunk(); }, formatter.next_chunk(options)));
-//            futures.push(pool.submit(formatter.next_chunk(options)));
+        for (; !seed_chunks.empty(); seed_chunks.pop()) {
+            futures.push(tracker.submit(pool, format_chunk, num_chunks_started++, seed_chunks.front()));
         }
 
         // Write chunks in order as they become available.
         while (!futures.empty()) {
-            std::string chunk = futures.front().get();
+            // While the next chunk to write is still being formatted, keep the workers busy with later chunks.
+            while (true) {
+                auto seen_completed = tracker.get_num_completed();
+                if (is_ready(futures.front())) {
+                    break;
+                }
+
+                if (formatter.has_next() && can_start_chunk()) {
+                    futures.push(tracker.submit(pool, format_chunk, num_chunks_started++, formatter.next_chunk(options)));
+                } else if (tracker.get_num_running() == 0) {
+                    // Chunk is done but its future is not yet ready.
+                    FMM_TRACE_SCOPE("wait format", num_chunks_written);
+                    futures.front().wait();
+                } else {
+                    FMM_TRACE_SCOPE("wait format", num_chunks_written);
+                    tracker.wait_for_completion(seen_completed);
+                }
+            }
+
+            formatted_chunk formatted = futures.front().get();
             futures.pop();
+            const std::string& chunk = formatted.chunk;
+            if (compute_checksum) {
+                checksum.add(formatted.crc32c, (int64_t)chunk.size());
+            }
 
-            // Next chunk is ready. Start another to replace it.
-            if (formatter.has_next()) {
-                futures.push(pool.submit([](auto chunk){ return chunk(); }, formatter.next_chunk(options)));
+            // Next chunk is ready. Start others to replace it, if the budget allows.
+            while (formatter.has_next() && can_start_chunk()) {
+                futures.push(tracker.submit(pool, format_chunk, num_chunks_started++, formatter.next_chunk(options)));
             }
 
             // Write this one out.
-            os.write(chunk.c_str(), (std::streamsize) chunk.size());
+            {
+                FMM_TRACE_SCOPE("write", num_chunks_written);
+                sink.write(chunk.data(), chunk.size());
+            }
+            inflight_bytes -= (int64_t)chunk.size();
+            ++num_chunks_written;
         }
+
+        if (compute_checksum) {
+            *options.checksum = std::move(checksum.result);
+        }
+    }
+
+    template <typename FORMATTER>
+    void write_body_threads(std::ostream& os,
+                            FORMATTER& formatter, const write_options& options = {}) {
+        ostream_sink sink(os);
+        write_body_threads(sink, formatter, options);
     }
 }
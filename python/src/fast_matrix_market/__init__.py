@@ -128,7 +128,7 @@ def _read_body_array(cursor, long_type):
     return vals
 
 
-def _read_body_coo(cursor, long_type, generalize_symmetry=True):
+def _read_body_coo(cursor, long_type, generalize_symmetry=True, values=True):
     import numpy as np
 
     index_dtype = "int32"
@@ -138,6 +138,17 @@ def _read_body_coo(cursor, long_type, generalize_symmetry=True):
 
     i = np.zeros(cursor.header.nnz, dtype=index_dtype)
     j = np.zeros(cursor.header.nnz, dtype=index_dtype)
+
+    if not values:
+        # Structure only. Value tokens are skipped without being parsed.
+        _fmm_core.read_body_coo_structure(cursor, i, j)
+
+        if generalize_symmetry and cursor.header.symmetry != "general":
+            off_diagonal_mask = (i != j)
+            i, j = np.concatenate((i, j[off_diagonal_mask])), np.concatenate((j, i[off_diagonal_mask]))
+
+        return (None, (i, j)), cursor.header.shape
+
     data = np.zeros(cursor.header.nnz, dtype=_field_to_dtype.get(("long-" if long_type else "")+cursor.header.field))
 
     _fmm_core.read_body_coo(cursor, i, j, data)
@@ -341,7 +352,7 @@ def write_array(target, a, comment=None, parallelism=None):
     _fmm_core.write_body_array(cursor, a)
 
 
-def read_coo(source, parallelism=None, long_type=False, generalize_symmetry=True):
+def read_coo(source, parallelism=None, long_type=False, generalize_symmetry=True, values=True):
     """
     Read MatrixMarket file to a (data, (i, j)) triplet, regardless if the file is sparse or dense.
 
@@ -349,11 +360,14 @@ def read_coo(source, parallelism=None, long_type=False, generalize_symmetry=True
     :param parallelism: number of threads to use. 0 means auto.
     :param long_type: Whether to use 'longdouble' and 'longcomplex' extended-precision floating-point number types.
     :param generalize_symmetry: if the MatrixMarket file specifies a symmetry, emit the symmetric entries too.
+    :param values: if False, read only the sparsity structure. Values are skipped without being parsed and
+                   `data` is None.
     :return: (data, (row_indices, column_indices)) (same as scipy.io.mmread)
     """
     cursor, stream_to_close = _get_read_cursor(source, parallelism)
     (data, (rows, cols)), shape = _read_body_coo(cursor,
-                                                 long_type=long_type, generalize_symmetry=generalize_symmetry)
+                                                 long_type=long_type, generalize_symmetry=generalize_symmetry,
+                                                 values=values)
     if stream_to_close:
         stream_to_close.close()
     return (data, (rows, cols)), shape
@@ -28,8 +28,30 @@ void read_body_coo(read_cursor& cursor, py::array_t<IT>& row, py::array_t<IT>& c
     cursor.close();
 }
 
+/**
+ * Read Matrix Market body into row and column arrays only. Values are skipped without being parsed.
+ */
+template <typename IT>
+void read_body_coo_structure(read_cursor& cursor, py::array_t<IT>& row, py::array_t<IT>& col) {
+    if (row.size() != cursor.header.nnz || col.size() != cursor.header.nnz) {
+        throw std::invalid_argument("NumPy Array sizes need to equal matrix nnz");
+    }
+    auto row_unchecked = row.mutable_unchecked();
+    auto col_unchecked = col.mutable_unchecked();
+    auto handler = fmm::triplet_calling_pattern_parse_handler<IT, decltype(row_unchecked)>(row_unchecked, col_unchecked);
+
+#ifdef FMM_SCIPY_PRUNE
+    fmm::read_matrix_market_body_no_adapters<decltype(handler), fmm::compile_coordinate_only>(cursor.stream(), cursor.header, handler, cursor.options);
+#else
+    fmm::read_matrix_market_body_no_adapters<decltype(handler), fmm::compile_all>(cursor.stream(), cursor.header, handler, cursor.options);
+#endif
+    cursor.close();
+}
 
 void init_read_coo(py::module_ &m) {
+    m.def("read_body_coo_structure", &read_body_coo_structure<int32_t>);
+    m.def("read_body_coo_structure", &read_body_coo_structure<int64_t>);
+
     m.def("read_body_coo", &read_body_coo<int32_t, int64_t>);
     m.def("read_body_coo", &read_body_coo<int32_t, uint64_t>);
     m.def("read_body_coo", &read_body_coo<int32_t, double>);
@@ -96,6 +96,23 @@ class TestTriplet(unittest.TestCase):
                 fmm_scipy2 = scipy.sparse.coo_matrix(triplet2, shape=shape2)
                 self.assertMatrixEqual(fmm_scipy, fmm_scipy2)
 
+    def test_read_structure(self):
+        for mtx in sorted(list(matrices.glob("*.mtx*"))):
+            if str(mtx).endswith(".bz2") and bz2 is None:
+                continue
+            mtx_header = fmm.read_header(mtx)
+            if mtx_header.format != "coordinate":
+                continue
+
+            with self.subTest(msg=mtx.stem):
+                (data, (rows, cols)), shape = fmm.read_coo(mtx)
+                (no_data, (s_rows, s_cols)), s_shape = fmm.read_coo(mtx, values=False)
+
+                self.assertIsNone(no_data)
+                self.assertEqual(shape, s_shape)
+                np.testing.assert_array_equal(rows, s_rows)
+                np.testing.assert_array_equal(cols, s_cols)
+
     def test_list(self):
         i = [0, 1, 2]
         j = [0, 1, 2]
@@ -0,0 +1,13 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+// Explicit instantiation definitions for the declarations in extern_templates.hpp.
+
+#define FMM_EXTERN
+
+#ifndef FMM_EXTERN_TEMPLATES
+#define FMM_EXTERN_TEMPLATES
+#endif
+
+#include <fast_matrix_market/fast_matrix_market.hpp>
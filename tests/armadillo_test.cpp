@@ -132,3 +132,20 @@ TEST(ArmadilloTest, Symmetric) {
     EXPECT_EQ(expected.n_nonzero, sym.n_nonzero);
     EXPECT_TRUE(arma::approx_equal(expected, sym, "absdiff", 1e-6));
 }
+
+TEST(ArmadilloTest, StructureOnlyIgnored) {
+    arma::SpMat<double> mat, expected;
+    fast_matrix_market::read_options options;
+    options.structure_only = true;
+
+    {
+        std::ifstream f(kTestMatrixDir + "symmetry/coordinate_symmetric_row_general.mtx");
+        fast_matrix_market::read_matrix_market_arma(f, mat, options);
+    }
+    {
+        std::ifstream f(kTestMatrixDir + "symmetry/coordinate_symmetric_row_general.mtx");
+        fast_matrix_market::read_matrix_market_arma(f, expected);
+    }
+    EXPECT_GT(mat.n_nonzero, 0);
+    EXPECT_TRUE(arma::approx_equal(expected, mat, "absdiff", 1e-6));
+}
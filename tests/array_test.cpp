@@ -108,3 +108,61 @@ TEST(ArrayTest, BoolRaceConditions) {
         EXPECT_EQ(array, array2);
     }
 }
+
+TEST(ArrayTest, Strided) {
+    using Mat = array_matrix<double>;
+
+    Mat mat;
+    construct_array(mat, 200);
+    std::string mtx = write_mtx(mat, fast_matrix_market::write_options{});
+
+    const double sentinel = -1;
+    const int64_t row_offset = 3;
+    const int64_t col_offset = 2;
+
+    for (auto order : {fast_matrix_market::row_major, fast_matrix_market::col_major}) {
+        for (int p : {1, 4}) {
+            fast_matrix_market::read_options roptions;
+            roptions.chunk_size_bytes = 16;
+            roptions.num_threads = p;
+
+            const int64_t minor = (order == fast_matrix_market::row_major ? col_offset + mat.ncols : row_offset + mat.nrows);
+            const int64_t major = (order == fast_matrix_market::row_major ? row_offset + mat.nrows : col_offset + mat.ncols);
+            const int64_t ld = fast_matrix_market::get_aligned_leading_dimension<double>(minor);
+            EXPECT_GE(ld, minor);
+            EXPECT_EQ((ld * (int64_t)sizeof(double)) % 64, 0);
+
+            std::vector<double> buffer(ld * major, sentinel);
+
+            std::istringstream iss(mtx);
+            fast_matrix_market::matrix_market_header header;
+            fast_matrix_market::read_matrix_market_array_strided(iss, header, buffer.data(), ld, order,
+                                                                 row_offset, col_offset, roptions);
+            EXPECT_EQ(header.nrows, mat.nrows);
+            EXPECT_EQ(header.ncols, mat.ncols);
+
+            int64_t num_in_block = 0;
+            for (int64_t i = 0; i < major; ++i) {
+                for (int64_t j = 0; j < ld; ++j) {
+                    int64_t row = (order == fast_matrix_market::row_major ? i : j) - row_offset;
+                    int64_t col = (order == fast_matrix_market::row_major ? j : i) - col_offset;
+                    double v = buffer[i * ld + j];
+                    if (row >= 0 && row < mat.nrows && col >= 0 && col < mat.ncols) {
+                        EXPECT_EQ(v, mat.vals[row * mat.ncols + col]);
+                        ++num_in_block;
+                    } else {
+                        EXPECT_EQ(v, sentinel);
+                    }
+                }
+            }
+            EXPECT_EQ(num_in_block, mat.nrows * mat.ncols);
+        }
+    }
+
+    // leading dimension too small
+    std::vector<double> buffer(1000);
+    std::istringstream iss(mtx);
+    fast_matrix_market::matrix_market_header header;
+    EXPECT_THROW(fast_matrix_market::read_matrix_market_array_strided(iss, header, buffer.data(), 1),
+                 fast_matrix_market::invalid_argument);
+}
@@ -5,6 +5,7 @@
 #include <filesystem>
 #include <fstream>
 #include <regex>
+#include <thread>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -220,6 +221,71 @@ TEST_P(InvalidSuite, Small) {
 
 INSTANTIATE_TEST_SUITE_P(Invalid, InvalidSuite, testing::ValuesIn(InvalidSuite::get_invalid_matrix_files()));
 
+TEST(InvalidSuite, FirstErrorReported) {
+    // Parallel reads must report the error that appears first in the file, regardless of which chunk
+    // finishes parsing first.
+    std::string mtx = "%%MatrixMarket matrix coordinate real general\n1000 1000 1000\n";
+    for (int i = 1; i <= 1000; ++i) {
+        if (i == 100 || i == 900) {
+            mtx += "x y z\n";
+        } else {
+            mtx += std::to_string(i) + " " + std::to_string(i) + " 1.5\n";
+        }
+    }
+
+    fast_matrix_market::read_options options{};
+    options.chunk_size_bytes = 50;
+    options.num_threads = 4;
+
+    for (int rep = 0; rep < 20; ++rep) {
+        std::istringstream iss(mtx);
+        triplet_matrix<int64_t, double> triplet;
+        try {
+            fast_matrix_market::read_matrix_market_triplet(iss, triplet.nrows, triplet.ncols,
+                                                           triplet.rows, triplet.cols, triplet.vals, options);
+            FAIL() << "Expected invalid_mm";
+        } catch (const fast_matrix_market::invalid_mm& e) {
+            EXPECT_EQ(std::string(e.what()).rfind("Line 102:", 0), 0) << e.what();
+        }
+    }
+}
+
+TEST(InvalidSuite, ErrorLineNumbers) {
+    // Line numbers are recovered after the fact, so they must account for blank lines and chunk boundaries.
+    std::string coo = "%%MatrixMarket matrix coordinate real general\n10 10 10\n";
+    std::string arr = "%%MatrixMarket matrix array real general\n5 2\n";
+    for (int i = 1; i <= 10; ++i) {
+        if (i % 3 == 0) {
+            coo += "\n";
+            arr += "  \n";
+        }
+        coo += (i == 8 ? std::string("x y z") : std::to_string(i) + " " + std::to_string(i) + " 1.5") + "\n";
+        arr += (i == 8 ? std::string("z") : std::string("1.5")) + "\n";
+    }
+    // header is 2 lines, element 8 is preceded by two blank lines
+    const std::string expected = "Line 12:";
+
+    for (const auto& mtx : {coo, arr}) {
+        for (int chunk_size : {1, 13, 1 << 20}) {
+            for (int p : {1, 4}) {
+                fast_matrix_market::read_options options{};
+                options.chunk_size_bytes = chunk_size;
+                options.num_threads = p;
+
+                std::istringstream iss(mtx);
+                triplet_matrix<int64_t, double> triplet;
+                try {
+                    fast_matrix_market::read_matrix_market_triplet(iss, triplet.nrows, triplet.ncols,
+                                                                   triplet.rows, triplet.cols, triplet.vals, options);
+                    FAIL() << "Expected invalid_mm";
+                } catch (const fast_matrix_market::invalid_mm& e) {
+                    EXPECT_EQ(std::string(e.what()).rfind(expected, 0), 0) << e.what();
+                }
+            }
+        }
+    }
+}
+
 /**
  * Permissive matrices
  *
@@ -712,6 +778,83 @@ TEST(Whitespace, Whitespace) {
     }
 }
 
+TEST(Formatter, ValueCache) {
+    fast_matrix_market::matrix_market_header header(10, 10);
+    fast_matrix_market::write_options options;
+
+    // low cardinality first, including values that compare equal but format differently, then many distinct values
+    std::vector<double> values;
+    for (int i = 0; i < 50; ++i) {
+        values.push_back(i % 2 ? 1.0 : -1.0);
+        values.push_back(i % 3 ? 0.0 : -0.0);
+    }
+    for (int i = 0; i < 50; ++i) {
+        values.push_back(1.0 / (i + 3));
+        values.push_back(1.0);
+    }
+
+    fast_matrix_market::line_formatter<int64_t, double> lf(header, options);
+    std::string actual, expected;
+    for (auto v : values) {
+        lf.append_coord_matrix(actual, 1, 2, v);
+        expected += "2 3 " + fast_matrix_market::value_to_string(v, options.precision) + "\n";
+    }
+    EXPECT_EQ(actual, expected);
+
+    // iso path
+    fast_matrix_market::line_formatter<int64_t, double> iso_lf(header, options);
+    iso_lf.set_iso_value(0.5);
+    std::string half = fast_matrix_market::value_to_string(0.5, options.precision);
+    EXPECT_EQ(iso_lf.coord_matrix(0, 0, 0.5), "1 1 " + half + "\n");
+    EXPECT_EQ(iso_lf.coord_matrix(4, 0, 0.5), "5 1 " + half + "\n");
+}
+
+/**
+ * Formatter whose first chunk is slow. Records how many chunks had been created when the first one finished.
+ */
+class slow_first_chunk_formatter {
+public:
+    explicit slow_first_chunk_formatter(int64_t num_chunks) : num_chunks(num_chunks) {}
+
+    [[nodiscard]] bool has_next() const {
+        return num_created < num_chunks;
+    }
+
+    auto next_chunk([[maybe_unused]] const fast_matrix_market::write_options& options) {
+        int64_t chunk_num = num_created++;
+        return [this, chunk_num]() {
+            if (chunk_num == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                created_when_first_done = num_created.load();
+            }
+            return std::to_string(chunk_num) + "\n";
+        };
+    }
+
+    const int64_t num_chunks;
+    std::atomic<int64_t> num_created{0};
+    std::atomic<int64_t> created_when_first_done{0};
+};
+
+TEST(WritePipeline, ChunkLimitWithoutByteBudget) {
+    fast_matrix_market::write_options options;
+    options.num_threads = 2;
+    options.max_inflight_bytes = 0;
+
+    slow_first_chunk_formatter formatter(1000);
+    std::ostringstream oss;
+    fast_matrix_market::write_body_threads(oss, formatter, options);
+
+    std::string expected;
+    for (int64_t i = 0; i < 1000; ++i) {
+        expected += std::to_string(i) + "\n";
+    }
+    EXPECT_EQ(oss.str(), expected);
+
+    // While the first chunk blocks the writer, only the documented 2 * num_threads chunks may be pending.
+    EXPECT_LE(formatter.created_when_first_done.load(), 2 * options.num_threads);
+}
+
 TEST(Generator, Generator) {
     {
         // Generate a 3x3 identity matrix
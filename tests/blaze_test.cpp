@@ -202,6 +202,23 @@ TEST(BlazeMatrixTest, Symmetric) {
     EXPECT_TRUE(is_equal(sym, expected));
 }
 
+TEST(BlazeMatrixTest, StructureOnlyIgnored) {
+    blaze::CompressedMatrix<double, blaze::rowMajor> mat, expected;
+    fast_matrix_market::read_options options;
+    options.structure_only = true;
+
+    {
+        std::ifstream f(kTestMatrixDir + "symmetry/coordinate_symmetric_row_general.mtx");
+        fast_matrix_market::read_matrix_market_blaze(f, mat, options);
+    }
+    {
+        std::ifstream f(kTestMatrixDir + "symmetry/coordinate_symmetric_row_general.mtx");
+        fast_matrix_market::read_matrix_market_blaze(f, expected);
+    }
+    EXPECT_GT(mat.nonZeros(), 0);
+    EXPECT_TRUE(is_equal(mat, expected));
+}
+
 
 /////////////////////////////////////////////////////////
 ///// Vectors
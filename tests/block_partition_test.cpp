@@ -0,0 +1,111 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <set>
+#include <tuple>
+
+#include "fmm_tests.hpp"
+
+#include <fast_matrix_market/app/block_partition.hpp>
+
+using Mat = triplet_matrix<int64_t, double>;
+
+/**
+ * Emulate a P x Q process grid by reading every block in one process, then check each block against the
+ * corresponding entries of a plain read.
+ */
+void check_blocks(const std::string& mtx, const std::vector<int64_t>& row_splits,
+                  const std::vector<int64_t>& col_splits, int p) {
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 100;
+    options.num_threads = p;
+
+    Mat full;
+    {
+        std::istringstream iss(mtx);
+        fast_matrix_market::read_matrix_market_triplet(iss, full.nrows, full.ncols, full.rows, full.cols, full.vals,
+                                                       options);
+    }
+
+    std::istringstream iss(mtx);
+    fast_matrix_market::matrix_market_header header;
+    std::vector<std::vector<int64_t>> rows, cols;
+    std::vector<std::vector<double>> vals;
+    fast_matrix_market::read_matrix_market_triplet_blocks(iss, header, row_splits, col_splits, rows, cols, vals,
+                                                          options);
+
+    auto num_col_parts = (int64_t)col_splits.size() - 1;
+    ASSERT_EQ((int64_t)rows.size(), ((int64_t)row_splits.size() - 1) * num_col_parts);
+
+    std::size_t total = 0;
+    for (std::size_t pr = 0; pr + 1 < row_splits.size(); ++pr) {
+        for (std::size_t pc = 0; pc + 1 < col_splits.size(); ++pc) {
+            auto block = pr * num_col_parts + pc;
+
+            std::multiset<std::tuple<int64_t, int64_t, double>> expected, actual;
+            for (std::size_t i = 0; i < full.rows.size(); ++i) {
+                if (full.rows[i] >= row_splits[pr] && full.rows[i] < row_splits[pr + 1] &&
+                    full.cols[i] >= col_splits[pc] && full.cols[i] < col_splits[pc + 1]) {
+                    expected.emplace(full.rows[i] - row_splits[pr], full.cols[i] - col_splits[pc], full.vals[i]);
+                }
+            }
+            ASSERT_EQ(rows[block].size(), vals[block].size());
+            for (std::size_t i = 0; i < rows[block].size(); ++i) {
+                actual.emplace(rows[block][i], cols[block][i], vals[block][i]);
+            }
+            EXPECT_EQ(actual, expected);
+            total += actual.size();
+        }
+    }
+    EXPECT_EQ(total, full.rows.size());
+}
+
+TEST(BlockPartition, General) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real general\n100 80 500\n";
+    for (int i = 0; i < 500; ++i) {
+        mtx += std::to_string(i % 100 + 1) + " " + std::to_string((i * 7) % 80 + 1) + " " + std::to_string(i) + "\n";
+    }
+
+    for (int p : {1, 4}) {
+        check_blocks(mtx, {0, 30, 31, 100}, {0, 40, 80}, p);
+        check_blocks(mtx, {0, 100}, {0, 80}, p);
+        // empty parts
+        check_blocks(mtx, {0, 0, 50, 50, 100}, {0, 10, 80, 80}, p);
+    }
+}
+
+TEST(BlockPartition, Symmetric) {
+    std::string mtx = "%%MatrixMarket matrix coordinate integer symmetric\n50 50 200\n";
+    for (int i = 0; i < 200; ++i) {
+        int row = i % 50 + 1;
+        mtx += std::to_string(row) + " " + std::to_string((i * 3) % row + 1) + " " + std::to_string(i) + "\n";
+    }
+
+    for (int p : {1, 4}) {
+        check_blocks(mtx, {0, 25, 50}, {0, 10, 25, 50}, p);
+    }
+}
+
+TEST(BlockPartition, InvalidSplits) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real general\n10 10 1\n1 1 1\n";
+    for (const std::vector<int64_t>& splits : std::vector<std::vector<int64_t>>{{0}, {1, 10}, {0, 9}, {0, 6, 5, 10}}) {
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        std::vector<std::vector<int64_t>> rows, cols;
+        std::vector<std::vector<double>> vals;
+        EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet_blocks(iss, header, splits, {0, 10},
+                                                                           rows, cols, vals),
+                     fast_matrix_market::invalid_argument);
+    }
+}
+
+TEST(BlockPartition, SplitterFromTemporary) {
+    // the splitter keeps its own copy of the splits
+    fast_matrix_market::index_splitter splitter({0, 10, 20, 30}, 30);
+    EXPECT_EQ(splitter.num_parts(), 3);
+    EXPECT_EQ(splitter.part_of(0), 0);
+    EXPECT_EQ(splitter.part_of(15), 1);
+    EXPECT_EQ(splitter.part_of(29), 2);
+    EXPECT_EQ(splitter.part_start(2), 20);
+}
@@ -0,0 +1,146 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <tuple>
+
+#include "fmm_tests.hpp"
+
+#include <fast_matrix_market/app/bsr.hpp>
+
+using Mat = triplet_matrix<int64_t, double>;
+
+struct bsr_matrix {
+    int64_t block_size = 0;
+    std::vector<int64_t> indptr, indices;
+    std::vector<double> vals;
+};
+
+/**
+ * Block tridiagonal matrix with dense k x k blocks. Block (i, j) holds values 1000 * i + 100 * j + (r * k + c).
+ */
+Mat generate_block_matrix(int64_t num_block_rows, int64_t k) {
+    Mat mat;
+    mat.nrows = num_block_rows * k;
+    mat.ncols = num_block_rows * k;
+    // write in a scrambled order
+    for (int64_t c = k - 1; c >= 0; --c) {
+        for (int64_t i = 0; i < num_block_rows; ++i) {
+            for (int64_t j = std::max(i - 1, (int64_t)0); j <= std::min(i + 1, num_block_rows - 1); ++j) {
+                for (int64_t r = 0; r < k; ++r) {
+                    mat.rows.push_back(i * k + r);
+                    mat.cols.push_back(j * k + c);
+                    mat.vals.push_back((double)(1000 * i + 100 * j + r * k + c));
+                }
+            }
+        }
+    }
+    return mat;
+}
+
+std::string write_triplet(const Mat& mat) {
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals);
+    return oss.str();
+}
+
+bsr_matrix read_bsr(const std::string& mtx, int64_t block_size, int p) {
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 256;
+    options.num_threads = p;
+
+    std::istringstream iss(mtx);
+    fast_matrix_market::matrix_market_header header;
+    bsr_matrix bsr;
+    bsr.block_size = block_size;
+    fast_matrix_market::read_matrix_market_bsr(iss, header, bsr.block_size, bsr.indptr, bsr.indices, bsr.vals, options);
+    return bsr;
+}
+
+TEST(BSR, ReadBlocks) {
+    for (int64_t k : {3, 6}) {
+        Mat mat = generate_block_matrix(50, k);
+        std::string mtx = write_triplet(mat);
+
+        for (int p : {1, 4}) {
+            // detected
+            bsr_matrix bsr = read_bsr(mtx, 0, p);
+            EXPECT_EQ(bsr.block_size, k);
+            ASSERT_EQ(bsr.indptr.size(), 51);
+            EXPECT_EQ(bsr.indptr.back(), 50 * 3 - 2);
+            EXPECT_EQ((int64_t)bsr.vals.size(), bsr.indptr.back() * k * k);
+
+            for (int64_t i = 0; i < 50; ++i) {
+                for (int64_t block = bsr.indptr[i]; block < bsr.indptr[i + 1]; ++block) {
+                    int64_t j = bsr.indices[block];
+                    EXPECT_EQ(j, std::max(i - 1, (int64_t)0) + (block - bsr.indptr[i]));
+                    for (int64_t v = 0; v < k * k; ++v) {
+                        EXPECT_EQ(bsr.vals[block * k * k + v], (double)(1000 * i + 100 * j + v));
+                    }
+                }
+            }
+
+            // explicit block size of 1 is CSR
+            bsr_matrix csr = read_bsr(mtx, 1, p);
+            EXPECT_EQ(csr.block_size, 1);
+            EXPECT_EQ(csr.vals.size(), mat.vals.size());
+        }
+    }
+}
+
+TEST(BSR, Detect) {
+    // diagonal matrix does not have dense blocks
+    Mat diag;
+    diag.nrows = diag.ncols = 60;
+    for (int64_t i = 0; i < 60; ++i) {
+        diag.rows.push_back(i);
+        diag.cols.push_back(i);
+        diag.vals.push_back(1);
+    }
+    EXPECT_EQ(fast_matrix_market::detect_bsr_block_size(diag.rows, diag.cols, diag.nrows, diag.ncols), 1);
+
+    // block size must divide the dimensions
+    Mat mat = generate_block_matrix(10, 4);
+    EXPECT_EQ(fast_matrix_market::detect_bsr_block_size(mat.rows, mat.cols, mat.nrows, mat.ncols), 4);
+    EXPECT_THROW(read_bsr(write_triplet(mat), 3, 1), fast_matrix_market::invalid_argument);
+}
+
+TEST(BSR, Duplicates) {
+    std::string mtx = "%%MatrixMarket matrix coordinate integer general\n4 4 3\n1 1 1\n1 1 2\n4 3 5\n";
+    bsr_matrix bsr = read_bsr(mtx, 2, 1);
+    EXPECT_EQ(bsr.indptr, std::vector<int64_t>({0, 1, 2}));
+    EXPECT_EQ(bsr.indices, std::vector<int64_t>({0, 1}));
+    EXPECT_EQ(bsr.vals, std::vector<double>({3, 0, 0, 0, 0, 0, 5, 0}));
+}
+
+TEST(BSR, Write) {
+    Mat mat = generate_block_matrix(40, 3);
+    std::string mtx = write_triplet(mat);
+
+    for (int p : {1, 4}) {
+        bsr_matrix bsr = read_bsr(mtx, 0, p);
+
+        fast_matrix_market::write_options options;
+        options.chunk_size_values = 100;
+        options.num_threads = p;
+
+        std::ostringstream oss;
+        fast_matrix_market::write_matrix_market_bsr(oss, {mat.nrows, mat.ncols}, bsr.block_size,
+                                                    bsr.indptr, bsr.indices, bsr.vals, options);
+
+        Mat written;
+        std::istringstream iss(oss.str());
+        fast_matrix_market::read_matrix_market_triplet(iss, written.nrows, written.ncols, written.rows,
+                                                       written.cols, written.vals);
+
+        // same elements, written in row-major order
+        std::vector<std::tuple<int64_t, int64_t, double>> expected, actual;
+        for (std::size_t i = 0; i < mat.rows.size(); ++i) {
+            expected.emplace_back(mat.rows[i], mat.cols[i], mat.vals[i]);
+            actual.emplace_back(written.rows[i], written.cols[i], written.vals[i]);
+        }
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(actual, expected);
+        EXPECT_EQ(written.nrows, mat.nrows);
+    }
+}
@@ -0,0 +1,159 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "fmm_tests.hpp"
+
+using Mat = triplet_matrix<int64_t, double>;
+
+/**
+ * A source that only implements the required methods.
+ */
+class minimal_source : public fast_matrix_market::byte_source {
+public:
+    explicit minimal_source(std::string data) : data(std::move(data)) {}
+
+    std::size_t read(char* dest, std::size_t count) override {
+        count = std::min(count, data.size() - pos);
+        std::copy(data.begin() + (std::ptrdiff_t)pos, data.begin() + (std::ptrdiff_t)(pos + count), dest);
+        pos += count;
+        at_end = at_end || pos == data.size();
+        return count;
+    }
+
+    [[nodiscard]] bool good() const override {
+        return !at_end;
+    }
+
+protected:
+    std::string data;
+    std::size_t pos = 0;
+    bool at_end = false;
+};
+
+std::string generate_mtx(int64_t nnz, bool trailing_newline) {
+    // with empty lines
+    std::string mtx = generate_antidiagonal_mtx(nnz, 100);
+    if (!trailing_newline) {
+        mtx.pop_back();
+    }
+    return mtx;
+}
+
+Mat read_source(fast_matrix_market::byte_source& source, int p) {
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 1 << 10;
+    options.num_threads = p;
+
+    fast_matrix_market::matrix_market_header header;
+    fast_matrix_market::read_header(source, header);
+
+    Mat mat;
+    mat.nrows = header.nrows;
+    mat.ncols = header.ncols;
+    mat.rows.resize(header.nnz);
+    mat.cols.resize(header.nnz);
+    mat.vals.resize(header.nnz);
+    auto handler = fast_matrix_market::triplet_parse_handler(mat.rows.begin(), mat.cols.begin(), mat.vals.begin());
+    fast_matrix_market::read_matrix_market_body(source, header, handler, 1.0, options);
+    return mat;
+}
+
+Mat read_istream(const std::string& mtx) {
+    std::istringstream iss(mtx);
+    Mat mat;
+    fast_matrix_market::read_matrix_market_triplet(iss, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals);
+    return mat;
+}
+
+TEST(ByteIO, Read) {
+    for (bool trailing_newline : {true, false}) {
+        std::string mtx = generate_mtx(2000, trailing_newline);
+        Mat expected = read_istream(mtx);
+
+        for (int p : {1, 4}) {
+            {
+                fast_matrix_market::memory_source source(mtx);
+                EXPECT_EQ(read_source(source, p), expected);
+            }
+            {
+                minimal_source source(mtx);
+                EXPECT_EQ(read_source(source, p), expected);
+            }
+        }
+    }
+}
+
+TEST(ByteIO, MemorySource) {
+    std::string data = "12\n\n345\n67";
+    fast_matrix_market::memory_source source(data);
+
+    EXPECT_EQ(source.available(), 10);
+    EXPECT_EQ(source.borrow_lines(1), "12\n");
+    // extends to the end of the line
+    EXPECT_EQ(source.borrow_lines(2), "\n345\n");
+    // back to the start of "345"
+    ASSERT_TRUE(source.seek(4));
+    EXPECT_EQ(source.borrow_lines(3), "345\n");
+    EXPECT_TRUE(source.good());
+    EXPECT_EQ(source.borrow_lines(100), "67");
+    EXPECT_FALSE(source.good());
+
+    std::string line;
+    ASSERT_TRUE(source.seek(0));
+    EXPECT_TRUE(source.read_line(line));
+    EXPECT_EQ(line, "12");
+    EXPECT_EQ(source.tell(), 3);
+}
+
+TEST(ByteIO, Invalid) {
+    {
+        // error line numbers match the istream reader
+        std::string mtx = generate_mtx(2000, true);
+        mtx.replace(mtx.find("\n1500 "), 6, "\n1500x");
+        fast_matrix_market::memory_source source(mtx);
+        try {
+            read_source(source, 4);
+            FAIL();
+        } catch (const fast_matrix_market::invalid_mm& e) {
+            std::string message = e.what();
+            EXPECT_NE(message.find("Line 1532"), std::string::npos) << message;
+        }
+    }
+    {
+        std::string mtx = "%%MatrixMarket matrix coordinate real general\n";
+        fast_matrix_market::memory_source source(mtx);
+        fast_matrix_market::matrix_market_header header;
+        EXPECT_THROW(fast_matrix_market::read_header(source, header), fast_matrix_market::invalid_mm);
+    }
+}
+
+TEST(ByteIO, Write) {
+    Mat mat = read_istream(generate_mtx(2000, true));
+
+    fast_matrix_market::write_options options;
+    options.chunk_size_values = 100;
+
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, options);
+
+    for (bool parallel_ok : {false, true}) {
+        options.parallel_ok = parallel_ok;
+
+        fast_matrix_market::matrix_market_header header(mat.nrows, mat.ncols);
+        header.nnz = (int64_t)mat.rows.size();
+        header.field = fast_matrix_market::real;
+
+        std::string written;
+        fast_matrix_market::string_sink sink(written);
+        fast_matrix_market::write_header(sink, header, options);
+
+        fast_matrix_market::line_formatter<int64_t, double> lf(header, options);
+        auto formatter = fast_matrix_market::triplet_formatter(lf,
+                                                               mat.rows.cbegin(), mat.rows.cend(),
+                                                               mat.cols.cbegin(), mat.cols.cend(),
+                                                               mat.vals.cbegin(), mat.vals.cend());
+        fast_matrix_market::write_body(sink, formatter, options);
+        EXPECT_EQ(written, oss.str());
+    }
+}
@@ -83,3 +83,18 @@ TEST(LineCount, LineCount) {
     EXPECT_EQ(fast_matrix_market::count_lines("aa\n\n"), make_i64_pair(2, 1));
     EXPECT_EQ(fast_matrix_market::count_lines("aa\n\n\n"), make_i64_pair(3, 2));
 }
+
+TEST(BodySizeEstimate, BodySizeEstimate) {
+    fast_matrix_market::matrix_market_header header(1000, 1000);
+    header.nnz = 10;
+    header.field = fast_matrix_market::pattern;
+    EXPECT_EQ(fast_matrix_market::estimate_body_bytes(header), 10 * 10);
+
+    header.field = fast_matrix_market::real;
+    EXPECT_GT(fast_matrix_market::estimate_body_bytes(header), 10 * 10);
+
+    // stream knows how many bytes remain
+    std::string body(12345, ' ');
+    std::istringstream iss(body);
+    EXPECT_EQ(fast_matrix_market::estimate_body_bytes(iss, header), 12345);
+}
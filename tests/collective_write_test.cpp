@@ -0,0 +1,146 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <fast_matrix_market/app/collective_write.hpp>
+
+#include "fmm_tests.hpp"
+
+using TripletMat = triplet_matrix<int64_t, double>;
+
+static std::string read_file(const std::string& path) {
+    std::ifstream f(path);
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    return buffer.str();
+}
+
+static std::string write_triplet(const TripletMat& triplet, const fast_matrix_market::write_options& options) {
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {triplet.nrows, triplet.ncols},
+                                                    triplet.rows, triplet.cols, triplet.vals, options);
+    return oss.str();
+}
+
+/**
+ * Split `triplet` at `splits` and write each part from its own thread.
+ */
+static void write_collective(const std::string& path, const TripletMat& triplet, const std::vector<std::size_t>& splits,
+                             const fast_matrix_market::write_options& options) {
+    int num_participants = (int)splits.size() + 1;
+    fast_matrix_market::thread_exchange exchange(num_participants);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < num_participants; ++p) {
+        std::size_t begin = p == 0 ? 0 : splits[p - 1];
+        std::size_t end = p == num_participants - 1 ? triplet.rows.size() : splits[p];
+        threads.emplace_back([&, p, begin, end] {
+            std::vector<int64_t> rows(triplet.rows.begin() + (int64_t)begin, triplet.rows.begin() + (int64_t)end);
+            std::vector<int64_t> cols(triplet.cols.begin() + (int64_t)begin, triplet.cols.begin() + (int64_t)end);
+            std::vector<double> vals(triplet.vals.begin() + (int64_t)begin, triplet.vals.begin() + (int64_t)end);
+            fast_matrix_market::write_matrix_market_triplet_collective(path, {triplet.nrows, triplet.ncols},
+                                                                        rows, cols, vals, exchange.get_exchange(p), options);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+class CollectiveWriteTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path = (std::filesystem::temp_directory_path() / ("fmm_collective_write_test_" + std::to_string(::getpid()) + ".mtx")).string();
+
+        triplet.nrows = 1000;
+        triplet.ncols = 1000;
+        for (int64_t i = 0; i < 5000; ++i) {
+            triplet.rows.push_back(i % 1000);
+            triplet.cols.push_back((i * 7) % 1000);
+            triplet.vals.push_back((double)i / 4);
+        }
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    std::string path;
+    TripletMat triplet;
+};
+
+TEST_F(CollectiveWriteTest, MatchesSingleWriter) {
+    fast_matrix_market::write_options options;
+    options.chunk_size_values = 100;
+    options.parallel_ok = true;
+    options.num_threads = 2;
+
+    std::string expected = write_triplet(triplet, options);
+
+    write_collective(path, triplet, {1000, 2500, 4999}, options);
+    EXPECT_EQ(read_file(path), expected);
+
+    // Empty participants, including the one that writes the header.
+    // The file is now longer than the output, so this also checks that it is truncated.
+    triplet.rows.resize(10);
+    triplet.cols.resize(10);
+    triplet.vals.resize(10);
+    expected = write_triplet(triplet, options);
+
+    write_collective(path, triplet, {0, 0, 5, 5, 10}, options);
+    EXPECT_EQ(read_file(path), expected);
+
+    TripletMat result;
+    std::ifstream f(path);
+    fast_matrix_market::read_matrix_market_triplet(f, result.nrows, result.ncols, result.rows, result.cols, result.vals);
+    EXPECT_EQ(result, triplet);
+}
+
+TEST_F(CollectiveWriteTest, Pattern) {
+    fast_matrix_market::write_options options;
+    triplet.vals.clear();
+
+    std::string expected = write_triplet(triplet, options);
+    EXPECT_NE(expected.find("pattern"), std::string::npos);
+
+    fast_matrix_market::thread_exchange exchange(2);
+    std::thread other([&] {
+        std::vector<int64_t> none;
+        std::vector<double> no_vals;
+        fast_matrix_market::write_matrix_market_triplet_collective(path, {triplet.nrows, triplet.ncols},
+                                                                    none, none, no_vals, exchange.get_exchange(1), options);
+    });
+    fast_matrix_market::write_matrix_market_triplet_collective(path, {triplet.nrows, triplet.ncols},
+                                                                triplet.rows, triplet.cols, triplet.vals,
+                                                                exchange.get_exchange(0), options);
+    other.join();
+    EXPECT_EQ(read_file(path), expected);
+}
+
+TEST(ThreadExchange, ExclusiveScan) {
+    const int num_participants = 4;
+    fast_matrix_market::thread_exchange exchange(num_participants);
+    std::vector<fast_matrix_market::exclusive_scan_result> results(num_participants);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < num_participants; ++p) {
+        threads.emplace_back([&, p] {
+            // two rounds, to check that the exchange can be reused
+            exchange.exchange(p, {p});
+            results[p] = exchange.exchange(p, {1, p + 1});
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int p = 0; p < num_participants; ++p) {
+        EXPECT_EQ(results[p].prefix, std::vector<int64_t>({p, p * (p + 1) / 2}));
+        EXPECT_EQ(results[p].total, std::vector<int64_t>({4, 10}));
+    }
+}
@@ -0,0 +1,109 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <random>
+
+#include "fmm_tests.hpp"
+
+using Mat = triplet_matrix<int64_t, double>;
+
+TEST(CRC32C, KnownValues) {
+    EXPECT_EQ(fast_matrix_market::crc32c(""), 0U);
+    EXPECT_EQ(fast_matrix_market::crc32c("123456789"), 0xe3069283U);
+    EXPECT_EQ(fast_matrix_market::crc32c(std::string(32, '\0')), 0x8a9136aaU);
+}
+
+TEST(CRC32C, Implementations) {
+    std::mt19937 gen(1);
+    std::string data(1000, ' ');
+    for (auto& c : data) {
+        c = (char)(gen() & 0xffU);
+    }
+
+    for (std::size_t offset : {0, 1, 3, 7}) {
+        for (std::size_t size : {0, 1, 7, 8, 9, 100, 993}) {
+            auto view = std::string_view(data).substr(offset, size);
+            auto pos = reinterpret_cast<const unsigned char*>(view.data());
+            auto software = ~fast_matrix_market::crc32c_detail::update_software(~0U, pos, size);
+            auto hardware = ~fast_matrix_market::crc32c_detail::update_hardware(~0U, pos, size);
+            EXPECT_EQ(software, hardware);
+            EXPECT_EQ(fast_matrix_market::crc32c(view), software);
+        }
+    }
+}
+
+TEST(CRC32C, Combine) {
+    std::string data = "%%MatrixMarket matrix coordinate real general\n3 3 1\n1 1 2.5\n";
+    for (std::size_t split : {(std::size_t)0, (std::size_t)1, (std::size_t)20, data.size()}) {
+        auto first = std::string_view(data).substr(0, split);
+        auto second = std::string_view(data).substr(split);
+        auto combined = fast_matrix_market::crc32c_combine(fast_matrix_market::crc32c(first),
+                                                           fast_matrix_market::crc32c(second),
+                                                           (int64_t)second.size());
+        EXPECT_EQ(combined, fast_matrix_market::crc32c(data));
+        EXPECT_EQ(fast_matrix_market::crc32c(second, fast_matrix_market::crc32c(first)), combined);
+    }
+}
+
+TEST(CRC32C, WriteAndVerify) {
+    Mat mat = generate_antidiagonal(5000);
+
+    for (bool parallel_ok : {false, true}) {
+        fast_matrix_market::body_checksum checksum;
+        fast_matrix_market::write_options woptions;
+        woptions.parallel_ok = parallel_ok;
+        woptions.chunk_size_values = 100;
+        woptions.checksum = &checksum;
+        woptions.checksum_ranges = true;
+
+        std::ostringstream oss;
+        fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, woptions);
+        std::string written = oss.str();
+
+        // the checksum covers everything after the header
+        std::string body = written.substr(written.find("\n5000 5000 5000\n") + 16);
+        EXPECT_EQ(checksum.num_bytes, (int64_t)body.size());
+        EXPECT_EQ(checksum.crc32c, fast_matrix_market::crc32c(body));
+        ASSERT_GT(checksum.ranges.size(), 1);
+        int64_t offset = 0;
+        for (const auto& r : checksum.ranges) {
+            EXPECT_EQ(r.offset, offset);
+            EXPECT_EQ(r.crc32c, fast_matrix_market::crc32c(std::string_view(body).substr(r.offset, r.num_bytes)));
+            offset += r.num_bytes;
+        }
+        EXPECT_EQ(offset, checksum.num_bytes);
+
+        // sidecar round trip
+        std::stringstream sidecar;
+        fast_matrix_market::write_checksum_sidecar(sidecar, checksum);
+        auto read_checksum = fast_matrix_market::read_checksum_sidecar(sidecar);
+        EXPECT_EQ(read_checksum.crc32c, checksum.crc32c);
+        EXPECT_EQ(read_checksum.num_bytes, checksum.num_bytes);
+        EXPECT_EQ(read_checksum.ranges.size(), checksum.ranges.size());
+
+        std::string corrupt = written;
+        corrupt[corrupt.size() / 2] = (corrupt[corrupt.size() / 2] == '1' ? '2' : '1');
+        std::string truncated = written.substr(0, written.size() - 1);
+
+        for (int p : {1, 4}) {
+            fast_matrix_market::read_options roptions;
+            roptions.chunk_size_bytes = 1 << 12;
+            roptions.num_threads = p;
+            roptions.expected_checksum = &read_checksum;
+
+            Mat read;
+            std::istringstream iss(written);
+            fast_matrix_market::read_matrix_market_triplet(iss, read.nrows, read.ncols, read.rows, read.cols, read.vals, roptions);
+            EXPECT_EQ(read, mat);
+
+            std::istringstream corrupt_iss(corrupt);
+            EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet(corrupt_iss, read.nrows, read.ncols, read.rows, read.cols, read.vals, roptions),
+                         fast_matrix_market::checksum_error);
+
+            std::istringstream truncated_iss(truncated);
+            EXPECT_THROW(fast_matrix_market::read_matrix_market_triplet(truncated_iss, read.nrows, read.ncols, read.rows, read.cols, read.vals, roptions),
+                         fast_matrix_market::checksum_error);
+        }
+    }
+}
@@ -116,3 +116,28 @@ TYPED_TEST(CSCTest, Generated) {
         }
     }
 }
+
+TEST(CSCTest, Permutation) {
+    csc_matrix<int64_t, double> csc;
+    triplet_matrix<int64_t, double> triplet;
+    construct_csc(csc, triplet, 50, 10);
+
+    std::vector<int64_t> row_perm(50), col_perm(10);
+    for (int64_t i = 0; i < 50; ++i) {
+        row_perm[i] = (i * 7) % 50;
+    }
+    for (int64_t i = 0; i < 10; ++i) {
+        col_perm[i] = 9 - i;
+    }
+
+    fast_matrix_market::write_options woptions;
+    woptions.row_permutation = row_perm.data();
+    woptions.col_permutation = col_perm.data();
+    auto permuted = read_mtx<triplet_matrix<int64_t, double>>(write_mtx(csc, woptions), {});
+
+    for (std::size_t i = 0; i < triplet.rows.size(); ++i) {
+        triplet.rows[i] = row_perm[triplet.rows[i]];
+        triplet.cols[i] = col_perm[triplet.cols[i]];
+    }
+    EXPECT_EQ(permuted, triplet);
+}
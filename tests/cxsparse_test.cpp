@@ -4,7 +4,9 @@
 
 #include <filesystem>
 #include <fstream>
+#include <set>
 #include <sstream>
+#include <tuple>
 
 #include "fmm_tests.hpp"
 
@@ -96,3 +98,28 @@ TEST(CXSparse, Symmetric) {
     EXPECT_EQ(6, sym->nzmax);
     EXPECT_EQ(5, expected->nzmax);
 }
+
+TEST(CXSparse, SymmetricPermutation) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real symmetric\n3 3 3\n1 1 1\n2 1 2\n3 2 3\n";
+    std::vector<int64_t> row_perm = {2, 0, 1};
+    std::vector<int64_t> col_perm = {1, 2, 0};
+
+    fast_matrix_market::read_options options;
+    options.row_permutation = row_perm.data();
+    options.col_permutation = col_perm.data();
+
+    cs_dl *A;
+    std::istringstream iss(mtx);
+    fast_matrix_market::read_matrix_market_cxsparse(iss, &A, cs_dl_spalloc, options);
+
+    // mirrored in file coordinates, then permuted, with no explicit zeros on the diagonal
+    std::set<std::tuple<int64_t, int64_t, double>> expected = {
+            {2, 1, 1}, {0, 1, 2}, {2, 2, 2}, {0, 0, 3}, {1, 2, 3}
+    };
+    std::set<std::tuple<int64_t, int64_t, double>> actual;
+    for (int64_t k = 0; k < A->nz; ++k) {
+        actual.emplace(A->i[k], A->p[k], A->x[k]);
+    }
+    EXPECT_EQ(A->nz, 5);
+    EXPECT_EQ(actual, expected);
+}
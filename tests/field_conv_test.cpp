@@ -181,6 +181,32 @@ TYPED_TEST(ReadInt, Integer) {
     EXPECT_EQ(i, 8);
 }
 
+TYPED_TEST(ReadInt, Write) {
+    using lim = std::numeric_limits<TypeParam>;
+    std::vector<TypeParam> values = {0, 1, 9, 10, 99, 100, lim::max(), lim::min(), (TypeParam)(lim::max() - 1)};
+    for (TypeParam i = 1; ; i = (TypeParam)(i * 7 + 3)) {
+        values.push_back(i);
+        if constexpr (std::is_signed_v<TypeParam>) {
+            values.push_back((TypeParam)-i);
+        }
+        if (i > (lim::max() - 3) / 7) {
+            // the next value would overflow
+            break;
+        }
+    }
+
+    for (auto value : values) {
+        std::string expected = std::to_string(value);
+
+        char buf[fmm::kMaxIntChars];
+        EXPECT_EQ(std::string(buf, fmm::write_int(buf, value)), expected);
+
+        std::string appended = "x";
+        fmm::append_int(appended, value);
+        EXPECT_EQ(appended, "x" + expected);
+    }
+}
+
 TEST(ReadOverflow, Integer) {
     int8_t i8;
     int32_t i32;
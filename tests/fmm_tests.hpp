@@ -69,6 +69,38 @@ struct array_matrix {
     }
 };
 
+/**
+ * nnz-by-nnz anti-diagonal matrix. Element i is (i, nnz - 1 - i) with value i / 2, so that elements can be checked
+ * against their position.
+ */
+inline triplet_matrix<int64_t, double> generate_antidiagonal(int64_t nnz) {
+    triplet_matrix<int64_t, double> mat;
+    mat.nrows = nnz;
+    mat.ncols = nnz;
+    for (int64_t i = 0; i < nnz; ++i) {
+        mat.rows.push_back(i);
+        mat.cols.push_back(nnz - 1 - i);
+        mat.vals.push_back((double)i * 0.5);
+    }
+    return mat;
+}
+
+/**
+ * generate_antidiagonal() as Matrix Market text. If `empty_line_interval` is positive then empty lines are inserted
+ * before every `empty_line_interval`-th element.
+ */
+inline std::string generate_antidiagonal_mtx(int64_t nnz, int64_t empty_line_interval = 0) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real general\n";
+    mtx += std::to_string(nnz) + " " + std::to_string(nnz) + " " + std::to_string(nnz) + "\n";
+    for (int64_t i = 0; i < nnz; ++i) {
+        if (empty_line_interval > 0 && (i + 1) % empty_line_interval == 0) {
+            mtx += "\n  \n";
+        }
+        mtx += std::to_string(i + 1) + " " + std::to_string(nnz - i) + " " + std::to_string((double)i * 0.5) + "\n";
+    }
+    return mtx;
+}
+
 template <typename FT>
 std::ostream& operator<<(std::ostream& os, const std::complex<FT>& c) {
     os << c.real();
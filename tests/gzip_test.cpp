@@ -0,0 +1,219 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <algorithm>
+#include <map>
+
+#include "fmm_tests.hpp"
+
+#include <fast_matrix_market/gzip.hpp>
+
+using Mat = triplet_matrix<int64_t, double>;
+
+/**
+ * Compress `data` into a single gzip member, or a raw deflate stream.
+ */
+std::string gzip_compress(const std::string& data, bool raw = false) {
+    z_stream zs{};
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, raw ? -15 : 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&zs, (uLong)data.size()) + 32, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = (uInt)data.size();
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = (uInt)out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+/**
+ * Compress `data` into BGZF members of at most `block_size` uncompressed bytes, like `bgzip` does.
+ */
+std::string bgzf_compress(const std::string& data, std::size_t block_size) {
+    std::string out;
+    for (std::size_t start = 0; start < data.size(); start += block_size) {
+        std::string member = gzip_compress(data.substr(start, block_size));
+
+        // insert the BC extra subfield after the 10 byte header
+        std::string extra = {6, 0, 'B', 'C', 2, 0, 0, 0};
+        member[3] = (char)(member[3] | 0x04);
+        member.insert(10, extra);
+        std::size_t bsize = member.size() - 1;
+        member[16] = (char)(bsize & 0xffU);
+        member[17] = (char)((bsize >> 8U) & 0xffU);
+        out += member;
+    }
+    return out;
+}
+
+Mat read_compressed(const std::string& compressed, int p, int64_t chunk_size_bytes = 1 << 12) {
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = chunk_size_bytes;
+    options.num_threads = p;
+
+    std::istringstream iss(compressed);
+    fast_matrix_market::gzip_istream gz(iss, options);
+    Mat mat;
+    fast_matrix_market::read_matrix_market_triplet(gz, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+    return mat;
+}
+
+TEST(Gzip, Read) {
+    std::string mtx = generate_antidiagonal_mtx(20000);
+
+    Mat expected;
+    {
+        std::istringstream iss(mtx);
+        fast_matrix_market::read_matrix_market_triplet(iss, expected.nrows, expected.ncols,
+                                                       expected.rows, expected.cols, expected.vals);
+    }
+
+    std::string single = gzip_compress(mtx);
+    std::string concatenated = gzip_compress(mtx.substr(0, 1000)) + gzip_compress(mtx.substr(1000));
+    std::string bgzf = bgzf_compress(mtx, 5000);
+    // BGZF members followed by a plain member
+    std::string mixed = bgzf_compress(mtx.substr(0, 20000), 5000) + gzip_compress(mtx.substr(20000));
+
+    for (const auto& compressed : {single, concatenated, bgzf, mixed}) {
+        for (int p : {1, 4}) {
+            EXPECT_EQ(read_compressed(compressed, p), expected);
+        }
+    }
+}
+
+/**
+ * Block boundaries of a raw deflate stream, as found by zlib: bit offset -> decompressed bytes before it.
+ */
+std::map<int64_t, std::size_t> deflate_block_boundaries(const std::string& compressed, std::size_t decompressed_size) {
+    std::map<int64_t, std::size_t> ret{{0, 0}};
+
+    z_stream zs{};
+    inflateInit2(&zs, -15);
+    std::string out(decompressed_size, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+    zs.avail_in = (uInt)compressed.size();
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = (uInt)out.size();
+    while (true) {
+        int status = inflate(&zs, Z_BLOCK);
+        int64_t bit = (int64_t)(compressed.size() - zs.avail_in) * 8 - (zs.data_type & 7);
+        if (status == Z_STREAM_END) {
+            ret[bit] = zs.total_out;
+            break;
+        }
+        if (status != Z_OK) {
+            ADD_FAILURE() << "zlib failed";
+            break;
+        }
+        if (zs.data_type & 128) {
+            ret[bit] = zs.total_out;
+        }
+    }
+    inflateEnd(&zs);
+    return ret;
+}
+
+TEST(Gzip, SpeculativeChunk) {
+    std::string mtx = generate_antidiagonal_mtx(50000);
+    std::string compressed = gzip_compress(mtx, true);
+    auto boundaries = deflate_block_boundaries(compressed, mtx.size());
+    ASSERT_GT(boundaries.size(), 5);
+
+    const auto* data = reinterpret_cast<const uint8_t*>(compressed.data());
+    const int64_t piece_bits = 8 * (1 << 14);
+    int num_found = 0;
+    for (int64_t search_begin = piece_bits; search_begin < (int64_t)compressed.size() * 8; search_begin += piece_bits) {
+        int64_t stop_bit = search_begin + piece_bits;
+        auto chunk = fast_matrix_market::inflate_deflate_chunk_speculative(data, compressed.size(), search_begin,
+                                                                           stop_bit, stop_bit);
+        if (chunk.begin_bit < 0) {
+            continue;
+        }
+        ++num_found;
+
+        // the first dynamic block after the search start, decoded to the first block at or after the stop
+        auto begin = boundaries.lower_bound(search_begin);
+        ASSERT_EQ(chunk.begin_bit, begin->first);
+        auto end = boundaries.lower_bound(stop_bit);
+        ASSERT_EQ(chunk.end_bit, end->first);
+        EXPECT_EQ(chunk.final, end->second == mtx.size());
+
+        // markers stand for the 32 KiB before the chunk
+        std::size_t window_size = std::min(begin->second, fast_matrix_market::kDeflateWindowSize);
+        std::string window = mtx.substr(begin->second - window_size, window_size);
+        std::string out;
+        ASSERT_TRUE(fast_matrix_market::resolve_deflate_markers(chunk.marked, window, out));
+        out += chunk.plain;
+        EXPECT_EQ(out, mtx.substr(begin->second, end->second - begin->second));
+
+        // a window that is too short
+        std::string short_window;
+        if (std::any_of(chunk.marked.begin(), chunk.marked.end(), [](uint16_t sym) { return sym >= 256; })) {
+            EXPECT_FALSE(fast_matrix_market::resolve_deflate_markers(chunk.marked, short_window, out));
+        }
+    }
+    EXPECT_GT(num_found, 2);
+}
+
+TEST(Gzip, ReadSingleMemberParallel) {
+    std::string mtx = generate_antidiagonal_mtx(30000);
+
+    Mat expected;
+    {
+        std::istringstream iss(mtx);
+        fast_matrix_market::read_matrix_market_triplet(iss, expected.nrows, expected.ncols,
+                                                       expected.rows, expected.cols, expected.vals);
+    }
+
+    std::string single = gzip_compress(mtx);
+    // FNAME and FCOMMENT header fields
+    std::string named = single.substr(0, 10) + "matrix.mtx" + '\0' + "comment" + '\0' + single.substr(10);
+    named[3] = (char)(named[3] | 0x08 | 0x10);
+    // trailing zero padding is ignored
+    std::string padded = single + std::string(100, '\0');
+    std::string concatenated = gzip_compress(mtx.substr(0, 300000)) + gzip_compress(mtx.substr(300000));
+
+    // pieces smaller and larger than the blocks
+    for (int64_t chunk_size_bytes : {1 << 12, 1 << 15}) {
+        for (const auto& compressed : {single, named, padded, concatenated}) {
+            EXPECT_EQ(read_compressed(compressed, 4, chunk_size_bytes), expected);
+        }
+
+        std::istringstream iss(single);
+        fast_matrix_market::read_options options;
+        options.chunk_size_bytes = chunk_size_bytes;
+        options.num_threads = 4;
+        fast_matrix_market::gzip_istream gz(iss, options);
+        std::string contents((std::istreambuf_iterator<char>(gz)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(contents, mtx);
+    }
+}
+
+TEST(Gzip, Empty) {
+    for (int p : {1, 4}) {
+        fast_matrix_market::read_options options;
+        options.num_threads = p;
+
+        std::istringstream iss("");
+        fast_matrix_market::gzip_istream gz(iss, options);
+        std::string contents((std::istreambuf_iterator<char>(gz)), std::istreambuf_iterator<char>());
+        EXPECT_TRUE(contents.empty());
+    }
+}
+
+TEST(Gzip, Invalid) {
+    std::string mtx = generate_antidiagonal_mtx(1000);
+    std::string truncated = gzip_compress(mtx);
+    truncated.resize(truncated.size() / 2);
+    // flip a bit of the CRC in the trailer
+    std::string bad_crc = gzip_compress(mtx);
+    bad_crc[bad_crc.size() - 8] = (char)(bad_crc[bad_crc.size() - 8] ^ 1);
+
+    for (const auto& compressed : {mtx, truncated, bad_crc}) {
+        for (int p : {1, 4}) {
+            EXPECT_THROW(read_compressed(compressed, p), fast_matrix_market::gzip_error);
+        }
+    }
+}
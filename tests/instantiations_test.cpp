@@ -0,0 +1,77 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+// Linked against fast_matrix_market::instantiated. The methods below are extern templates, so this only links if
+// the library instantiates them.
+
+#include "fmm_tests.hpp"
+
+#ifndef FMM_EXTERN_TEMPLATES
+#error "FMM_EXTERN_TEMPLATES should be set by the fast_matrix_market::instantiated target"
+#endif
+
+template <typename T>
+class Instantiations : public testing::Test {};
+
+using TripletTypes = ::testing::Types<
+        triplet_matrix<int32_t, double>,
+        triplet_matrix<int32_t, std::complex<double>>,
+        triplet_matrix<int64_t, float>,
+        triplet_matrix<int64_t, int64_t>
+        >;
+TYPED_TEST_SUITE(Instantiations, TripletTypes);
+
+TYPED_TEST(Instantiations, Triplet) {
+    using IT = typename decltype(TypeParam::rows)::value_type;
+    using VT = typename TypeParam::value_type;
+
+    TypeParam mat;
+    mat.nrows = 4;
+    mat.ncols = 3;
+    mat.rows = {0, 1, 3};
+    mat.cols = {0, 2, 1};
+    mat.vals = {VT(1), VT(2), VT(3)};
+
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals);
+
+    TypeParam read;
+    std::istringstream iss(oss.str());
+    fast_matrix_market::read_matrix_market_triplet(iss, read.nrows, read.ncols, read.rows, read.cols, read.vals);
+    EXPECT_EQ(read.nrows, mat.nrows);
+    EXPECT_EQ(read.ncols, mat.ncols);
+    EXPECT_EQ(read.rows, mat.rows);
+    EXPECT_EQ(read.cols, mat.cols);
+    EXPECT_EQ(read.vals, mat.vals);
+
+    // the same matrix, as CSC
+    std::vector<IT> indptr = {0, 1, 2, 3};
+    std::vector<IT> indices = {0, 3, 1};
+    std::vector<VT> vals = {VT(1), VT(3), VT(2)};
+    std::ostringstream csc_oss;
+    fast_matrix_market::write_matrix_market_csc(csc_oss, {mat.nrows, mat.ncols}, indptr, indices, vals, false);
+
+    fast_matrix_market::matrix_market_header header;
+    std::istringstream csc_iss(csc_oss.str());
+    fast_matrix_market::read_matrix_market_triplet(csc_iss, header, read.rows, read.cols, read.vals);
+    EXPECT_EQ(header.nnz, 3);
+    EXPECT_EQ(read.rows, (std::vector<IT>{0, 3, 1}));
+    EXPECT_EQ(read.cols, (std::vector<IT>{0, 1, 2}));
+    EXPECT_EQ(read.vals, vals);
+}
+
+TEST(Instantiations, Array) {
+    std::vector<double> vals = {1, 2, 3, 4, 5, 6};
+
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_array(oss, {2, 3}, vals, fast_matrix_market::col_major);
+
+    int64_t nrows, ncols;
+    std::vector<double> read;
+    std::istringstream iss(oss.str());
+    fast_matrix_market::read_matrix_market_array(iss, nrows, ncols, read, fast_matrix_market::col_major);
+    EXPECT_EQ(nrows, 2);
+    EXPECT_EQ(ncols, 3);
+    EXPECT_EQ(read, vals);
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "fmm_tests.hpp"
+
+#include <fast_matrix_market/app/sample.hpp>
+
+using Mat = triplet_matrix<int64_t, double>;
+
+const int64_t kNnz = 10000;
+
+/**
+ * Check a sample of generate_antidiagonal_mtx(kNnz) against the source.
+ */
+void expect_valid_sample(const Mat& sample) {
+    EXPECT_EQ(sample.rows.size(), sample.vals.size());
+    for (std::size_t i = 0; i < sample.rows.size(); ++i) {
+        EXPECT_EQ(sample.cols[i], kNnz - 1 - sample.rows[i]);
+        EXPECT_EQ((double)sample.rows[i] * 0.5, sample.vals[i]);
+        if (i > 0) {
+            // file order, no duplicates
+            EXPECT_LT(sample.rows[i - 1], sample.rows[i]);
+        }
+    }
+}
+
+TEST(Sample, Bernoulli) {
+    std::string mtx = generate_antidiagonal_mtx(kNnz);
+
+    Mat reference;
+    for (int p : {1, 2, 4}) {
+        fast_matrix_market::read_options options;
+        options.chunk_size_bytes = 4000;
+        options.num_threads = p;
+        options.parallel_ok = (p != 1);
+
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        Mat sample;
+        fast_matrix_market::read_matrix_market_triplet_sample(iss, header, sample.rows, sample.cols, sample.vals,
+                                                              0.1, 42, options);
+        expect_valid_sample(sample);
+        EXPECT_GT(sample.rows.size(), 800);
+        EXPECT_LT(sample.rows.size(), 1200);
+
+        if (p > 1) {
+            if (!reference.rows.empty()) {
+                // independent of thread scheduling
+                EXPECT_EQ(sample.rows, reference.rows);
+            }
+            reference = sample;
+        }
+    }
+}
+
+TEST(Sample, Reservoir) {
+    std::string mtx = generate_antidiagonal_mtx(kNnz);
+
+    for (int64_t sample_size : {0, 1, 100, 20000}) {
+        for (int p : {1, 4}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 4000;
+            options.num_threads = p;
+
+            std::istringstream iss(mtx);
+            fast_matrix_market::matrix_market_header header;
+            Mat sample;
+            fast_matrix_market::read_matrix_market_triplet_reservoir(iss, header, sample.rows, sample.cols, sample.vals,
+                                                                     sample_size, 7, options);
+            expect_valid_sample(sample);
+            EXPECT_EQ((int64_t)sample.rows.size(), std::min(sample_size, (int64_t)10000));
+        }
+    }
+}
+
+TEST(Sample, Seek) {
+    std::string mtx = generate_antidiagonal_mtx(kNnz);
+
+    for (int p : {1, 4}) {
+        fast_matrix_market::read_options options;
+        options.chunk_size_bytes = 500;
+        options.num_threads = p;
+
+        std::istringstream iss(mtx);
+        fast_matrix_market::matrix_market_header header;
+        Mat sample;
+        fast_matrix_market::read_matrix_market_triplet_sample_seek(iss, header, sample.rows, sample.cols, sample.vals,
+                                                                   5, 3, options);
+        expect_valid_sample(sample);
+        // each 500 byte chunk holds roughly 500 / 16 lines
+        EXPECT_GT(sample.rows.size(), 5 * 20);
+        EXPECT_LT(sample.rows.size(), 5 * 50);
+        EXPECT_EQ(header.nnz, 10000);
+    }
+
+    // more chunks than the file has falls back to reading everything
+    std::istringstream iss(mtx);
+    fast_matrix_market::matrix_market_header header;
+    Mat sample;
+    fast_matrix_market::read_matrix_market_triplet_sample_seek(iss, header, sample.rows, sample.cols, sample.vals,
+                                                               1000000, 3);
+    expect_valid_sample(sample);
+    EXPECT_EQ(sample.rows.size(), 10000);
+}
+
+TEST(Sample, SeekError) {
+    // every element is out of bounds
+    std::string mtx = "%%MatrixMarket matrix coordinate real general\n10 10 1000\n";
+    for (int i = 0; i < 1000; ++i) {
+        mtx += "11 1 " + std::to_string(i) + "\n";
+    }
+
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 500;
+
+    std::istringstream iss(mtx);
+    fast_matrix_market::matrix_market_header header;
+    Mat sample;
+    try {
+        fast_matrix_market::read_matrix_market_triplet_sample_seek(iss, header, sample.rows, sample.cols, sample.vals,
+                                                                   3, 3, options);
+        FAIL() << "Expected invalid_mm";
+    } catch (const fast_matrix_market::invalid_mm& e) {
+        std::string what = e.what();
+        const std::string prefix = "Chunk at byte ";
+        ASSERT_EQ(what.rfind(prefix, 0), 0) << what;
+        EXPECT_NE(what.find("Line 1: Row index out of bounds"), std::string::npos) << what;
+
+        // the offset is the start of the bad line
+        auto offset = std::stoll(what.substr(prefix.size()));
+        ASSERT_LT(offset, (int64_t)mtx.size());
+        EXPECT_EQ(mtx[offset - 1], '\n');
+        EXPECT_EQ(mtx.compare(offset, 5, "11 1 "), 0);
+    }
+}
@@ -0,0 +1,144 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <map>
+
+#include "fmm_tests.hpp"
+
+#include <fast_matrix_market/app/sell.hpp>
+
+using Mat = triplet_matrix<int64_t, double>;
+
+struct sell_matrix {
+    std::vector<int64_t> row_perm, slice_ptr, cols;
+    std::vector<double> vals;
+};
+
+/**
+ * A stream buffer that cannot seek, like a pipe.
+ */
+class unseekable_buf : public std::stringbuf {
+public:
+    explicit unseekable_buf(const std::string& s) : std::stringbuf(s) {}
+
+protected:
+    pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override {
+        return pos_type(off_type(-1));
+    }
+    pos_type seekpos(pos_type, std::ios_base::openmode) override {
+        return pos_type(off_type(-1));
+    }
+};
+
+/**
+ * Rows of different lengths, some empty.
+ */
+std::string generate_mtx(const std::string& symmetry) {
+    std::string mtx = "%%MatrixMarket matrix coordinate real " + symmetry + "\n";
+    std::string body;
+    int64_t nnz = 0;
+    for (int64_t row = 1; row <= 37; ++row) {
+        for (int64_t col = 1; col <= (row * 7) % 11 && col <= row; ++col) {
+            body += std::to_string(row) + " " + std::to_string((row + col) % row + 1) + " " +
+                    std::to_string(row * 100 + col) + "\n";
+            ++nnz;
+        }
+    }
+    return mtx + "37 37 " + std::to_string(nnz) + "\n" + body;
+}
+
+/**
+ * Check that `sell` holds the same rows as a triplet read, and is laid out as SELL-C-sigma.
+ */
+void check_sell(const std::string& mtx, const sell_matrix& sell, int64_t c, int64_t sigma) {
+    Mat mat;
+    std::istringstream iss(mtx);
+    fast_matrix_market::read_matrix_market_triplet(iss, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals);
+
+    std::map<int64_t, std::vector<std::pair<int64_t, double>>> expected_rows;
+    for (std::size_t i = 0; i < mat.rows.size(); ++i) {
+        expected_rows[mat.rows[i]].emplace_back(mat.cols[i], mat.vals[i]);
+    }
+
+    ASSERT_EQ((int64_t)sell.row_perm.size(), mat.nrows);
+    ASSERT_EQ((int64_t)sell.slice_ptr.size(), (mat.nrows + c - 1) / c + 1);
+    EXPECT_EQ(sell.slice_ptr.back(), (int64_t)sell.cols.size());
+
+    std::vector<int64_t> lengths(mat.nrows);
+    for (int64_t p = 0; p < mat.nrows; ++p) {
+        int64_t row = sell.row_perm[p];
+        int64_t slice = p / c;
+        int64_t width = (sell.slice_ptr[slice + 1] - sell.slice_ptr[slice]) / c;
+
+        auto expected = expected_rows[row];
+        std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        lengths[p] = (int64_t)expected.size();
+        ASSERT_LE(lengths[p], width);
+
+        for (int64_t k = 0; k < width; ++k) {
+            int64_t pos = sell.slice_ptr[slice] + k * c + p % c;
+            if (k < lengths[p]) {
+                EXPECT_EQ(sell.cols[pos], expected[k].first);
+                EXPECT_EQ(sell.vals[pos], expected[k].second);
+            } else {
+                EXPECT_EQ(sell.cols[pos], 0);
+                EXPECT_EQ(sell.vals[pos], 0);
+            }
+        }
+    }
+
+    // sorted by decreasing length within each sigma window
+    for (int64_t p = 1; p < mat.nrows; ++p) {
+        if (p % sigma != 0) {
+            EXPECT_GE(lengths[p - 1], lengths[p]);
+        }
+    }
+}
+
+TEST(SELL, Read) {
+    for (std::string symmetry : {"general", "symmetric"}) {
+        std::string mtx = generate_mtx(symmetry);
+
+        for (auto [c, sigma] : std::vector<std::pair<int64_t, int64_t>>{{1, 1}, {4, 1}, {4, 8}, {8, 37}, {64, 64}}) {
+            for (int p : {1, 4}) {
+                fast_matrix_market::read_options options;
+                options.chunk_size_bytes = 64;
+                options.num_threads = p;
+
+                for (bool reparse : {false, true}) {
+                    fast_matrix_market::sell_options layout;
+                    layout.slice_height = c;
+                    layout.sigma = sigma;
+                    layout.reparse = reparse;
+
+                    for (bool seekable : {true, false}) {
+                        unseekable_buf buf(mtx);
+                        std::istringstream seekable_stream(mtx);
+                        std::istream unseekable_stream(&buf);
+
+                        fast_matrix_market::matrix_market_header header;
+                        sell_matrix sell;
+                        fast_matrix_market::read_matrix_market_sell(seekable ? seekable_stream : unseekable_stream,
+                                                                    header,
+                                                                    sell.row_perm, sell.slice_ptr, sell.cols, sell.vals,
+                                                                    layout, options);
+                        check_sell(mtx, sell, c, sigma);
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(SELL, Invalid) {
+    std::istringstream iss(generate_mtx("general"));
+    fast_matrix_market::matrix_market_header header;
+    sell_matrix sell;
+    fast_matrix_market::sell_options layout;
+    layout.slice_height = 0;
+    EXPECT_THROW(fast_matrix_market::read_matrix_market_sell(iss, header,
+                                                             sell.row_perm, sell.slice_ptr, sell.cols, sell.vals,
+                                                             layout),
+                 fast_matrix_market::invalid_argument);
+}
@@ -0,0 +1,173 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <sstream>
+
+#include <fast_matrix_market/app/tail.hpp>
+
+#include "fmm_tests.hpp"
+
+/**
+ * A file that is appended to in steps.
+ */
+class growing_file {
+public:
+    explicit growing_file(const std::string& header) : contents(header) {}
+
+    void append(const std::string& str) {
+        contents += str;
+    }
+
+    /**
+     * Read what has been appended so far. Opens a new stream each time, as a monitor process would.
+     */
+    template <typename IT, typename VT>
+    int64_t read(fast_matrix_market::tail_checkpoint& checkpoint, triplet_matrix<IT, VT>& triplet,
+                 const fast_matrix_market::read_options& options = {}) {
+        std::istringstream iss(contents);
+        return fast_matrix_market::read_matrix_market_triplet_tail(iss, checkpoint, triplet.rows, triplet.cols, triplet.vals, options);
+    }
+
+    std::string contents;
+};
+
+TEST(Tail, Incremental) {
+    growing_file file("%%MatrixMarket matrix coordinate real general\n"
+                      "% nnz is not known yet\n"
+                      "4 4 0\n");
+    fast_matrix_market::tail_checkpoint checkpoint;
+    triplet_matrix<int64_t, double> triplet;
+
+    // header only
+    EXPECT_EQ(file.read(checkpoint, triplet), 0);
+    EXPECT_TRUE(checkpoint.header_read);
+    EXPECT_EQ(checkpoint.header.nrows, 4);
+    EXPECT_EQ(checkpoint.offset, (int64_t)file.contents.size());
+    EXPECT_EQ(triplet.rows.size(), 0);
+
+    file.append("1 1 1.5\n2 2 2.5\n3 3 ");
+    EXPECT_EQ(file.read(checkpoint, triplet), 2);
+    EXPECT_EQ(checkpoint.num_elements, 2);
+    EXPECT_EQ(checkpoint.remainder, "3 3 ");
+    EXPECT_EQ(checkpoint.offset, (int64_t)file.contents.size());
+
+    // the partial line is not parsed until it ends
+    file.append("3.");
+    EXPECT_EQ(file.read(checkpoint, triplet), 0);
+    EXPECT_EQ(checkpoint.remainder, "3 3 3.");
+
+    file.append("5\n\n4 4 4.5\n");
+    EXPECT_EQ(file.read(checkpoint, triplet), 2);
+    EXPECT_EQ(checkpoint.num_elements, 4);
+    EXPECT_EQ(checkpoint.remainder, "");
+
+    // nothing new
+    EXPECT_EQ(file.read(checkpoint, triplet), 0);
+
+    EXPECT_EQ(triplet.rows, std::vector<int64_t>({0, 1, 2, 3}));
+    EXPECT_EQ(triplet.cols, std::vector<int64_t>({0, 1, 2, 3}));
+    EXPECT_EQ(triplet.vals, std::vector<double>({1.5, 2.5, 3.5, 4.5}));
+}
+
+TEST(Tail, Symmetric) {
+    growing_file file("%%MatrixMarket matrix coordinate integer symmetric\n"
+                      "3 3 0\n");
+    fast_matrix_market::tail_checkpoint checkpoint;
+    triplet_matrix<int64_t, int64_t> triplet;
+
+    file.append("2 1 5\n");
+    EXPECT_EQ(file.read(checkpoint, triplet), 2);
+    file.append("3 2 7\n");
+    EXPECT_EQ(file.read(checkpoint, triplet), 2);
+    // diagonal elements are not duplicated
+    file.append("3 3 9\n1 1 4\n");
+    EXPECT_EQ(file.read(checkpoint, triplet), 2);
+
+    // each call's elements are followed by their mirrors
+    EXPECT_EQ(triplet.rows, std::vector<int64_t>({1, 0, 2, 1, 2, 0}));
+    EXPECT_EQ(triplet.cols, std::vector<int64_t>({0, 1, 1, 2, 2, 0}));
+    EXPECT_EQ(triplet.vals, std::vector<int64_t>({5, 5, 7, 7, 9, 4}));
+}
+
+TEST(Tail, Parallel) {
+    growing_file file("%%MatrixMarket matrix coordinate integer general\n"
+                      "1000 1000 0\n");
+    fast_matrix_market::tail_checkpoint checkpoint;
+    triplet_matrix<int64_t, int64_t> triplet;
+
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 1 << 12;
+    options.num_threads = 4;
+
+    int64_t expected = 0;
+    for (int step = 0; step < 3; ++step) {
+        std::string lines;
+        for (int i = 0; i < 1000; ++i, ++expected) {
+            lines += std::to_string(i + 1) + " " + std::to_string(step + 1) + " " + std::to_string(expected) + "\n";
+        }
+        file.append(lines);
+        EXPECT_EQ(file.read(checkpoint, triplet, options), 1000);
+    }
+
+    ASSERT_EQ(triplet.vals.size(), expected);
+    for (int64_t i = 0; i < expected; ++i) {
+        EXPECT_EQ(triplet.rows[i], i % 1000);
+        EXPECT_EQ(triplet.cols[i], i / 1000);
+        EXPECT_EQ(triplet.vals[i], i);
+    }
+}
+
+TEST(Tail, SymmetricParallel) {
+    std::string banner = "%%MatrixMarket matrix coordinate integer skew-symmetric\n";
+    growing_file file(banner + "1000 1000 0\n");
+    fast_matrix_market::tail_checkpoint checkpoint;
+    triplet_matrix<int64_t, int64_t> triplet;
+
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 1 << 12;
+    options.num_threads = 4;
+
+    std::string lines;
+    for (int i = 1; i < 1000; ++i) {
+        lines += std::to_string(i + 1) + " " + std::to_string(i / 2 + 1) + " " + std::to_string(i) + "\n";
+    }
+    file.append(lines);
+    EXPECT_EQ(file.read(checkpoint, triplet, options), 2 * 999);
+
+    // same as reading the whole file at once
+    std::istringstream iss(banner + "1000 1000 999\n" + lines);
+    triplet_matrix<int64_t, int64_t> expected;
+    fast_matrix_market::read_matrix_market_triplet(iss, expected.nrows, expected.ncols, expected.rows, expected.cols, expected.vals, options);
+    EXPECT_EQ(triplet.rows, expected.rows);
+    EXPECT_EQ(triplet.cols, expected.cols);
+    EXPECT_EQ(triplet.vals, expected.vals);
+}
+
+TEST(Tail, Errors) {
+    growing_file file("%%MatrixMarket matrix coordinate real general\n"
+                      "4 4 0\n");
+    fast_matrix_market::tail_checkpoint checkpoint;
+    triplet_matrix<int64_t, double> triplet;
+
+    file.append("1 1 1.5\n");
+    EXPECT_EQ(file.read(checkpoint, triplet), 1);
+
+    // a bad line leaves the checkpoint and the triplet unchanged
+    auto before = checkpoint.offset;
+    file.append("2 2 2.5\n9 9 9\n");
+    EXPECT_THROW(file.read(checkpoint, triplet), fast_matrix_market::invalid_mm);
+    EXPECT_EQ(checkpoint.offset, before);
+    EXPECT_EQ(checkpoint.num_elements, 1);
+    EXPECT_EQ(triplet.vals.size(), 1);
+
+    // the file was rewritten
+    file.contents.resize(10);
+    EXPECT_THROW(file.read(checkpoint, triplet), fast_matrix_market::invalid_argument);
+
+    // array files have no elements to append
+    growing_file array("%%MatrixMarket matrix array real general\n"
+                       "2 2\n");
+    fast_matrix_market::tail_checkpoint array_checkpoint;
+    EXPECT_THROW(array.read(array_checkpoint, triplet), fast_matrix_market::invalid_argument);
+}
@@ -0,0 +1,164 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include "fmm_tests.hpp"
+
+#include <fast_matrix_market/tar.hpp>
+
+using Mat = triplet_matrix<int64_t, double>;
+
+/**
+ * Build a tar header block.
+ */
+std::string tar_header(const std::string& name, int64_t size, char type) {
+    std::string header(512, '\0');
+    std::copy(name.begin(), name.begin() + (std::ptrdiff_t)std::min(name.size(), (std::size_t)100), header.begin());
+
+    auto octal = [&](std::size_t offset, std::size_t length, int64_t value) {
+        std::ostringstream oss;
+        oss << std::oct << std::setw((int)length - 1) << std::setfill('0') << value;
+        std::string s = oss.str();
+        std::copy(s.begin(), s.end(), header.begin() + (std::ptrdiff_t)offset);
+    };
+    octal(100, 8, 0644);
+    octal(108, 8, 0);
+    octal(116, 8, 0);
+    octal(124, 12, size);
+    octal(136, 12, 0);
+    header[156] = type;
+    header.replace(257, 6, std::string("ustar\0", 6));
+    header.replace(263, 2, "00");
+
+    int64_t sum = 0;
+    std::fill(header.begin() + 148, header.begin() + 156, ' ');
+    for (char c : header) {
+        sum += (unsigned char)c;
+    }
+    octal(148, 7, sum);
+    return header;
+}
+
+std::string tar_member(const std::string& name, const std::string& data, char type = '0') {
+    std::string ret = tar_header(name, (int64_t)data.size(), type) + data;
+    ret.resize((ret.size() + 511) / 512 * 512, '\0');
+    return ret;
+}
+
+std::string tar_end() {
+    return std::string(1024, '\0');
+}
+
+Mat read_mtx(std::istream& instream) {
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 1 << 12;
+    options.num_threads = 2;
+
+    Mat mat;
+    fast_matrix_market::read_matrix_market_triplet(instream, mat.nrows, mat.ncols, mat.rows, mat.cols, mat.vals, options);
+    return mat;
+}
+
+Mat read_mtx(const std::string& mtx) {
+    std::istringstream iss(mtx);
+    return read_mtx(iss);
+}
+
+TEST(Tar, GlobMatch) {
+    using fast_matrix_market::tar_glob_match;
+    EXPECT_TRUE(tar_glob_match("a/a.mtx", "a/a.mtx"));
+    EXPECT_TRUE(tar_glob_match("*.mtx", "a/a_b.mtx"));
+    EXPECT_TRUE(tar_glob_match("*/a_?.mtx", "a/a_b.mtx"));
+    EXPECT_TRUE(tar_glob_match("*", ""));
+    EXPECT_TRUE(tar_glob_match("a*b*c", "aXbYbZc"));
+    EXPECT_FALSE(tar_glob_match("*.mtx", "a/a.mtx.gz"));
+    EXPECT_FALSE(tar_glob_match("a/?.mtx", "a/ab.mtx"));
+    EXPECT_FALSE(tar_glob_match("a", ""));
+}
+
+TEST(Tar, FindMember) {
+    std::string main = generate_antidiagonal_mtx(5000);
+    std::string aux = generate_antidiagonal_mtx(10);
+
+    std::string archive = tar_member("mat/", "", '5') +
+                          tar_member("mat/mat_b.mtx", aux) +
+                          tar_member("mat/mat.mtx", main) +
+                          tar_end();
+
+    std::istringstream iss(archive);
+    fast_matrix_market::tar_reader tar(iss);
+    ASSERT_TRUE(fast_matrix_market::find_tar_member(tar, "*/mat.mtx"));
+    EXPECT_EQ(tar.entry().name, "mat/mat.mtx");
+    EXPECT_EQ(tar.entry().size, (int64_t)main.size());
+    EXPECT_EQ(read_mtx(tar.member()), read_mtx(main));
+    EXPECT_FALSE(tar.next());
+}
+
+TEST(Tar, ReadMembers) {
+    std::vector<std::string> mtx = {generate_antidiagonal_mtx(3000), generate_antidiagonal_mtx(7), generate_antidiagonal_mtx(100)};
+
+    std::string archive = tar_member("mat/mat.mtx", mtx[0]) +
+                          tar_member("mat/README.txt", "readme") +
+                          tar_member("mat/mat_b.mtx", mtx[1]) +
+                          tar_member("mat/mat_x.mtx", mtx[2]) +
+                          tar_end();
+
+    // read some members fully, one partially, and skip one
+    std::istringstream iss(archive);
+    std::vector<std::string> names;
+    auto num_matched = fast_matrix_market::read_tar_members(iss, {"*.mtx"}, [&](const auto& entry, std::istream& member) {
+        names.push_back(entry.name);
+        if (entry.name == "mat/mat_b.mtx") {
+            std::string line;
+            std::getline(member, line);
+            return;
+        }
+        EXPECT_EQ(read_mtx(member), read_mtx(mtx[names.size() == 1 ? 0 : 2]));
+    });
+    EXPECT_EQ(num_matched, 3);
+    EXPECT_EQ(names, std::vector<std::string>({"mat/mat.mtx", "mat/mat_b.mtx", "mat/mat_x.mtx"}));
+}
+
+TEST(Tar, LongNames) {
+    std::string long_name = std::string(150, 'd') + "/matrix.mtx";
+    std::string mtx = generate_antidiagonal_mtx(10);
+
+    // GNU long name
+    std::string gnu = tar_member("././@LongLink", long_name + '\0', 'L') + tar_member("truncated", mtx) + tar_end();
+
+    // pax extended header
+    std::string record = "path=" + long_name + "\n";
+    std::string length = std::to_string(record.size() + 4);
+    std::string pax = tar_member("PaxHeader", length + " " + record, 'x') + tar_member("truncated", mtx) + tar_end();
+    ASSERT_EQ(length.size(), 3);
+
+    for (const auto& archive : {gnu, pax}) {
+        std::istringstream iss(archive);
+        fast_matrix_market::tar_reader tar(iss);
+        ASSERT_TRUE(tar.next());
+        EXPECT_EQ(tar.entry().name, long_name);
+        EXPECT_EQ(read_mtx(tar.member()), read_mtx(mtx));
+    }
+}
+
+TEST(Tar, Invalid) {
+    std::string mtx = generate_antidiagonal_mtx(1000);
+
+    {
+        // bad checksum
+        std::string archive = tar_member("a.mtx", mtx) + tar_end();
+        archive[0] = 'b';
+        std::istringstream iss(archive);
+        fast_matrix_market::tar_reader tar(iss);
+        EXPECT_THROW(tar.next(), fast_matrix_market::tar_error);
+    }
+    {
+        // truncated member
+        std::string archive = tar_member("a.mtx", mtx);
+        archive.resize(archive.size() / 2);
+        std::istringstream iss(archive);
+        fast_matrix_market::tar_reader tar(iss);
+        ASSERT_TRUE(tar.next());
+        EXPECT_THROW(read_mtx(tar.member()), fast_matrix_market::tar_error);
+    }
+}
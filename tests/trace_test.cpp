@@ -0,0 +1,112 @@
+// Copyright (C) 2023 Adam Lugowski. All rights reserved.
+// Use of this source code is governed by the BSD 2-clause license found in the LICENSE.txt file.
+// SPDX-License-Identifier: BSD-2-Clause
+
+// Built with FMM_TRACE defined.
+
+#include <regex>
+#include <thread>
+
+#include "fmm_tests.hpp"
+
+using Mat = triplet_matrix<int64_t, double>;
+
+static std::size_t count_events(const std::string& json, const std::string& name) {
+    std::regex re("\\{\"name\":\"" + name + "\",\"ph\":\"X\",\"pid\":1,\"tid\":[0-9]+,\"ts\":[0-9]+\\.[0-9]{3},\"dur\":[0-9]+\\.[0-9]{3}[,}]");
+    return (std::size_t)std::distance(std::sregex_iterator(json.begin(), json.end(), re), std::sregex_iterator());
+}
+
+TEST(Trace, ReadAndWrite) {
+    Mat mat = generate_antidiagonal(5000);
+
+    fast_matrix_market::trace::clear();
+
+    fast_matrix_market::write_options woptions;
+    woptions.chunk_size_values = 100;
+    woptions.num_threads = 4;
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, {mat.nrows, mat.ncols}, mat.rows, mat.cols, mat.vals, woptions);
+
+    fast_matrix_market::read_options roptions;
+    roptions.chunk_size_bytes = 1 << 14;
+    roptions.num_threads = 4;
+    Mat read;
+    std::istringstream iss(oss.str());
+    fast_matrix_market::read_matrix_market_triplet(iss, read.nrows, read.ncols, read.rows, read.cols, read.vals, roptions);
+    EXPECT_EQ(read, mat);
+
+    std::ostringstream trace;
+    fast_matrix_market::trace::dump_chrome_trace(trace);
+    std::string json = trace.str();
+
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+    EXPECT_EQ(json.substr(json.size() - 4), "\n]}\n");
+
+    // one event per chunk for each stage
+    std::size_t num_read_chunks = count_events(json, "read chunk");
+    EXPECT_GT(num_read_chunks, 1);
+    EXPECT_EQ(count_events(json, "count lines"), num_read_chunks);
+    EXPECT_EQ(count_events(json, "parse"), num_read_chunks);
+    EXPECT_EQ(count_events(json, "commit"), num_read_chunks);
+
+    std::size_t num_written_chunks = count_events(json, "write");
+    EXPECT_GT(num_written_chunks, 1);
+    EXPECT_EQ(count_events(json, "format"), num_written_chunks);
+
+    EXPECT_GE(count_events(json, "pool task"), num_read_chunks * 2 + num_written_chunks);
+    EXPECT_NE(json.find("\"args\":{\"chunk\":1}"), std::string::npos);
+
+    // clear() drops everything
+    fast_matrix_market::trace::clear();
+    std::ostringstream empty;
+    fast_matrix_market::trace::dump_chrome_trace(empty);
+    EXPECT_EQ(empty.str(), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n]}\n");
+}
+
+TEST(Trace, RingBufferKeepsNewest) {
+    fast_matrix_market::trace::clear();
+    auto total = (int64_t)fast_matrix_market::trace::kRingCapacity + 10;
+    for (int64_t i = 0; i < total; ++i) {
+        FMM_TRACE_SCOPE("event", i);
+    }
+
+    std::ostringstream trace;
+    fast_matrix_market::trace::dump_chrome_trace(trace);
+    std::string json = trace.str();
+    EXPECT_EQ(count_events(json, "event"), fast_matrix_market::trace::kRingCapacity);
+    EXPECT_EQ(json.find("\"args\":{\"chunk\":9}"), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"chunk\":10}"), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"chunk\":" + std::to_string(total - 1) + "}"), std::string::npos);
+}
+
+TEST(Trace, Microseconds) {
+    std::ostringstream oss;
+    fast_matrix_market::trace::write_microseconds(oss, 0);
+    oss << " ";
+    fast_matrix_market::trace::write_microseconds(oss, 1234567);
+    oss << " ";
+    fast_matrix_market::trace::write_microseconds(oss, 5004);
+    EXPECT_EQ(oss.str(), "0.000 1234.567 5.004");
+}
+
+TEST(Trace, ExitedThreadBuffersAreReused) {
+    fast_matrix_market::trace::clear();
+    auto& reg = fast_matrix_market::trace::registry::get();
+
+    auto run_thread = [](int64_t arg) {
+        std::thread t([arg] { FMM_TRACE_SCOPE("thread", arg); });
+        t.join();
+    };
+
+    run_thread(0);
+    std::size_t num_buffers = reg.buffers.size();
+    for (int64_t i = 1; i < 20; ++i) {
+        run_thread(i);
+    }
+    EXPECT_EQ(reg.buffers.size(), num_buffers);
+
+    // events of exited threads are kept
+    std::ostringstream trace;
+    fast_matrix_market::trace::dump_chrome_trace(trace);
+    EXPECT_EQ(count_events(trace.str(), "thread"), 20);
+}
@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: BSD-2-Clause
 
 #include <algorithm>
+#include <set>
 
 #include "fmm_tests.hpp"
 
@@ -92,6 +93,194 @@ TYPED_TEST(TripletTest, Generated) {
     }
 }
 
+TYPED_TEST(TripletTest, InflightByteLimit) {
+    using Mat = triplet_matrix<int64_t, TypeParam>;
+
+    for (int64_t max_inflight_bytes : {0, 1, 100}) {
+        this->load(1000, 15, 4);
+        this->roptions.max_inflight_bytes = max_inflight_bytes;
+        this->woptions.max_inflight_bytes = max_inflight_bytes;
+
+        Mat b = read_mtx<Mat>(write_mtx(this->mat, this->woptions), this->roptions);
+        EXPECT_EQ(this->mat, b);
+    }
+}
+
+TYPED_TEST(TripletTest, Iso) {
+    using Mat = triplet_matrix<int64_t, TypeParam>;
+
+    for (int64_t odd_position : {-1, 0, 500, 999}) {
+        for (int chunk_size : {15, 1 << 20}) {
+            for (int p : {1, 4}) {
+                this->load(1000, chunk_size, p);
+                std::fill(this->mat.vals.begin(), this->mat.vals.end(), static_cast<TypeParam>(1));
+                if (odd_position >= 0) {
+                    this->mat.vals[odd_position] = static_cast<TypeParam>(0);
+                }
+
+                std::istringstream iss(write_mtx(this->mat, this->woptions));
+                fast_matrix_market::matrix_market_header header;
+                Mat b;
+                bool is_iso = false;
+                fast_matrix_market::read_matrix_market_triplet_iso(iss, header, b.rows, b.cols, b.vals, is_iso,
+                                                                   this->roptions);
+                b.nrows = header.nrows;
+                b.ncols = header.ncols;
+
+                if (odd_position < 0) {
+                    EXPECT_TRUE(is_iso);
+                    ASSERT_EQ(b.vals.size(), 1);
+                    EXPECT_EQ(b.vals[0], static_cast<TypeParam>(1));
+                    b.vals.resize(b.rows.size(), b.vals[0]);
+                } else {
+                    EXPECT_FALSE(is_iso);
+                }
+                EXPECT_EQ(this->mat, b);
+            }
+        }
+    }
+}
+
+TEST(TripletTest, IsoSymmetricPattern) {
+    std::string mtx = "%%MatrixMarket matrix coordinate pattern symmetric\n3 3 3\n1 1\n2 1\n3 2\n";
+    std::istringstream iss(mtx);
+
+    fast_matrix_market::matrix_market_header header;
+    std::vector<int64_t> rows, cols;
+    std::vector<double> vals;
+    bool is_iso = false;
+    fast_matrix_market::read_matrix_market_triplet_iso(iss, header, rows, cols, vals, is_iso);
+
+    EXPECT_TRUE(is_iso);
+    EXPECT_EQ(vals, std::vector<double>({1}));
+    EXPECT_EQ(rows, std::vector<int64_t>({0, 1, 2, 0, 1}));
+    EXPECT_EQ(cols, std::vector<int64_t>({0, 0, 1, 1, 2}));
+}
+
+TEST(TripletTest, StructureOnly) {
+    using Mat = triplet_matrix<int64_t, std::complex<double>>;
+
+    for (std::string symmetry : {"general", "hermitian"}) {
+        std::string mtx = "%%MatrixMarket matrix coordinate complex " + symmetry + "\n100 100 100\n";
+        for (int i = 1; i <= 100; ++i) {
+            mtx += std::to_string(i) + " " + std::to_string((i + 1) / 2) + " 1.25 -3e5\n";
+        }
+
+        for (int p : {1, 4}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 64;
+            options.num_threads = p;
+
+            Mat full = read_mtx<Mat>(mtx, options);
+
+            options.structure_only = true;
+            Mat structure = read_mtx<Mat>(mtx, options);
+
+            EXPECT_EQ(structure.nrows, full.nrows);
+            EXPECT_EQ(structure.rows, full.rows);
+            EXPECT_EQ(structure.cols, full.cols);
+            EXPECT_TRUE(structure.vals.empty());
+        }
+    }
+
+    // skipped value on a last line without a newline
+    fast_matrix_market::read_options options;
+    options.structure_only = true;
+    Mat structure = read_mtx<Mat>("%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1.5\n2 1 2.5", options);
+    EXPECT_EQ(structure.rows, std::vector<int64_t>({0, 1}));
+    EXPECT_EQ(structure.cols, std::vector<int64_t>({0, 0}));
+}
+
+TEST(TripletTest, Permutation) {
+    using Mat = triplet_matrix<int64_t, double>;
+    using Element = std::tuple<int64_t, int64_t, double>;
+
+    std::string mtx = "%%MatrixMarket matrix coordinate real symmetric\n4 4 4\n1 1 1\n2 1 2\n3 2 3\n4 3 4\n";
+    std::vector<int64_t> row_perm = {2, 0, 3, 1};
+    std::vector<int64_t> col_perm = {3, 1, 0, 2};
+
+    // generalize in file coordinates, then permute
+    Mat general = read_mtx<Mat>(mtx, {});
+
+    for (const int64_t* cp : {row_perm.data(), col_perm.data()}) {
+        std::multiset<Element> expected;
+        for (std::size_t i = 0; i < general.rows.size(); ++i) {
+            expected.emplace(row_perm[general.rows[i]], cp[general.cols[i]], general.vals[i]);
+        }
+
+        for (int p : {1, 4}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 8;
+            options.num_threads = p;
+            options.row_permutation = row_perm.data();
+            options.col_permutation = cp;
+            Mat permuted = read_mtx<Mat>(mtx, options);
+
+            std::multiset<Element> actual;
+            for (std::size_t i = 0; i < permuted.rows.size(); ++i) {
+                actual.emplace(permuted.rows[i], permuted.cols[i], permuted.vals[i]);
+            }
+            EXPECT_EQ(actual, expected);
+
+            // same structure without values
+            options.structure_only = true;
+            Mat structure = read_mtx<Mat>(mtx, options);
+            EXPECT_EQ(structure.rows, permuted.rows);
+            EXPECT_EQ(structure.cols, permuted.cols);
+        }
+    }
+
+    // write applies the permutation while formatting
+    fast_matrix_market::write_options woptions;
+    woptions.row_permutation = row_perm.data();
+    woptions.col_permutation = col_perm.data();
+    std::string written = write_mtx(general, woptions);
+
+    fast_matrix_market::read_options roptions;
+    roptions.row_permutation = row_perm.data();
+    roptions.col_permutation = col_perm.data();
+    EXPECT_EQ(read_mtx<Mat>(written, {}), read_mtx<Mat>(write_mtx(general, {}), roptions));
+
+    // out of bounds permutation
+    std::vector<int64_t> bad_perm = {0, 5, 1, 2};
+    roptions.row_permutation = bad_perm.data();
+    EXPECT_THROW(read_mtx<Mat>(mtx, roptions), fast_matrix_market::invalid_argument);
+    woptions.row_permutation = bad_perm.data();
+    EXPECT_THROW(write_mtx(general, woptions), fast_matrix_market::invalid_argument);
+}
+
+TEST(TripletTest, GeneralizeSymmetryParallel) {
+    using Mat = triplet_matrix<int64_t, double>;
+
+    // lower triangle with some diagonal elements
+    Mat lower;
+    for (int64_t i = 0; i < 1000; ++i) {
+        lower.rows.push_back(i);
+        lower.cols.push_back(i % 3 == 0 ? i : i / 2);
+        lower.vals.push_back((double)i);
+    }
+
+    for (auto symmetry : {fast_matrix_market::symmetric, fast_matrix_market::skew_symmetric}) {
+        Mat expected = lower;
+        fast_matrix_market::read_options seq_options;
+        seq_options.parallel_ok = false;
+        fast_matrix_market::generalize_symmetry_triplet(expected.rows, expected.cols, expected.vals, symmetry, seq_options);
+        EXPECT_EQ(expected.rows.size(), 1000 + 666);
+
+        for (int p : {2, 4, 7}) {
+            Mat mat = lower;
+            fast_matrix_market::read_options options;
+            options.num_threads = p;
+            options.chunk_size_bytes = 16;
+            fast_matrix_market::generalize_symmetry_triplet(mat.rows, mat.cols, mat.vals, symmetry, options);
+            // parallel generalization emits in the same order as sequential
+            EXPECT_EQ(mat.rows, expected.rows);
+            EXPECT_EQ(mat.cols, expected.cols);
+            EXPECT_EQ(mat.vals, expected.vals);
+        }
+    }
+}
+
 TEST(TripletTest, BoolRaceConditions) {
     // std::vector<bool> may be specialized such that accessing different elements is not thread safe.
     // Ensure that the protection against this is working.
@@ -116,3 +305,50 @@ TEST(TripletTest, BoolRaceConditions) {
         EXPECT_EQ(triplet, triplet2);
     }
 }
+
+TEST(TripletTest, UninitializedVectors) {
+    // The reader writes every element, so output vectors need not be zero-filled first.
+    using Mat = triplet_matrix<int64_t, double>;
+    struct UninitMat {
+        int64_t nrows = 0, ncols = 0;
+        fast_matrix_market::uninitialized_vector<int64_t> rows, cols;
+        fast_matrix_market::uninitialized_vector<double> vals;
+    };
+    static_assert(std::is_same_v<decltype(UninitMat::rows)::allocator_type,
+                                 fast_matrix_market::default_init_allocator<int64_t>>);
+
+    Mat lower;
+    lower.nrows = lower.ncols = 1000;
+    for (int64_t i = 0; i < 1000; ++i) {
+        lower.rows.push_back(i);
+        lower.cols.push_back(i % 3 == 0 ? i : i / 2);
+        lower.vals.push_back((double)i + 0.5);
+    }
+    fast_matrix_market::matrix_market_header header(lower.nrows, lower.ncols);
+    header.symmetry = fast_matrix_market::symmetric;
+    std::ostringstream oss;
+    fast_matrix_market::write_matrix_market_triplet(oss, header, lower.rows, lower.cols, lower.vals);
+
+    for (auto diagonal : {fast_matrix_market::read_options::ExtraZeroElement,
+                          fast_matrix_market::read_options::DuplicateElement}) {
+        for (bool app : {false, true}) {
+            fast_matrix_market::read_options options;
+            options.chunk_size_bytes = 1 << 9;
+            options.num_threads = 4;
+            options.generalize_coordinate_diagnonal_values = diagonal;
+            options.generalize_symmetry_app = app;
+
+            Mat expected = read_mtx<Mat>(oss.str(), options);
+            UninitMat read = read_mtx<UninitMat>(oss.str(), options);
+            EXPECT_TRUE(std::equal(read.rows.begin(), read.rows.end(), expected.rows.begin(), expected.rows.end()));
+            EXPECT_TRUE(std::equal(read.cols.begin(), read.cols.end(), expected.cols.begin(), expected.cols.end()));
+            EXPECT_TRUE(std::equal(read.vals.begin(), read.vals.end(), expected.vals.begin(), expected.vals.end()));
+        }
+    }
+
+    // explicit values are still set
+    fast_matrix_market::uninitialized_vector<int64_t> v(3, 7);
+    v.resize(5, 9);
+    v.push_back(1);
+    EXPECT_EQ(std::vector<int64_t>(v.begin(), v.end()), (std::vector<int64_t>{7, 7, 7, 9, 9, 1}));
+}
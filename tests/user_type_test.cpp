@@ -5,6 +5,7 @@
 #include <fstream>
 
 #include <fast_matrix_market/fast_matrix_market.hpp>
+#include <fast_matrix_market/app/string_arena.hpp>
 
 #include "fmm_tests.hpp"
 
@@ -104,4 +105,96 @@ TEST(UserTypeTest, String) {
         EXPECT_EQ(m.vals[2], "0");
         EXPECT_EQ(m.vals[3], "404");
     }
-}
\ No newline at end of file
+}
+
+using ViewMat = triplet_matrix<int64_t, std::string_view>;
+
+template <typename T, typename = void>
+struct has_read_value : std::false_type {};
+
+template <typename T>
+struct has_read_value<T, std::void_t<decltype(fast_matrix_market::read_value(
+        (const char*)nullptr, (const char*)nullptr, std::declval<T&>(), fast_matrix_market::read_options()))>> : std::true_type {};
+
+// std::string_view values are only readable through an arena. Plain readers would return views into freed chunks.
+static_assert(has_read_value<std::string>::value);
+static_assert(!has_read_value<std::string_view>::value);
+
+TEST(UserTypeTest, StringViewArena) {
+    for (const char* filename : {"eye3_str.mtx", "eye3_pattern.mtx", "eye3_complex.mtx", "vector_array.mtx"}) {
+        std::string orig = read_file(filename);
+        auto [expected, expected_header] = read_triplet(orig);
+
+        fast_matrix_market::string_arena arena;
+        ViewMat m;
+        fast_matrix_market::matrix_market_header header;
+        std::istringstream iss(orig);
+        fast_matrix_market::read_matrix_market_triplet(iss, header, m.rows, m.cols, m.vals, arena);
+        EXPECT_EQ(m.rows, expected.rows);
+        EXPECT_EQ(m.cols, expected.cols);
+        EXPECT_EQ(std::vector<std::string>(m.vals.begin(), m.vals.end()), expected.vals) << filename;
+
+        // the views are still valid after the chunk buffers are gone
+        std::ostringstream oss;
+        fast_matrix_market::write_options woptions;
+        woptions.fill_header_field_type = false;
+        fast_matrix_market::write_matrix_market_triplet(oss, header, m.rows, m.cols, m.vals, woptions);
+        EXPECT_EQ(oss.str(), write_triplet(expected, expected_header));
+    }
+}
+
+TEST(UserTypeTest, StringViewArenaSymmetricDiagonal) {
+    std::string orig = "%%MatrixMarket matrix coordinate real symmetric\n2 2 3\n1 1 5\n2 1 7\n2 2 9\n";
+    auto [expected, expected_header] = read_triplet(orig);
+
+    fast_matrix_market::string_arena arena;
+    ViewMat m;
+    fast_matrix_market::matrix_market_header header;
+    std::istringstream iss(orig);
+    fast_matrix_market::read_matrix_market_triplet(iss, header, m.rows, m.cols, m.vals, arena);
+
+    // diagonal elements are not duplicated
+    EXPECT_EQ(m.rows.size(), 4);
+    EXPECT_EQ(m.rows, expected.rows);
+    EXPECT_EQ(m.cols, expected.cols);
+    EXPECT_EQ(std::vector<std::string>(m.vals.begin(), m.vals.end()), expected.vals);
+}
+
+TEST(UserTypeTest, StringViewArenaParallel) {
+    // skew-symmetric, so mirrored values are negated copies
+    std::ostringstream oss;
+    oss << "%%MatrixMarket matrix coordinate real skew-symmetric\n10000 10000 10000\n";
+    for (int64_t i = 0; i < 10000; ++i) {
+        oss << (i + 1) << " " << (i / 2 + 1) << " " << i << ".25e0\n";
+    }
+
+    fast_matrix_market::read_options options;
+    options.chunk_size_bytes = 1 << 13;
+    options.num_threads = 4;
+
+    std::istringstream expected_iss(oss.str());
+    StrMat expected;
+    fast_matrix_market::read_matrix_market_triplet(expected_iss, expected.nrows, expected.ncols, expected.rows, expected.cols, expected.vals, options);
+
+    fast_matrix_market::string_arena arena(1 << 12);
+    ViewMat m;
+    fast_matrix_market::matrix_market_header header;
+    std::istringstream iss(oss.str());
+    fast_matrix_market::read_matrix_market_triplet(iss, header, m.rows, m.cols, m.vals, arena, options);
+
+    EXPECT_EQ(m.rows, expected.rows);
+    EXPECT_EQ(m.cols, expected.cols);
+    EXPECT_EQ(std::vector<std::string>(m.vals.begin(), m.vals.end()), expected.vals);
+    // (1, 1) is on the diagonal and is not mirrored
+    EXPECT_EQ(m.vals.size(), 19999);
+    EXPECT_EQ(m.vals[1], "1.25e0");
+    EXPECT_EQ(m.vals[10000], "-1.25e0");
+
+    // a few large blocks instead of an allocation per value
+    EXPECT_GT(arena.allocated_bytes(), 10000U * 6);
+    EXPECT_LT(arena.allocated_bytes(), (10000U * 2 * 9) + 64 * (1U << 12));
+
+    EXPECT_EQ(arena.copy("abc"), "abc");
+    arena.clear();
+    EXPECT_EQ(arena.allocated_bytes(), 0);
+}